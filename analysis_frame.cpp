@@ -0,0 +1,149 @@
+#include "analysis_frame.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float MU_LAW = 255.0f;
+const size_t LEVELS_OFFSET = 0;
+const size_t BANDS_OFFSET = 8;
+const size_t WAVEFORM_OFFSET = BANDS_OFFSET + 2 * ANALYSIS_BANDS;
+
+uint8_t encodeMuLaw(float x) {
+    x = std::max(-1.0f, std::min(1.0f, x));
+    float y = std::log1p(MU_LAW * std::fabs(x)) / std::log1p(MU_LAW);
+    int q = static_cast<int>(std::lround(y * 127.0f));
+    return static_cast<uint8_t>(static_cast<int8_t>(x < 0.0f ? -q : q));
+}
+
+float decodeMuLaw(uint8_t byte) {
+    float y = static_cast<int8_t>(byte) / 127.0f;
+    float x = std::expm1(std::fabs(y) * std::log1p(MU_LAW)) / MU_LAW;
+    return y < 0.0f ? -x : x;
+}
+
+void putLevel(uint8_t* p, float level) {
+    uint32_t q = static_cast<uint32_t>(std::lround(std::max(0.0f, std::min(1.0f, level)) * 65535.0f));
+    p[0] = static_cast<uint8_t>(q);
+    p[1] = static_cast<uint8_t>(q >> 8);
+}
+
+float getLevel(const uint8_t* p) {
+    return (p[0] | (p[1] << 8)) / 65535.0f;
+}
+
+} // namespace
+
+/**
+ * @brief Computes the analysis of one stereo buffer.
+ */
+void analyzeAudio(const int16_t* leftData, const int16_t* rightData, uint32_t sampleRate,
+                  bool audioActive, AnalysisFrame& frame) {
+    frame.sampleRate = sampleRate;
+    frame.audioActive = audioActive;
+    const int16_t* channels[2] = {leftData, rightData};
+    for (int c = 0; c < 2; ++c) {
+        const int16_t* data = channels[c];
+        float total_sq = 0.0f;
+        int peak = 0;
+        for (int band = 0; band < ANALYSIS_BANDS; ++band) {
+            int start_idx = band * BUFFER_FRAMES / ANALYSIS_BANDS;
+            int end_idx = (band + 1) * BUFFER_FRAMES / ANALYSIS_BANDS;
+            float sum_sq = 0.0f;
+            for (int i = start_idx; i < end_idx; ++i) {
+                float sample = data[i] / 32768.0f;
+                sum_sq += sample * sample;
+                peak = std::max(peak, std::abs(static_cast<int>(data[i])));
+            }
+            total_sq += sum_sq;
+            frame.bands[c][band] = end_idx > start_idx ? std::sqrt(sum_sq / (end_idx - start_idx)) : 0.0f;
+        }
+        frame.rms[c] = std::sqrt(total_sq / BUFFER_FRAMES);
+        frame.peak[c] = std::min(1.0f, peak / 32768.0f);
+
+        for (int p = 0; p < WAVEFORM_POINTS; ++p) {
+            int sum = 0;
+            for (int k = 0; k < WAVEFORM_DECIMATION; ++k) sum += data[p * WAVEFORM_DECIMATION + k];
+            frame.waveform[c][p] = sum / (32768.0f * WAVEFORM_DECIMATION);
+        }
+    }
+}
+
+bool BeatDetector::update(float level, float seconds) {
+    bool onset = level > levelAverage * 1.4f && level > 0.02f && beat < 0.5f;
+    if (onset) beat = 1.0f;
+    else beat *= std::exp(-seconds / BEAT_SECONDS);
+    const float keep = std::exp(-seconds / AVERAGE_SECONDS);
+    levelAverage = levelAverage * keep + level * (1.0f - keep);
+    return onset;
+}
+
+float beatLevel(const int16_t* leftData, const int16_t* rightData) {
+    float sum_sq = 0.0f;
+    for (int i = 0; i < BUFFER_FRAMES; ++i) {
+        float mono = (static_cast<float>(leftData[i]) + static_cast<float>(rightData[i])) / 2.0f;
+        sum_sq += mono * mono;
+    }
+    return std::min(1.0f, std::sqrt(sum_sq / BUFFER_FRAMES) / 32767.0f);
+}
+
+/**
+ * @brief Packs a frame into its fixed byte layout.
+ */
+void quantizeFrame(const AnalysisFrame& frame, QuantizedFrame& out) {
+    out.sampleRate = frame.sampleRate;
+    out.audioActive = frame.audioActive;
+    uint8_t* levels = out.bytes + LEVELS_OFFSET;
+    for (int c = 0; c < 2; ++c) {
+        putLevel(levels + c * 2, frame.rms[c]);
+        putLevel(levels + 4 + c * 2, frame.peak[c]);
+        for (int band = 0; band < ANALYSIS_BANDS; ++band) {
+            float v = std::max(0.0f, std::min(1.0f, frame.bands[c][band]));
+            out.bytes[BANDS_OFFSET + c * ANALYSIS_BANDS + band] = static_cast<uint8_t>(std::lround(std::sqrt(v) * 255.0f));
+        }
+        for (int p = 0; p < WAVEFORM_POINTS; ++p) {
+            out.bytes[WAVEFORM_OFFSET + c * WAVEFORM_POINTS + p] = encodeMuLaw(frame.waveform[c][p]);
+        }
+    }
+}
+
+/**
+ * @brief Unpacks a quantized frame.
+ */
+void dequantizeFrame(const QuantizedFrame& in, AnalysisFrame& frame) {
+    frame.sampleRate = in.sampleRate;
+    frame.audioActive = in.audioActive;
+    const uint8_t* levels = in.bytes + LEVELS_OFFSET;
+    for (int c = 0; c < 2; ++c) {
+        frame.rms[c] = getLevel(levels + c * 2);
+        frame.peak[c] = getLevel(levels + 4 + c * 2);
+        for (int band = 0; band < ANALYSIS_BANDS; ++band) {
+            float root = in.bytes[BANDS_OFFSET + c * ANALYSIS_BANDS + band] / 255.0f;
+            frame.bands[c][band] = root * root;
+        }
+        for (int p = 0; p < WAVEFORM_POINTS; ++p) {
+            frame.waveform[c][p] = decodeMuLaw(in.bytes[WAVEFORM_OFFSET + c * WAVEFORM_POINTS + p]);
+        }
+    }
+}
+
+/**
+ * @brief Upsamples the waveform back to a full buffer by linear interpolation.
+ *
+ * Waveform point p is the average of samples p*D .. p*D+D-1, so it sits at
+ * sample position p*D + (D-1)/2.
+ */
+void synthesizeAudio(const AnalysisFrame& frame, int16_t* leftData, int16_t* rightData) {
+    int16_t* channels[2] = {leftData, rightData};
+    const float center = (WAVEFORM_DECIMATION - 1) * 0.5f;
+    for (int c = 0; c < 2; ++c) {
+        const float* points = frame.waveform[c];
+        for (int i = 0; i < BUFFER_FRAMES; ++i) {
+            float pos = std::max(0.0f, std::min(float(WAVEFORM_POINTS - 1), (i - center) / WAVEFORM_DECIMATION));
+            int p = std::min(static_cast<int>(pos), WAVEFORM_POINTS - 2);
+            float t = pos - p;
+            float v = points[p] + (points[p + 1] - points[p]) * t;
+            channels[c][i] = static_cast<int16_t>(std::lround(std::max(-1.0f, std::min(1.0f, v)) * 32767.0f));
+        }
+    }
+}
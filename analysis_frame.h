@@ -0,0 +1,80 @@
+#ifndef ANALYSIS_FRAME_H
+#define ANALYSIS_FRAME_H
+
+#include <cstddef>
+#include <cstdint>
+#include "config_parser.h"
+
+const int ANALYSIS_BANDS = 32;
+const int WAVEFORM_DECIMATION = 2;
+const int WAVEFORM_POINTS = BUFFER_FRAMES / WAVEFORM_DECIMATION;
+
+/**
+ * @brief What the visualizers need to know about one buffer of audio.
+ *
+ * Index 0 is the left channel and 1 the right. Bands are the RMS of equal
+ * slices of the buffer, as the bar graph computes them; the waveform is the
+ * buffer averaged down by WAVEFORM_DECIMATION.
+ */
+struct AnalysisFrame {
+    uint32_t sampleRate = 0;
+    bool audioActive = false;
+    float rms[2] = {0.0f, 0.0f};                  // 0 to 1
+    float peak[2] = {0.0f, 0.0f};                 // 0 to 1
+    float bands[2][ANALYSIS_BANDS] = {};          // 0 to 1
+    float waveform[2][WAVEFORM_POINTS] = {};      // -1 to 1
+};
+
+// Byte layout: rms and peak as 4 little-endian u16, then the bands of both
+// channels as u8, then the waveform of both channels as 8-bit mu-law.
+const size_t QUANTIZED_FRAME_BYTES = 8 + 2 * ANALYSIS_BANDS + 2 * WAVEFORM_POINTS;
+
+/**
+ * @brief An AnalysisFrame packed into a fixed number of bytes.
+ *
+ * Levels keep 16 bits, bands are stored as sqrt(level) in 8 bits so quiet
+ * bands keep their resolution, and the waveform is mu-law companded. The
+ * layout is the same from frame to frame, so consecutive frames differ in
+ * few bytes and delta-encode well.
+ */
+struct QuantizedFrame {
+    uint32_t sampleRate = 0;
+    bool audioActive = false;
+    uint8_t bytes[QUANTIZED_FRAME_BYTES] = {};
+};
+
+/**
+ * @brief Flags onsets: a buffer whose level jumps well above the recent average.
+ *
+ * Drives the expression shapes' `beat` input and the onsets of the offline
+ * analysis, both fed every buffer. The decays are time constants, applied
+ * as exp(-dt/tau) of each buffer's duration, so the beats are the same at
+ * any sample rate. The average follows the level over about 0.3 s, so
+ * state carried over from earlier audio fades out quickly.
+ */
+struct BeatDetector {
+    static constexpr float AVERAGE_SECONDS = 0.3f;
+    static constexpr float BEAT_SECONDS = 0.1f;
+
+    float levelAverage = 0.0f;
+    float beat = 0.0f;  // 1 on an onset, decaying with time
+
+    // Feeds the level (0 to 1) of a buffer lasting `seconds`; true when it starts a beat
+    bool update(float level, float seconds);
+};
+
+// The level a BeatDetector is fed: RMS of the mono mix, 0 to 1
+float beatLevel(const int16_t* leftData, const int16_t* rightData);
+
+// Computes levels, bands and the decimated waveform of one stereo buffer.
+void analyzeAudio(const int16_t* leftData, const int16_t* rightData, uint32_t sampleRate,
+                  bool audioActive, AnalysisFrame& frame);
+
+void quantizeFrame(const AnalysisFrame& frame, QuantizedFrame& out);
+void dequantizeFrame(const QuantizedFrame& in, AnalysisFrame& frame);
+
+// Rebuilds BUFFER_FRAMES samples per channel from the waveform, so a remote
+// frame can be drawn by the same code as captured audio.
+void synthesizeAudio(const AnalysisFrame& frame, int16_t* leftData, int16_t* rightData);
+
+#endif // ANALYSIS_FRAME_H
@@ -0,0 +1,248 @@
+#include "analysis_log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const size_t HEADER_BYTES = 32;
+const size_t RECORD_HEAD_BYTES = 16;
+const size_t RECORD_BYTES = RECORD_HEAD_BYTES + QUANTIZED_FRAME_BYTES;
+const size_t INDEX_HEAD_BYTES = 16;
+const size_t INDEX_ENTRY_BYTES = 16;
+const uint8_t RECORD_FRAME = 1;
+const uint8_t RECORD_INDEX = 2;
+// Past the last frame by this much, playback has ended
+const double END_GRACE_US = 1e6;
+const double SLOW_FACTOR = 0.25;
+
+void putLe(uint8_t* p, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+
+uint64_t getLe(const uint8_t* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) value |= static_cast<uint64_t>(p[i]) << (8 * i);
+    return value;
+}
+
+} // namespace
+
+// --- Recorder ---
+
+AnalysisRecorder::~AnalysisRecorder() {
+    // A last partial group stays without an index block; the replayer reads it from its records
+    if (file) std::fclose(file);
+}
+
+bool AnalysisRecorder::open(const std::string& path, std::string& error) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        error = "Cannot write " + path + ": " + std::strerror(errno);
+        return false;
+    }
+    uint8_t header[HEADER_BYTES] = {};
+    std::memcpy(header, ANALYSIS_LOG_MAGIC, sizeof(ANALYSIS_LOG_MAGIC));
+    putLe(header + 4, ANALYSIS_LOG_VERSION, 2);
+    putLe(header + 6, HEADER_BYTES, 2);
+    putLe(header + 8, RECORD_BYTES, 2);
+    putLe(header + 10, ANALYSIS_LOG_INDEX_INTERVAL, 2);
+    putLe(header + 12, ANALYSIS_BANDS, 2);
+    putLe(header + 14, WAVEFORM_POINTS, 2);
+    auto wall = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch());
+    putLe(header + 16, static_cast<uint64_t>(wall.count()), 8);
+    if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        error = "Cannot write " + path + ": " + std::strerror(errno);
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    start = std::chrono::steady_clock::now();
+    offset = HEADER_BYTES;
+    index.reserve(ANALYSIS_LOG_INDEX_INTERVAL * INDEX_ENTRY_BYTES);
+    return true;
+}
+
+void AnalysisRecorder::append(const AnalysisFrame& frame) {
+    if (!file || failed) return;
+    const uint64_t time_us = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    QuantizedFrame packed;
+    quantizeFrame(frame, packed);
+    uint8_t record[RECORD_BYTES] = {};
+    record[0] = RECORD_FRAME;
+    record[1] = packed.audioActive ? 1 : 0;
+    putLe(record + 4, packed.sampleRate, 4);
+    putLe(record + 8, time_us, 8);
+    std::memcpy(record + RECORD_HEAD_BYTES, packed.bytes, QUANTIZED_FRAME_BYTES);
+    uint8_t entry[INDEX_ENTRY_BYTES];
+    putLe(entry, time_us, 8);
+    putLe(entry + 8, offset, 8);
+    index.append(reinterpret_cast<const char*>(entry), sizeof(entry));
+    failed = std::fwrite(record, 1, sizeof(record), file) != sizeof(record);
+    offset += RECORD_BYTES;
+
+    if (++frames % ANALYSIS_LOG_INDEX_INTERVAL != 0 || failed) return;
+    uint8_t head[INDEX_HEAD_BYTES] = {};
+    head[0] = RECORD_INDEX;
+    putLe(head + 2, ANALYSIS_LOG_INDEX_INTERVAL, 2);
+    putLe(head + 4, frames / ANALYSIS_LOG_INDEX_INTERVAL - 1, 4);
+    failed = std::fwrite(head, 1, sizeof(head), file) != sizeof(head) ||
+             std::fwrite(index.data(), 1, index.size(), file) != index.size() || std::fflush(file) != 0;
+    offset += INDEX_HEAD_BYTES + index.size();
+    index.clear();
+}
+
+// --- Replayer ---
+
+bool AnalysisReplayer::open(const std::string& path, std::string& error) {
+    file = std::make_unique<MappedFile>(path);
+    if (!file->ok) {
+        error = "Cannot read " + path;
+        return false;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file->data);
+    if (file->size < HEADER_BYTES || std::memcmp(data, ANALYSIS_LOG_MAGIC, sizeof(ANALYSIS_LOG_MAGIC)) != 0) {
+        error = path + " is not an analysis log";
+        return false;
+    }
+    if (getLe(data + 4, 2) != ANALYSIS_LOG_VERSION) {
+        error = path + " is analysis log version " + std::to_string(getLe(data + 4, 2)) + "; only version " +
+                std::to_string(ANALYSIS_LOG_VERSION) + " is supported";
+        return false;
+    }
+    header_bytes = getLe(data + 6, 2);
+    record_bytes = getLe(data + 8, 2);
+    const uint64_t interval = getLe(data + 10, 2);
+    if (header_bytes < HEADER_BYTES || record_bytes != RECORD_BYTES || interval == 0 ||
+        getLe(data + 12, 2) != ANALYSIS_BANDS || getLe(data + 14, 2) != WAVEFORM_POINTS || interval != ANALYSIS_LOG_INDEX_INTERVAL) {
+        error = path + " was recorded with a different frame layout";
+        return false;
+    }
+    if (file->size < header_bytes) {
+        error = path + " is damaged";
+        return false;
+    }
+    group_bytes = interval * record_bytes + INDEX_HEAD_BYTES + interval * INDEX_ENTRY_BYTES;
+    // Every group has the same size, so counting them is arithmetic, not a scan
+    const uint64_t body = file->size - header_bytes;
+    full_groups = body / group_bytes;
+    const uint64_t tail = std::min<uint64_t>(interval, (body - full_groups * group_bytes) / record_bytes);
+    total_frames = full_groups * interval + tail;
+    if (total_frames > 0 && record(0)[0] != RECORD_FRAME) {
+        error = path + " is damaged";
+        return false;
+    }
+    if (full_groups > 0 && data[header_bytes + full_groups * group_bytes - INDEX_HEAD_BYTES - interval * INDEX_ENTRY_BYTES] != RECORD_INDEX) {
+        error = path + " is damaged";
+        return false;
+    }
+    media_us = total_frames > 0 ? static_cast<double>(frameTime(0)) : 0.0;
+    return true;
+}
+
+const uint8_t* AnalysisReplayer::record(uint64_t frame) const {
+    const uint64_t group = frame / ANALYSIS_LOG_INDEX_INTERVAL;
+    const uint64_t slot = frame % ANALYSIS_LOG_INDEX_INTERVAL;
+    return reinterpret_cast<const uint8_t*>(file->data) + header_bytes + group * group_bytes + slot * record_bytes;
+}
+
+uint64_t AnalysisReplayer::frameTime(uint64_t frame) const {
+    const uint64_t group = frame / ANALYSIS_LOG_INDEX_INTERVAL;
+    if (group < full_groups) {
+        // From the index block, so a search only touches index pages
+        const uint8_t* index = reinterpret_cast<const uint8_t*>(file->data) + header_bytes + group * group_bytes +
+                               ANALYSIS_LOG_INDEX_INTERVAL * record_bytes + INDEX_HEAD_BYTES;
+        return getLe(index + (frame % ANALYSIS_LOG_INDEX_INTERVAL) * INDEX_ENTRY_BYTES, 8);
+    }
+    return getLe(record(frame) + 8, 8);
+}
+
+uint64_t AnalysisReplayer::frameAt(double time_us) const {
+    // The last frame recorded at or before the time
+    uint64_t low = 0, high = total_frames;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        if (static_cast<double>(frameTime(middle)) <= time_us) low = middle + 1;
+        else high = middle;
+    }
+    return low > 0 ? low - 1 : 0;
+}
+
+bool AnalysisReplayer::receive(AnalysisFrame& frame) {
+    if (total_frames == 0) return false;
+    auto now = std::chrono::steady_clock::now();
+    const uint64_t last = total_frames - 1;
+    uint64_t next;
+    if (replay_speed == ReplaySpeed::MAX) {
+        next = have_current ? current + 1 : frameAt(media_us);
+        finished = next > last;
+        next = std::min(next, last);
+        media_us = static_cast<double>(frameTime(next));
+    } else {
+        if (have_tick) {
+            double factor = replay_speed == ReplaySpeed::SLOW ? SLOW_FACTOR : 1.0;
+            media_us += std::chrono::duration<double, std::micro>(now - last_tick).count() * factor;
+        }
+        next = frameAt(media_us);
+        finished = next == last && media_us - static_cast<double>(frameTime(last)) > END_GRACE_US;
+    }
+    last_tick = now;
+    have_tick = true;
+    if (have_current && next == current) return false;
+
+    const uint8_t* data = record(next);
+    QuantizedFrame packed;
+    packed.audioActive = data[1] != 0;
+    packed.sampleRate = static_cast<uint32_t>(getLe(data + 4, 4));
+    std::memcpy(packed.bytes, data + RECORD_HEAD_BYTES, QUANTIZED_FRAME_BYTES);
+    dequantizeFrame(packed, frame);
+    current = next;
+    have_current = true;
+    current_active = packed.audioActive;
+    return true;
+}
+
+bool AnalysisReplayer::active() const {
+    return have_current && !finished && current_active;
+}
+
+void AnalysisReplayer::setSpeed(ReplaySpeed speed) {
+    replay_speed = speed;
+    have_tick = false;  // The time spent at the old speed is not replayed at the new one
+}
+
+void AnalysisReplayer::seek(double seconds) {
+    if (total_frames == 0) return;
+    const double first = static_cast<double>(frameTime(0));
+    const double last = static_cast<double>(frameTime(total_frames - 1));
+    media_us = std::max(first, std::min(last, first + seconds * 1e6));
+    have_current = false;
+    have_tick = false;
+    finished = false;
+}
+
+double AnalysisReplayer::position() const {
+    return total_frames > 0 ? std::min(duration(), (media_us - static_cast<double>(frameTime(0))) / 1e6) : 0.0;
+}
+
+double AnalysisReplayer::duration() const {
+    return total_frames > 0 ? static_cast<double>(frameTime(total_frames - 1) - frameTime(0)) / 1e6 : 0.0;
+}
+
+bool parseReplaySpeed(const std::string& text, ReplaySpeed& out) {
+    if (text == "1x") out = ReplaySpeed::REALTIME;
+    else if (text == "slow") out = ReplaySpeed::SLOW;
+    else if (text == "max") out = ReplaySpeed::MAX;
+    else return false;
+    return true;
+}
+
+const char* replaySpeedName(ReplaySpeed speed) {
+    switch (speed) {
+        case ReplaySpeed::REALTIME: return "1x";
+        case ReplaySpeed::SLOW: return "slow";
+        case ReplaySpeed::MAX: return "max";
+    }
+    return "1x";
+}
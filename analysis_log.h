@@ -0,0 +1,111 @@
+#ifndef ANALYSIS_LOG_H
+#define ANALYSIS_LOG_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include "analysis_frame.h"
+#include "mapped_file.h"
+
+// Analysis logs, all little-endian. A 32-byte header:
+//   char magic[4] "MLAL", u16 version (1), u16 header size (32),
+//   u16 frame record size, u16 frames per index block, u16 bands per channel,
+//   u16 waveform points per channel, u64 start (Unix time in microseconds),
+//   u64 reserved
+// (a longer header from a later writer is skipped as a whole), then groups of one frame record per frame and an index block after every
+// full group. A frame record is u8 type (1), u8 audio active, u16 reserved,
+// u32 sample rate, u64 time in microseconds since the start, then the
+// QuantizedFrame bytes. An index block is u8 type (2), u8 reserved,
+// u16 entry count, u32 group number, u64 reserved, then one entry per frame
+// of its group: u64 time, u64 file offset of the record. Groups only ever
+// get appended; a log cut short (the recorder was killed) ends in a group
+// without its index block, which is still read.
+const char ANALYSIS_LOG_MAGIC[4] = {'M', 'L', 'A', 'L'};
+const int ANALYSIS_LOG_VERSION = 1;
+const int ANALYSIS_LOG_INDEX_INTERVAL = 256;  // About four seconds at 60 fps
+
+/**
+ * @brief Appends every analysis frame to a log, for replaying a session without its audio.
+ *
+ * Writes are buffered; the log is flushed after each index block, so a
+ * crash loses at most one group.
+ */
+class AnalysisRecorder {
+public:
+    AnalysisRecorder() = default;
+    ~AnalysisRecorder();
+    AnalysisRecorder(const AnalysisRecorder&) = delete;
+    AnalysisRecorder& operator=(const AnalysisRecorder&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+    void append(const AnalysisFrame& frame);
+
+private:
+    FILE* file = nullptr;
+    std::chrono::steady_clock::time_point start;
+    uint64_t offset = 0;       // Of the next record
+    uint64_t frames = 0;
+    std::string index;         // The entries of the group being written
+    bool failed = false;
+};
+
+enum class ReplaySpeed {
+    REALTIME,  // As recorded
+    SLOW,      // A quarter of that
+    MAX        // One frame per frame drawn, whatever the recorded times
+};
+
+/**
+ * @brief Plays an analysis log back, standing in for a remote publisher.
+ *
+ * The log is memory-mapped and nothing is read up front, so even hours of
+ * frames open at once. Finding the frame for a time is a binary search over
+ * the index blocks' entries (and the records of a last, unindexed group),
+ * so seeking touches O(log n) pages.
+ */
+class AnalysisReplayer {
+public:
+    bool open(const std::string& path, std::string& error);
+
+    // Returns true if `frame` was replaced by the frame now due.
+    bool receive(AnalysisFrame& frame);
+
+    // Playing, not past the last frame, and that frame had audio.
+    bool active() const;
+
+    void setSpeed(ReplaySpeed speed);
+    ReplaySpeed speed() const { return replay_speed; }
+    // Moves playback to this many seconds after the start of the log
+    void seek(double seconds);
+    double position() const;
+    double duration() const;
+    uint64_t frameCount() const { return total_frames; }
+
+private:
+    std::unique_ptr<MappedFile> file;
+    uint64_t header_bytes = 0;  // As the header gives it; a longer header is skipped, not parsed
+    uint64_t record_bytes = 0;
+    uint64_t group_bytes = 0;
+    uint64_t full_groups = 0;
+    uint64_t total_frames = 0;
+    ReplaySpeed replay_speed = ReplaySpeed::REALTIME;
+    double media_us = 0.0;     // Playback position in the log's time
+    std::chrono::steady_clock::time_point last_tick;
+    bool have_tick = false;
+    uint64_t current = 0;      // Frame shown now
+    bool have_current = false;
+    bool finished = false;
+    bool current_active = false;
+
+    const uint8_t* record(uint64_t frame) const;
+    uint64_t frameTime(uint64_t frame) const;
+    uint64_t frameAt(double time_us) const;
+};
+
+// "1x", "slow" or "max"
+bool parseReplaySpeed(const std::string& text, ReplaySpeed& out);
+const char* replaySpeedName(ReplaySpeed speed);
+
+#endif // ANALYSIS_LOG_H
@@ -0,0 +1,262 @@
+#include "batch_analysis.h"
+#include "analysis_frame.h"
+#include "channel_ring.h"
+#include "loudness.h"
+#include "wav_file.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+// Longer than the loudness window, and the onset average has long settled by then
+const double WARMUP_SECONDS = 1.0;
+const size_t HEADER_BYTES = 32;
+const size_t LEVEL_AND_BAND_BYTES = 8 + 2 * ANALYSIS_BANDS;  // The start of QuantizedFrame::bytes
+const size_t RECORD_BYTES = LEVEL_AND_BAND_BYTES + 1 + 2;
+
+struct HopFeatures {
+    AnalysisFrame frame;
+    bool onset = false;
+    float momentary = -INFINITY;
+};
+
+/**
+ * @brief The live analysis of one hop, with the state it carries to the next.
+ */
+class FeaturePipeline {
+public:
+    void analyze(const WavFile& wav, uint64_t hop, HopFeatures& out) {
+        wav.readBuffer(hop, channels);
+        downmixStereo(channels, left, right);
+        analyzeAudio(left, right, wav.sampleRate(), true, out.frame);
+        out.onset = beats.update(beatLevel(left, right), static_cast<float>(BUFFER_FRAMES) / wav.sampleRate());
+        loudness.addBuffer(channels, wav.sampleRate());
+        out.momentary = loudness.momentary();
+    }
+
+private:
+    ChannelBuffers channels;
+    int16_t left[BUFFER_FRAMES];
+    int16_t right[BUFFER_FRAMES];
+    BeatDetector beats;
+    LoudnessMeter loudness;
+};
+
+void putU16(std::string& out, uint16_t value) {
+    out.push_back(static_cast<char>(value & 0xFF));
+    out.push_back(static_cast<char>(value >> 8));
+}
+
+void putU32(std::string& out, uint32_t value) {
+    putU16(out, static_cast<uint16_t>(value));
+    putU16(out, static_cast<uint16_t>(value >> 16));
+}
+
+void appendBinary(std::string& out, const HopFeatures& features) {
+    QuantizedFrame packed;
+    quantizeFrame(features.frame, packed);
+    out.append(reinterpret_cast<const char*>(packed.bytes), LEVEL_AND_BAND_BYTES);
+    out.push_back(features.onset ? 1 : 0);
+    int16_t centi_lufs = -32768;
+    if (std::isfinite(features.momentary)) {
+        centi_lufs = static_cast<int16_t>(std::max(-32767L, std::min(32767L, std::lround(features.momentary * 100.0f))));
+    }
+    putU16(out, static_cast<uint16_t>(centi_lufs));
+}
+
+void appendNumber(std::string& out, double value, int decimals) {
+    char text[32];
+    auto result = std::to_chars(text, text + sizeof(text), value, std::chars_format::fixed, decimals);
+    out.append(text, result.ptr);
+}
+
+void appendField(std::string& out, float value) {
+    out.push_back(',');
+    appendNumber(out, value, 5);
+}
+
+void appendCsv(std::string& out, const HopFeatures& features, double time) {
+    const AnalysisFrame& frame = features.frame;
+    appendNumber(out, time, 6);
+    for (int c = 0; c < 2; ++c) appendField(out, frame.rms[c]);
+    for (int c = 0; c < 2; ++c) appendField(out, frame.peak[c]);
+    for (int c = 0; c < 2; ++c) {
+        for (int band = 0; band < ANALYSIS_BANDS; ++band) appendField(out, frame.bands[c][band]);
+    }
+    out += features.onset ? ",1," : ",0,";
+    if (std::isfinite(features.momentary)) appendNumber(out, features.momentary, 2);
+    else out += "-inf";
+    out.push_back('\n');
+}
+
+std::string csvHeader() {
+    std::string header = "time,rms_l,rms_r,peak_l,peak_r";
+    for (const char* side : {"l", "r"}) {
+        for (int band = 0; band < ANALYSIS_BANDS; ++band) header += std::string(",band_") + side + "_" + std::to_string(band);
+    }
+    return header + ",onset,momentary_lufs\n";
+}
+
+std::string binaryHeader(const WavFile& wav, uint64_t hops) {
+    std::string header(FEATURE_FILE_MAGIC, sizeof(FEATURE_FILE_MAGIC));
+    putU16(header, FEATURE_FILE_VERSION);
+    putU16(header, HEADER_BYTES);
+    putU32(header, wav.sampleRate());
+    putU16(header, BUFFER_FRAMES);
+    putU16(header, ANALYSIS_BANDS);
+    putU16(header, RECORD_BYTES);
+    putU16(header, static_cast<uint16_t>(wav.channelMap().channels));
+    putU32(header, static_cast<uint32_t>(hops));
+    putU32(header, static_cast<uint32_t>(hops >> 32));
+    putU32(header, 0);
+    return header;
+}
+
+/**
+ * @brief One input and its output, which chunks are written to in order.
+ */
+struct BatchFile {
+    std::string input;
+    std::string output;
+    WavFile wav;
+    uint64_t hops = 0;
+    uint64_t chunkHops = 1;
+    int chunks = 0;
+
+    std::mutex mutex;  // Guards everything below
+    int nextChunk = 0;
+    std::map<int, std::string> finished;  // Chunks done before the ones ahead of them
+    FILE* out = nullptr;
+    bool failed = false;
+};
+
+std::string outputPath(const BatchOptions& options, const std::string& input) {
+    const char* extension = options.format == FeatureFormat::CSV ? ".features.csv" : ".features.bin";
+    if (options.outputDir.empty()) return input + extension;
+    size_t slash = input.find_last_of('/');
+    std::string name = slash == std::string::npos ? input : input.substr(slash + 1);
+    return options.outputDir + "/" + name + extension;
+}
+
+/**
+ * @brief Hands a finished chunk over, writing it and any that were waiting on it.
+ */
+void finishChunk(BatchFile& file, int chunk, std::string&& data, const BatchOptions& options) {
+    std::lock_guard<std::mutex> lock(file.mutex);
+    if (file.failed) return;
+    file.finished.emplace(chunk, std::move(data));
+    for (auto it = file.finished.find(file.nextChunk); it != file.finished.end(); it = file.finished.find(file.nextChunk)) {
+        if (!file.out) {
+            file.out = std::fopen(file.output.c_str(), "wb");
+            std::string header = options.format == FeatureFormat::CSV ? csvHeader() : binaryHeader(file.wav, file.hops);
+            if (!file.out || std::fwrite(header.data(), 1, header.size(), file.out) != header.size()) {
+                std::cerr << "Error: cannot write " << file.output << ": " << std::strerror(errno) << std::endl;
+                file.failed = true;
+                break;
+            }
+        }
+        if (std::fwrite(it->second.data(), 1, it->second.size(), file.out) != it->second.size()) {
+            std::cerr << "Error: cannot write " << file.output << ": " << std::strerror(errno) << std::endl;
+            file.failed = true;
+            break;
+        }
+        file.finished.erase(it);
+        ++file.nextChunk;
+    }
+    if (file.out && (file.failed || file.nextChunk == file.chunks)) {
+        if (std::fclose(file.out) != 0 && !file.failed) {
+            std::cerr << "Error: cannot write " << file.output << ": " << std::strerror(errno) << std::endl;
+            file.failed = true;
+        }
+        file.out = nullptr;
+        file.finished.clear();
+    }
+}
+
+std::string analyzeChunk(const BatchFile& file, int chunk, FeatureFormat format) {
+    const uint64_t first = static_cast<uint64_t>(chunk) * file.chunkHops;
+    const uint64_t last = std::min(file.hops, first + file.chunkHops);
+    const uint64_t warmup = static_cast<uint64_t>(WARMUP_SECONDS * file.wav.sampleRate() / BUFFER_FRAMES);
+    FeaturePipeline pipeline;
+    HopFeatures features;
+    for (uint64_t hop = first > warmup ? first - warmup : 0; hop < first; ++hop) pipeline.analyze(file.wav, hop, features);
+
+    std::string data;
+    data.reserve((last - first) * (format == FeatureFormat::CSV ? 600 : RECORD_BYTES));
+    const double seconds_per_hop = static_cast<double>(BUFFER_FRAMES) / file.wav.sampleRate();
+    for (uint64_t hop = first; hop < last; ++hop) {
+        pipeline.analyze(file.wav, hop, features);
+        if (format == FeatureFormat::CSV) appendCsv(data, features, hop * seconds_per_hop);
+        else appendBinary(data, features);
+    }
+    return data;
+}
+
+} // namespace
+
+int runBatchAnalysis(const BatchOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::unique_ptr<BatchFile>> files;
+    std::vector<std::pair<size_t, int>> work;  // (file, chunk), file by file so few outputs are open at once
+    double audio_seconds = 0.0;
+    bool all_ok = true;
+    for (const std::string& input : options.inputs) {
+        auto file = std::make_unique<BatchFile>();
+        std::string error;
+        if (!file->wav.open(input, error)) {
+            std::cerr << "Error: " << error << std::endl;
+            all_ok = false;
+            continue;
+        }
+        file->input = input;
+        file->output = outputPath(options, input);
+        file->hops = file->wav.buffers();
+        file->chunkHops = std::max<uint64_t>(1, static_cast<uint64_t>(options.chunkSeconds) * file->wav.sampleRate() / BUFFER_FRAMES);
+        // An empty file still gets an output with just the header
+        file->chunks = static_cast<int>(std::max<uint64_t>(1, (file->hops + file->chunkHops - 1) / file->chunkHops));
+        audio_seconds += static_cast<double>(file->wav.frames()) / file->wav.sampleRate();
+        for (int chunk = 0; chunk < file->chunks; ++chunk) work.emplace_back(files.size(), chunk);
+        files.push_back(std::move(file));
+    }
+
+    int jobs = options.jobs > 0 ? options.jobs : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    jobs = std::min<int>(jobs, std::max<size_t>(1, work.size()));
+    std::atomic<size_t> next_work{0};
+    auto worker = [&]() {
+        for (size_t item = next_work++; item < work.size(); item = next_work++) {
+            BatchFile& file = *files[work[item].first];
+            {
+                std::lock_guard<std::mutex> lock(file.mutex);
+                if (file.failed) continue;
+            }
+            finishChunk(file, work[item].second, analyzeChunk(file, work[item].second, options.format), options);
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < jobs; ++i) workers.emplace_back(worker);
+    worker();
+    for (std::thread& thread : workers) thread.join();
+
+    int written = 0;
+    for (const auto& file : files) {
+        if (file->failed) all_ok = false;
+        else ++written;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    char summary[160];
+    snprintf(summary, sizeof(summary), "Analyzed %d file%s, %.1f s of audio in %.2f s (%.0fx real time, %d thread%s)",
+             written, written == 1 ? "" : "s", audio_seconds, elapsed, elapsed > 0.0 ? audio_seconds / elapsed : 0.0,
+             jobs, jobs == 1 ? "" : "s");
+    std::cerr << summary << std::endl;
+    return all_ok ? 0 : 1;
+}
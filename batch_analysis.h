@@ -0,0 +1,49 @@
+#ifndef BATCH_ANALYSIS_H
+#define BATCH_ANALYSIS_H
+
+#include <string>
+#include <vector>
+
+enum class FeatureFormat {
+    CSV,    // One header line, then one line per hop
+    BINARY  // See below
+};
+
+// Binary feature files, all little-endian. A 32-byte header:
+//   char magic[4] "MLFT", u16 version (1), u16 header size (32),
+//   u32 sample rate, u16 frames per hop (BUFFER_FRAMES), u16 bands per channel,
+//   u16 record size, u16 channels in the file, u64 hop count, u32 reserved
+// then one record per hop: u16 rms[2], u16 peak[2], u8 bands[2][bands] in
+// the network stream's quantization (see QuantizedFrame), u8 onset (0 or 1),
+// i16 momentary loudness in hundredths of a LUFS (-32768 for silence).
+const char FEATURE_FILE_MAGIC[4] = {'M', 'L', 'F', 'T'};
+const int FEATURE_FILE_VERSION = 1;
+
+/**
+ * @brief Settings of the offline analysis, taken from the command line.
+ */
+struct BatchOptions {
+    std::vector<std::string> inputs;  // WAVE files
+    std::string outputDir;            // Empty: each output goes next to its input
+    FeatureFormat format = FeatureFormat::CSV;
+    int jobs = 0;                     // Worker threads; 0 for one per core
+    int chunkSeconds = 30;            // Files are split into chunks of this much audio
+};
+
+/**
+ * @brief Analyzes audio files as fast as the cores allow, writing features per hop.
+ *
+ * Every hop of BUFFER_FRAMES frames gets what the live pipeline computes:
+ * the published levels and bands of the stereo downmix, the expression
+ * shapes' beat detector as onsets, and the channel meter's momentary
+ * loudness of all channels. Each file is split into chunks, and the
+ * chunks of all files are shared out to the worker threads. A chunk starts
+ * its analysis a second early and throws that second away, so the
+ * loudness window and the onset average are already full when it starts.
+ * Chunks are written in order as they finish. Output goes to
+ * "<input>.features.csv" or ".features.bin". Returns the exit code: 1 if any
+ * file failed.
+ */
+int runBatchAnalysis(const BatchOptions& options);
+
+#endif // BATCH_ANALYSIS_H
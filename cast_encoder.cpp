@@ -0,0 +1,158 @@
+#include "cast_encoder.h"
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+// Unchanged cells up to this many are rewritten rather than jumped over with a cursor move
+const int MAX_REWRITE_GAP = 4;
+const chtype UNKNOWN_CELL = ~static_cast<chtype>(0);
+
+void appendUtf8(std::string& out, unsigned code) {
+    if (code < 0x80) {
+        out.push_back(static_cast<char>(code));
+    } else if (code < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+    }
+}
+
+// What a VT100 line-drawing character looks like in Unicode
+unsigned lineDrawing(char c) {
+    switch (c) {
+        case 'a': return 0x2592;  // ACS_CKBOARD
+        case 'h': return 0x2591;  // ACS_BOARD
+        case '0': return 0x2588;  // ACS_BLOCK
+        case '`': return 0x25C6;  // ACS_DIAMOND
+        case '~': return 0x00B7;  // ACS_BULLET
+        case 'f': return 0x00B0;  // ACS_DEGREE
+        case 'g': return 0x00B1;  // ACS_PLMINUS
+        case 'q': return 0x2500;  // ACS_HLINE
+        case 'x': return 0x2502;  // ACS_VLINE
+        case 'l': return 0x250C;
+        case 'k': return 0x2510;
+        case 'm': return 0x2514;
+        case 'j': return 0x2518;
+        case 't': return 0x251C;
+        case 'u': return 0x2524;
+        case 'v': return 0x2534;
+        case 'w': return 0x252C;
+        case 'n': return 0x253C;
+        default: return '#';
+    }
+}
+
+void appendColor(std::string& out, short color, bool foreground) {
+    if (color < 0) out += foreground ? ";39" : ";49";
+    else if (color < 8) out += ";" + std::to_string((foreground ? 30 : 40) + color);
+    else if (color < 16) out += ";" + std::to_string((foreground ? 90 : 100) + color - 8);
+    else out += (foreground ? ";38;5;" : ";48;5;") + std::to_string(color);
+}
+
+} // namespace
+
+CastEncoder::CastEncoder(int width, int height) : grid_width(width), grid_height(height) {
+    refreshColors();
+}
+
+void CastEncoder::keyframe() {
+    previous.assign(static_cast<size_t>(grid_width) * grid_height, UNKNOWN_CELL);
+    style = UNKNOWN_CELL;
+    cursor_x = cursor_y = -1;
+}
+
+void CastEncoder::refreshColors() {
+    int pairs = std::min(COLOR_PAIRS, 256);
+    pair_colors.assign(std::max(1, pairs), {-1, -1});
+    for (int pair = 1; pair < pairs; ++pair) pair_content(pair, &pair_colors[pair].first, &pair_colors[pair].second);
+    keyframe();
+}
+
+void CastEncoder::encode(WINDOW* grid, double time, std::string& out) {
+    text.clear();
+    int rows, columns;
+    getmaxyx(grid, rows, columns);
+    for (int y = 0; y < grid_height; ++y) {
+        chtype* row = &previous[static_cast<size_t>(y) * grid_width];
+        for (int x = 0; x < grid_width; ++x) {
+            // Outside the window is blank, so a grid smaller than the encoder still encodes
+            chtype cell = y < rows && x < columns ? mvwinch(grid, y, x) : static_cast<chtype>(' ');
+            if (cell == row[x]) continue;
+            if (cursor_y != y || cursor_x > x || x - cursor_x > MAX_REWRITE_GAP) {
+                text += "\x1b[" + std::to_string(y + 1) + ";" + std::to_string(x + 1) + "H";
+            } else {
+                for (int gap = cursor_x; gap < x; ++gap) writeCell(row[gap]);
+            }
+            writeCell(cell);
+            row[x] = cell;
+            cursor_x = x + 1;
+            cursor_y = y;
+            // Past the last column the cursor waits to wrap; never write from there
+            if (cursor_x >= grid_width) cursor_y = -1;
+        }
+    }
+    if (!text.empty()) appendCastEvent(out, time, text);
+}
+
+void CastEncoder::writeCell(chtype cell) {
+    chtype cell_style = cell & (A_ATTRIBUTES & ~A_ALTCHARSET);
+    if (cell_style != style) {
+        text += "\x1b[0";
+        if (cell & A_BOLD) text += ";1";
+        if (cell & A_DIM) text += ";2";
+        if (cell & A_REVERSE) text += ";7";
+        size_t pair = PAIR_NUMBER(cell);
+        std::pair<short, short> colors(-1, -1);
+        if (pair < pair_colors.size()) colors = pair_colors[pair];
+        appendColor(text, colors.first, true);
+        appendColor(text, colors.second, false);
+        text += "m";
+        style = cell_style;
+    }
+    char c = static_cast<char>(cell & A_CHARTEXT);
+    unsigned char byte = static_cast<unsigned char>(c);
+    if (cell & A_ALTCHARSET) appendUtf8(text, lineDrawing(c));
+    else if (byte < 0x20 || byte == 0x7F) text.push_back(' ');
+    else appendUtf8(text, byte);  // Latin-1 above 0x7F
+}
+
+void appendJsonString(std::string& out, const std::string& text) {
+    out.push_back('"');
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (byte < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", byte);
+            out += escaped;
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+}
+
+std::string castHeader(int width, int height, const std::string& title) {
+    std::string header = "{\"version\": 2, \"width\": " + std::to_string(width) +
+                         ", \"height\": " + std::to_string(height) +
+                         ", \"timestamp\": " + std::to_string(static_cast<long long>(std::time(nullptr))) +
+                         ", \"title\": ";
+    appendJsonString(header, title);
+    header += ", \"env\": {\"TERM\": \"xterm-256color\"}}\n";
+    return header;
+}
+
+void appendCastEvent(std::string& out, double time, const std::string& text) {
+    char stamp[32];
+    snprintf(stamp, sizeof(stamp), "[%.6f, \"o\", ", time);
+    out += stamp;
+    appendJsonString(out, text);
+    out += "]\n";
+}
@@ -0,0 +1,53 @@
+#ifndef CAST_ENCODER_H
+#define CAST_ENCODER_H
+
+#include <ncurses.h>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Turns successive frames of a curses cell grid into asciicast v2 output events.
+ *
+ * Only cells that differ from the previous frame are written; the cursor
+ * position and the colors in force are tracked so that neither is sent
+ * again while it is still right. Color pairs are looked up once, so call
+ * refreshColors() after init_pair() changes them.
+ */
+class CastEncoder {
+public:
+    CastEncoder(int width, int height);
+
+    int width() const { return grid_width; }
+    int height() const { return grid_height; }
+
+    // Forgets the previous frame and the terminal state: the next frame is written whole
+    void keyframe();
+
+    // Reads the color pairs again, and writes the next frame whole
+    void refreshColors();
+
+    // Appends one event line with the changes since the last frame, or nothing if there are none
+    void encode(WINDOW* grid, double time, std::string& out);
+
+private:
+    int grid_width, grid_height;
+    std::vector<chtype> previous;
+    std::vector<std::pair<short, short>> pair_colors;
+    chtype style;
+    int cursor_x, cursor_y;
+    std::string text;
+
+    void writeCell(chtype cell);
+};
+
+// Appends text as a JSON string literal, quotes included
+void appendJsonString(std::string& out, const std::string& text);
+
+// The header line of a recording of the given size
+std::string castHeader(int width, int height, const std::string& title);
+
+// Appends an event line that writes text as it is
+void appendCastEvent(std::string& out, double time, const std::string& text);
+
+#endif // CAST_ENCODER_H
@@ -0,0 +1,216 @@
+#include "cast_recorder.h"
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+// Minutes of a busy screen; only a stalled disk fills it
+const size_t QUEUE_BYTES = 8 << 20;
+const size_t RECORD_PREFIX_BYTES = 5;  // u32 payload size, u8 kind
+const uint8_t RECORD_EVENTS = 0;       // Event lines for the current file
+const uint8_t RECORD_NEW_FILE = 1;     // The header of a new file; the current one is rotated away
+const auto WRITER_IDLE = std::chrono::milliseconds(10);
+
+// "rec.cast" -> "rec.2.cast"
+std::string rotatedPath(const std::string& path, int generation) {
+    return path.substr(0, path.size() - 5) + "." + std::to_string(generation) + ".cast";
+}
+
+// Shifts every older file up one generation, dropping the one past the count kept
+void rotateFiles(const std::string& path, int files) {
+    if (files <= 1) return;  // The current file is simply started over
+    std::remove(rotatedPath(path, files - 1).c_str());
+    for (int generation = files - 2; generation >= 1; --generation) {
+        std::rename(rotatedPath(path, generation).c_str(), rotatedPath(path, generation + 1).c_str());
+    }
+    std::rename(path.c_str(), rotatedPath(path, 1).c_str());
+}
+
+} // namespace
+
+SpscByteQueue::SpscByteQueue(size_t capacity) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    buffer.resize(size);
+    mask = size - 1;
+}
+
+void SpscByteQueue::copyIn(uint64_t position, const void* data, size_t size) {
+    const size_t offset = position & mask;
+    const size_t first = std::min(size, buffer.size() - offset);
+    std::memcpy(&buffer[offset], data, first);
+    std::memcpy(&buffer[0], static_cast<const char*>(data) + first, size - first);
+}
+
+void SpscByteQueue::copyOut(uint64_t position, void* data, size_t size) const {
+    const size_t offset = position & mask;
+    const size_t first = std::min(size, buffer.size() - offset);
+    std::memcpy(data, &buffer[offset], first);
+    std::memcpy(static_cast<char*>(data) + first, &buffer[0], size - first);
+}
+
+bool SpscByteQueue::push(uint8_t kind, const std::string& payload) {
+    const uint64_t h = head.load(std::memory_order_relaxed);
+    const uint64_t t = tail.load(std::memory_order_acquire);
+    const uint64_t size = RECORD_PREFIX_BYTES + payload.size();
+    if (size > buffer.size() - (h - t)) return false;
+    char prefix[RECORD_PREFIX_BYTES];
+    const uint32_t length = static_cast<uint32_t>(payload.size());
+    std::memcpy(prefix, &length, sizeof(length));
+    prefix[4] = static_cast<char>(kind);
+    copyIn(h, prefix, sizeof(prefix));
+    copyIn(h + sizeof(prefix), payload.data(), payload.size());
+    head.store(h + size, std::memory_order_release);
+    return true;
+}
+
+bool SpscByteQueue::pop(uint8_t& kind, std::string& payload) {
+    const uint64_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) return false;
+    char prefix[RECORD_PREFIX_BYTES];
+    copyOut(t, prefix, sizeof(prefix));
+    uint32_t length;
+    std::memcpy(&length, prefix, sizeof(length));
+    kind = static_cast<uint8_t>(prefix[4]);
+    payload.resize(length);
+    copyOut(t + sizeof(prefix), &payload[0], length);
+    tail.store(t + sizeof(prefix) + length, std::memory_order_release);
+    return true;
+}
+
+CastRecorder::CastRecorder(const CastRecordOptions& options) : options(options) {}
+
+CastRecorder::~CastRecorder() {
+    stop();
+}
+
+void CastRecorder::start() {
+    if (recording()) return;
+    if (!queue) queue = std::make_unique<SpscByteQueue>(QUEUE_BYTES);
+    char stamp[32];
+    std::time_t now = std::time(nullptr);
+    struct tm local;
+    localtime_r(&now, &local);
+    std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &local);
+    const std::string base = options.directory + "/oscilloscope-" + stamp;
+    current_path = base + ".cast";
+    for (int n = 2; access(current_path.c_str(), F_OK) == 0; ++n) current_path = base + "-" + std::to_string(n) + ".cast";
+
+    stop_requested.store(false);
+    writer_failed.store(false);
+    writer_error.clear();
+    bytes_written.store(0);
+    encoder.reset();
+    need_new_file = true;
+    dropped_frames = 0;
+    avg_overhead_us = 0.0f;
+    writer = std::thread(&CastRecorder::writerLoop, this, current_path);
+}
+
+void CastRecorder::stop() {
+    if (!recording()) return;
+    if (encoder && !need_new_file) {
+        // Leave the player's terminal as we found it
+        events.clear();
+        appendCastEvent(events, std::chrono::duration<double>(std::chrono::steady_clock::now() - file_start).count(),
+                        "\x1b[0m\x1b[?25h");
+        queue->push(RECORD_EVENTS, events);
+    }
+    stop_requested.store(true, std::memory_order_release);
+    writer.join();
+    encoder.reset();
+}
+
+void CastRecorder::colorsChanged() {
+    if (encoder) encoder->refreshColors();
+}
+
+bool CastRecorder::beginFile(int width, int height, std::chrono::steady_clock::time_point now) {
+    std::string header = castHeader(width, height, "oscilloscope");
+    appendCastEvent(header, 0.0, "\x1b[?25l\x1b[0m\x1b[2J");
+    if (!queue->push(RECORD_NEW_FILE, header)) return false;
+    if (encoder && encoder->width() == width && encoder->height() == height) encoder->keyframe();
+    else encoder = std::make_unique<CastEncoder>(width, height);
+    file_start = now;
+    file_bytes = header.size();
+    need_new_file = false;
+    return true;
+}
+
+void CastRecorder::capture(WINDOW* screen) {
+    if (!recording()) return;
+    using namespace std::chrono;
+    const auto begin = steady_clock::now();
+    int rows, columns;
+    getmaxyx(screen, rows, columns);
+    const uint64_t limit = static_cast<uint64_t>(options.fileMegabytes) << 20;
+    if (!need_new_file && (columns != encoder->width() || rows != encoder->height() || file_bytes >= limit)) {
+        need_new_file = true;
+    }
+    if (!need_new_file || beginFile(columns, rows, begin)) {
+        events.clear();
+        encoder->encode(screen, duration<double>(begin - file_start).count(), events);
+        if (events.empty()) {
+            // Nothing changed on screen
+        } else if (queue->push(RECORD_EVENTS, events)) {
+            file_bytes += events.size();
+        } else {
+            // The encoder thinks these cells were sent: send everything next time
+            ++dropped_frames;
+            encoder->keyframe();
+        }
+    } else {
+        ++dropped_frames;
+    }
+    const float elapsed_us = duration<float, std::micro>(steady_clock::now() - begin).count();
+    avg_overhead_us = avg_overhead_us == 0.0f ? elapsed_us : avg_overhead_us * 0.95f + elapsed_us * 0.05f;
+}
+
+void CastRecorder::writerLoop(std::string path) {
+    FILE* file = nullptr;
+    std::string record;
+    uint8_t kind;
+    auto fail = [&](const std::string& what) {
+        writer_error = what + ": " + std::strerror(errno);
+        if (file) std::fclose(file);
+        file = nullptr;
+        writer_failed.store(true, std::memory_order_release);
+    };
+    while (true) {
+        // Read before popping: whatever was pushed before stop() is then still drained
+        const bool stopping = stop_requested.load(std::memory_order_acquire);
+        if (queue->pop(kind, record)) {
+            if (writer_failed.load(std::memory_order_relaxed)) continue;
+            if (kind == RECORD_NEW_FILE) {
+                if (file) {
+                    std::fclose(file);
+                    rotateFiles(path, options.files);
+                }
+                file = std::fopen(path.c_str(), "wb");
+                if (!file) {
+                    fail("Cannot write " + path);
+                    continue;
+                }
+            }
+            if (!file) continue;
+            if (std::fwrite(record.data(), 1, record.size(), file) != record.size()) {
+                fail("Cannot write " + path);
+                continue;
+            }
+            bytes_written.fetch_add(record.size(), std::memory_order_relaxed);
+            continue;
+        }
+        // Idle: let a player following the file see what we have
+        if (file) std::fflush(file);
+        if (stopping) break;
+        std::this_thread::sleep_for(WRITER_IDLE);
+    }
+    if (file && std::fclose(file) != 0 && !writer_failed.load(std::memory_order_relaxed)) {
+        writer_error = "Cannot write " + path + ": " + std::strerror(errno);
+        writer_failed.store(true, std::memory_order_release);
+    }
+}
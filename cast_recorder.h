@@ -0,0 +1,109 @@
+#ifndef CAST_RECORDER_H
+#define CAST_RECORDER_H
+
+#include <ncurses.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "cast_encoder.h"
+
+/**
+ * @brief Settings of the live recording, taken from the command line.
+ */
+struct CastRecordOptions {
+    std::string directory = ".";  // --record-dir: where recordings are written
+    bool startNow = false;        // --record: start recording with the first frame
+    int fileMegabytes = 32;       // --record-limit: a file is rotated once it holds this much
+    int files = 4;                // --record-files: files kept per recording, the current one included
+};
+
+/**
+ * @brief Single-producer single-consumer queue of variable-sized records in one byte ring.
+ *
+ * Each record is a kind byte and a payload. Neither side ever waits: push
+ * fails when the record does not fit and pop when there is none.
+ */
+class SpscByteQueue {
+public:
+    // Capacity is rounded up to a power of two
+    explicit SpscByteQueue(size_t capacity);
+
+    bool push(uint8_t kind, const std::string& payload);
+    bool pop(uint8_t& kind, std::string& payload);
+
+private:
+    std::vector<char> buffer;
+    uint64_t mask;
+    alignas(64) std::atomic<uint64_t> head{0};  // Next byte the producer writes
+    alignas(64) std::atomic<uint64_t> tail{0};  // Next byte the consumer reads
+
+    void copyIn(uint64_t position, const void* data, size_t size);
+    void copyOut(uint64_t position, void* data, size_t size) const;
+};
+
+/**
+ * @brief Records what the terminal shows into asciicast v2 files, off the render thread.
+ *
+ * After each flush the render loop hands over the screen; the changed
+ * cells are encoded as one event and queued through a lock-free ring to a
+ * writer thread, which alone touches the disk. If the writer falls so far
+ * behind that the ring is full, the frame is dropped and the next one is
+ * sent whole. A file that reaches the size limit, or a terminal resize,
+ * starts a new file from a full frame; older files are shifted to
+ * NAME.1.cast, NAME.2.cast and so on, and the oldest beyond the count kept
+ * is deleted. The time spent on the render thread is measured per frame.
+ */
+class CastRecorder {
+public:
+    explicit CastRecorder(const CastRecordOptions& options);
+    ~CastRecorder();
+
+    // Starts a new recording, named after the current time
+    void start();
+    // Writes out what is queued and closes the file
+    void stop();
+    bool recording() const { return writer.joinable(); }
+    const std::string& path() const { return current_path; }
+
+    // Call after every doupdate() with the screen as it now is (curscr)
+    void capture(WINDOW* screen);
+    // Call after init_pair() changed what a pair looks like
+    void colorsChanged();
+
+    // The writer's error, once it failed; the recording should then be stopped
+    bool failed() const { return writer_failed.load(std::memory_order_acquire); }
+    const std::string& error() const { return writer_error; }
+
+    uint64_t bytesWritten() const { return bytes_written.load(std::memory_order_relaxed); }
+    uint64_t droppedFrames() const { return dropped_frames; }
+    // Average time capture() takes on the render thread
+    float overheadMs() const { return avg_overhead_us / 1000.0f; }
+
+private:
+    CastRecordOptions options;
+    std::unique_ptr<SpscByteQueue> queue;
+    std::thread writer;
+    std::atomic<bool> stop_requested{false};
+    std::atomic<bool> writer_failed{false};
+    std::string writer_error;
+    std::atomic<uint64_t> bytes_written{0};
+
+    // Render thread only
+    std::string current_path;
+    std::unique_ptr<CastEncoder> encoder;
+    std::string events;
+    std::chrono::steady_clock::time_point file_start;
+    uint64_t file_bytes = 0;
+    bool need_new_file = true;
+    uint64_t dropped_frames = 0;
+    float avg_overhead_us = 0.0f;
+
+    bool beginFile(int width, int height, std::chrono::steady_clock::time_point now);
+    void writerLoop(std::string path);
+};
+
+#endif // CAST_RECORDER_H
@@ -0,0 +1,226 @@
+#include "cast_render.h"
+#include "cast_encoder.h"
+#include "wav_file.h"
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Long enough for the peaks to fall and the particles to die that were there before
+const double WARMUP_SECONDS = 2.0;
+
+/**
+ * @brief A curses screen that writes to /dev/null, so pads can be drawn without a terminal.
+ */
+class HeadlessScreen {
+public:
+    bool open(std::string& error) {
+        out = std::fopen("/dev/null", "w");
+        in = std::fopen("/dev/null", "r");
+        if (!out || !in) {
+            error = std::string("Cannot open /dev/null: ") + std::strerror(errno);
+            return false;
+        }
+        // The recording says xterm-256color, so draw with its capabilities
+        for (const char* term : {"xterm-256color", "xterm"}) {
+            screen = newterm(term, out, in);
+            if (screen) break;
+        }
+        if (!screen) {
+            error = "No terminfo entry for xterm-256color or xterm";
+            return false;
+        }
+        set_term(screen);
+        return true;
+    }
+
+    ~HeadlessScreen() {
+        if (screen) {
+            endwin();
+            delscreen(screen);
+        }
+        if (out) std::fclose(out);
+        if (in) std::fclose(in);
+    }
+
+private:
+    FILE* out = nullptr;
+    FILE* in = nullptr;
+    SCREEN* screen = nullptr;
+};
+
+/**
+ * @brief Draws frames [first - warm-up, last) and encodes [first, last).
+ */
+void renderSegment(const WavFile& wav, const CastOptions& options, const CastBufferMeter& measure,
+                   const CastFrameDrawer& draw, WINDOW* grid, CastEncoder& encoder, int64_t first, int64_t last,
+                   int64_t warmup, std::string& out) {
+    ChannelBuffers channels;
+    int16_t left[BUFFER_FRAMES] = {0};
+    int16_t right[BUFFER_FRAMES] = {0};
+    bool loaded = false;  // Whether the arrays hold the buffer to draw
+    const int64_t start = std::max<int64_t>(0, first - warmup);
+    auto bufferOf = [&](int64_t frame) {
+        return static_cast<uint64_t>(static_cast<double>(frame) * wav.sampleRate() / options.fps) / BUFFER_FRAMES;
+    };
+    // Without a warm-up the segment carries on from the one before, which measured up to its last frame's buffer
+    uint64_t next_buffer = warmup == 0 && start > 0 ? bufferOf(start - 1) + 1 : bufferOf(start);
+    for (int64_t frame = start; frame < last; ++frame) {
+        // Each frame shows the buffer playing at its time, as the live loop does, and
+        // every buffer up to it is measured, as the live loop measures every captured one
+        const uint64_t buffer = bufferOf(frame);
+        for (; next_buffer <= buffer; ++next_buffer) {
+            wav.readBuffer(next_buffer, channels);
+            downmixStereo(channels, left, right);
+            measure(channels, left, right, wav.sampleRate());
+            loaded = true;
+        }
+        // The segment before measured this frame's buffer already; read it again only to draw it
+        if (!loaded) {
+            wav.readBuffer(buffer, channels);
+            downmixStereo(channels, left, right);
+            loaded = true;
+        }
+        const double time = static_cast<double>(frame) / options.fps;
+        werase(grid);
+        draw(grid, options.width, options.height, channels, left, right, wav.sampleRate(), time);
+        if (frame >= first) encoder.encode(grid, time, out);
+    }
+}
+
+bool writeAll(FILE* file, const std::string& data) {
+    return std::fwrite(data.data(), 1, data.size(), file) == data.size();
+}
+
+bool appendFile(FILE* out, const std::string& path) {
+    FILE* in = std::fopen(path.c_str(), "rb");
+    if (!in) return false;
+    char buffer[1 << 16];
+    size_t n;
+    bool ok = true;
+    while (ok && (n = std::fread(buffer, 1, sizeof(buffer), in)) > 0) ok = std::fwrite(buffer, 1, n, out) == n;
+    std::fclose(in);
+    return ok;
+}
+
+} // namespace
+
+int runCastRender(const CastOptions& options, const std::string& title, const CastSetup& setup,
+                  const CastBufferMeter& measure, const CastFrameDrawer& draw) {
+    auto start = std::chrono::steady_clock::now();
+    WavFile wav;
+    std::string error;
+    if (!wav.open(options.input, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    const std::string output = options.output.empty() ? options.input + ".cast" : options.output;
+    const double seconds = static_cast<double>(wav.frames()) / wav.sampleRate();
+    const int64_t total_frames = static_cast<int64_t>(std::ceil(seconds * options.fps));
+    const int64_t segment_frames = std::max<int64_t>(1, static_cast<int64_t>(options.chunkSeconds) * options.fps);
+    const int64_t segments = std::max<int64_t>(1, (total_frames + segment_frames - 1) / segment_frames);
+    const int64_t warmup = static_cast<int64_t>(WARMUP_SECONDS * options.fps);
+    int jobs = options.jobs > 0 ? options.jobs : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    jobs = static_cast<int>(std::min<int64_t>(jobs, segments));
+
+    HeadlessScreen screen;
+    if (!screen.open(error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    setup(options.width, options.height);
+    WINDOW* grid = newpad(options.height, options.width);
+    if (!grid) {
+        std::cerr << "Error: cannot make a " << options.width << "x" << options.height << " grid" << std::endl;
+        return 1;
+    }
+
+    FILE* out = std::fopen(output.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: cannot write " << output << ": " << std::strerror(errno) << std::endl;
+        delwin(grid);
+        return 1;
+    }
+    std::string header = castHeader(options.width, options.height, title);
+    // Start from a clear screen with the cursor hidden
+    appendCastEvent(header, 0.0, "\x1b[?25l\x1b[0m\x1b[2J");
+    bool ok = writeAll(out, header);
+
+    CastEncoder encoder(options.width, options.height);
+    auto partPath = [&](int64_t segment) { return output + ".part" + std::to_string(segment); };
+    if (jobs <= 1) {
+        // One straight run needs no warm-up and no keyframes
+        std::string events;
+        for (int64_t segment = 0; ok && segment < segments; ++segment) {
+            events.clear();
+            renderSegment(wav, options, measure, draw, grid, encoder, segment * segment_frames,
+                          std::min(total_frames, (segment + 1) * segment_frames), 0, events);
+            ok = writeAll(out, events);
+        }
+    } else {
+        // A process per segment, each starting from the state set up above; at most `jobs` at once
+        std::fflush(nullptr);
+        std::vector<pid_t> running;
+        for (int64_t segment = 0; ok && segment < segments; ++segment) {
+            if (static_cast<int>(running.size()) == jobs) {
+                int status;
+                pid_t done = waitpid(-1, &status, 0);
+                running.erase(std::remove(running.begin(), running.end(), done), running.end());
+                ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+            }
+            if (!ok) break;
+            pid_t pid = fork();
+            if (pid == 0) {
+                std::string events;
+                renderSegment(wav, options, measure, draw, grid, encoder, segment * segment_frames,
+                              std::min(total_frames, (segment + 1) * segment_frames), warmup, events);
+                FILE* part = std::fopen(partPath(segment).c_str(), "wb");
+                bool written = part && writeAll(part, events);
+                if (part) written = std::fclose(part) == 0 && written;
+                _exit(written ? 0 : 1);
+            }
+            if (pid < 0) {
+                error = std::string("fork: ") + std::strerror(errno);
+                ok = false;
+                break;
+            }
+            running.push_back(pid);
+        }
+        for (pid_t pid : running) {
+            int status;
+            waitpid(pid, &status, 0);
+            ok = ok && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        }
+        for (int64_t segment = 0; segment < segments; ++segment) {
+            if (ok) ok = appendFile(out, partPath(segment));
+            std::remove(partPath(segment).c_str());
+        }
+    }
+    delwin(grid);
+
+    std::string closing;
+    appendCastEvent(closing, static_cast<double>(total_frames) / options.fps, "\x1b[0m\x1b[?25h");
+    ok = ok && writeAll(out, closing);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Error: rendering " << output << " failed" << (error.empty() ? "" : ": " + error) << std::endl;
+        return 1;
+    }
+
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    char summary[160];
+    snprintf(summary, sizeof(summary), "Rendered %lld frames (%.1f s) at %dx%d in %.2f s (%.0fx real time, %d process%s)",
+             static_cast<long long>(total_frames), seconds, options.width, options.height, elapsed,
+             elapsed > 0.0 ? seconds / elapsed : 0.0, jobs, jobs == 1 ? "" : "es");
+    std::cerr << summary << std::endl;
+    return 0;
+}
@@ -0,0 +1,50 @@
+#ifndef CAST_RENDER_H
+#define CAST_RENDER_H
+
+#include <ncurses.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include "channel_ring.h"
+
+/**
+ * @brief Settings of the offline asciicast render, taken from the command line.
+ */
+struct CastOptions {
+    std::string input;      // --render: the WAVE file to render
+    std::string output;     // --cast-out: empty for "<input>.cast"
+    std::string mode;       // --mode: name or index; empty for the first mode
+    int width = 100;        // --size WIDTHxHEIGHT, in cells
+    int height = 30;
+    int fps = 60;
+    int jobs = 0;           // Worker processes; 0 for one per core
+    int chunkSeconds = 30;  // Length of the segments the work is split into
+};
+
+// Sets up colors and mode state once the headless screen exists
+using CastSetup = std::function<void(int width, int height)>;
+// Measures one buffer: every channel, their stereo downmix and the rate; every buffer of the file goes through it
+using CastBufferMeter = std::function<void(const ChannelBuffers& channels, const int16_t* left, const int16_t* right,
+                                           uint32_t sampleRate)>;
+// Draws one frame: every channel of one buffer, their stereo downmix, the rate and the frame's time in the file
+using CastFrameDrawer = std::function<void(WINDOW* win, int width, int height, const ChannelBuffers& channels,
+                                           const int16_t* left, const int16_t* right, uint32_t sampleRate,
+                                           double time)>;
+
+/**
+ * @brief Renders a mode for an audio file into an asciicast v2 recording, without a terminal.
+ *
+ * Frames are drawn by the same code as on screen, into a curses pad on a
+ * screen whose output goes nowhere; the pad is the cell grid. Each frame is
+ * compared with the one before and only the cells that changed are written,
+ * as one "o" event per frame. The recording is split into segments that
+ * worker processes render side by side (curses and the mode state are
+ * per process). Each segment first draws two seconds before its start
+ * without writing them, so decays and particles are where a straight run
+ * would have them, and then writes its first frame whole.
+ * Returns the exit code.
+ */
+int runCastRender(const CastOptions& options, const std::string& title, const CastSetup& setup,
+                  const CastBufferMeter& measure, const CastFrameDrawer& draw);
+
+#endif // CAST_RENDER_H
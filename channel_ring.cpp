@@ -0,0 +1,178 @@
+#include "channel_ring.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const float MINUS_3DB = 0.70710678f;
+
+// Share of each position in the left and right downmix
+struct DownmixGain {
+    float left;
+    float right;
+};
+
+DownmixGain downmixGain(ChannelPosition position) {
+    switch (position) {
+        case ChannelPosition::MONO: return {1.0f, 1.0f};
+        case ChannelPosition::FRONT_LEFT: return {1.0f, 0.0f};
+        case ChannelPosition::FRONT_RIGHT: return {0.0f, 1.0f};
+        case ChannelPosition::FRONT_CENTER:
+        case ChannelPosition::REAR_CENTER: return {MINUS_3DB, MINUS_3DB};
+        case ChannelPosition::REAR_LEFT:
+        case ChannelPosition::SIDE_LEFT: return {MINUS_3DB, 0.0f};
+        case ChannelPosition::REAR_RIGHT:
+        case ChannelPosition::SIDE_RIGHT: return {0.0f, MINUS_3DB};
+        default: return {0.0f, 0.0f};  // LFE and positions we do not know
+    }
+}
+
+// GCC's cost model at -O2 turns down the strided loads; these few loops are worth it
+#if defined(__GNUC__) && !defined(__clang__)
+#define VECTORIZE_LOOPS __attribute__((optimize("vect-cost-model=dynamic")))
+#else
+#define VECTORIZE_LOOPS
+#endif
+
+template <int CHANNELS>
+VECTORIZE_LOOPS void deinterleaveFixed(const int16_t* __restrict in, ChannelBuffers& __restrict out) {
+    for (int c = 0; c < CHANNELS; ++c) {
+        int16_t* __restrict dest = out.data[c];
+        const int16_t* source = in + c;
+        for (int i = 0; i < BUFFER_FRAMES; ++i) dest[i] = source[i * CHANNELS];
+    }
+}
+
+#ifdef __SSE2__
+// Eight frames of 7.1 are an 8x8 matrix of samples: transpose it in registers
+template <>
+void deinterleaveFixed<8>(const int16_t* __restrict in, ChannelBuffers& __restrict out) {
+    static_assert(BUFFER_FRAMES % 8 == 0, "7.1 deinterleave works on blocks of eight frames");
+    for (int i = 0; i < BUFFER_FRAMES; i += 8) {
+        const __m128i* src = reinterpret_cast<const __m128i*>(in + i * 8);
+        __m128i a0 = _mm_loadu_si128(src + 0), a1 = _mm_loadu_si128(src + 1);
+        __m128i a2 = _mm_loadu_si128(src + 2), a3 = _mm_loadu_si128(src + 3);
+        __m128i a4 = _mm_loadu_si128(src + 4), a5 = _mm_loadu_si128(src + 5);
+        __m128i a6 = _mm_loadu_si128(src + 6), a7 = _mm_loadu_si128(src + 7);
+        __m128i b0 = _mm_unpacklo_epi16(a0, a1), b1 = _mm_unpackhi_epi16(a0, a1);
+        __m128i b2 = _mm_unpacklo_epi16(a2, a3), b3 = _mm_unpackhi_epi16(a2, a3);
+        __m128i b4 = _mm_unpacklo_epi16(a4, a5), b5 = _mm_unpackhi_epi16(a4, a5);
+        __m128i b6 = _mm_unpacklo_epi16(a6, a7), b7 = _mm_unpackhi_epi16(a6, a7);
+        __m128i c0 = _mm_unpacklo_epi32(b0, b2), c1 = _mm_unpackhi_epi32(b0, b2);
+        __m128i c2 = _mm_unpacklo_epi32(b1, b3), c3 = _mm_unpackhi_epi32(b1, b3);
+        __m128i c4 = _mm_unpacklo_epi32(b4, b6), c5 = _mm_unpackhi_epi32(b4, b6);
+        __m128i c6 = _mm_unpacklo_epi32(b5, b7), c7 = _mm_unpackhi_epi32(b5, b7);
+        const __m128i rows[8] = {_mm_unpacklo_epi64(c0, c4), _mm_unpackhi_epi64(c0, c4),
+                                 _mm_unpacklo_epi64(c1, c5), _mm_unpackhi_epi64(c1, c5),
+                                 _mm_unpacklo_epi64(c2, c6), _mm_unpackhi_epi64(c2, c6),
+                                 _mm_unpacklo_epi64(c3, c7), _mm_unpackhi_epi64(c3, c7)};
+        for (int c = 0; c < 8; ++c) _mm_storeu_si128(reinterpret_cast<__m128i*>(out.data[c] + i), rows[c]);
+    }
+}
+#endif
+
+int16_t clip(float value) {
+    return static_cast<int16_t>(std::max(-32768.0f, std::min(32767.0f, value)));
+}
+
+} // namespace
+
+ChannelMap ChannelMap::standard(int channels) {
+    using P = ChannelPosition;
+    static const P layouts[MAX_CHANNELS][MAX_CHANNELS] = {
+        {P::MONO},
+        {P::FRONT_LEFT, P::FRONT_RIGHT},
+        {P::FRONT_LEFT, P::FRONT_RIGHT, P::FRONT_CENTER},
+        {P::FRONT_LEFT, P::FRONT_RIGHT, P::REAR_LEFT, P::REAR_RIGHT},
+        {P::FRONT_LEFT, P::FRONT_RIGHT, P::FRONT_CENTER, P::REAR_LEFT, P::REAR_RIGHT},
+        {P::FRONT_LEFT, P::FRONT_RIGHT, P::FRONT_CENTER, P::LFE, P::REAR_LEFT, P::REAR_RIGHT},
+        {P::FRONT_LEFT, P::FRONT_RIGHT, P::FRONT_CENTER, P::LFE, P::REAR_CENTER, P::SIDE_LEFT, P::SIDE_RIGHT},
+        {P::FRONT_LEFT, P::FRONT_RIGHT, P::FRONT_CENTER, P::LFE, P::REAR_LEFT, P::REAR_RIGHT, P::SIDE_LEFT, P::SIDE_RIGHT},
+    };
+    ChannelMap map;
+    map.channels = std::max(1, std::min(MAX_CHANNELS, channels));
+    std::copy(layouts[map.channels - 1], layouts[map.channels - 1] + MAX_CHANNELS, map.position);
+    return map;
+}
+
+const char* ChannelMap::label(int channel) const {
+    static const char* const labels[] = {"M", "FL", "FR", "FC", "LFE", "RL", "RR", "RC", "SL", "SR", "?"};
+    return labels[static_cast<int>(position[channel])];
+}
+
+void ChannelBuffers::clear() {
+    for (int c = 0; c < map.channels; ++c) std::fill(data[c], data[c] + BUFFER_FRAMES, 0);
+}
+
+void ChannelBuffers::setStereo(const int16_t* left, const int16_t* right) {
+    map = ChannelMap::standard(2);
+    std::copy(left, left + BUFFER_FRAMES, data[0]);
+    std::copy(right, right + BUFFER_FRAMES, data[1]);
+}
+
+void deinterleave(const int16_t* interleaved, ChannelBuffers& out) {
+    switch (out.map.channels) {
+        case 1: deinterleaveFixed<1>(interleaved, out); break;
+        case 2: deinterleaveFixed<2>(interleaved, out); break;
+        case 3: deinterleaveFixed<3>(interleaved, out); break;
+        case 4: deinterleaveFixed<4>(interleaved, out); break;
+        case 5: deinterleaveFixed<5>(interleaved, out); break;
+        case 6: deinterleaveFixed<6>(interleaved, out); break;
+        case 7: deinterleaveFixed<7>(interleaved, out); break;
+        default: deinterleaveFixed<8>(interleaved, out); break;
+    }
+}
+
+void downmixStereo(const ChannelBuffers& in, int16_t* left, int16_t* right) {
+    const ChannelMap& map = in.map;
+    if (map.channels == 2 && map.position[0] == ChannelPosition::FRONT_LEFT &&
+        map.position[1] == ChannelPosition::FRONT_RIGHT) {
+        std::memcpy(left, in.data[0], sizeof(in.data[0]));
+        std::memcpy(right, in.data[1], sizeof(in.data[1]));
+        return;
+    }
+    float mixLeft[BUFFER_FRAMES] = {0};
+    float mixRight[BUFFER_FRAMES] = {0};
+    for (int c = 0; c < map.channels; ++c) {
+        DownmixGain gain = downmixGain(map.position[c]);
+        const int16_t* samples = in.data[c];
+        for (int i = 0; i < BUFFER_FRAMES; ++i) {
+            mixLeft[i] += gain.left * samples[i];
+            mixRight[i] += gain.right * samples[i];
+        }
+    }
+    for (int i = 0; i < BUFFER_FRAMES; ++i) {
+        left[i] = clip(mixLeft[i]);
+        right[i] = clip(mixRight[i]);
+    }
+}
+
+void ChannelRing::write(const int16_t* interleaved, const ChannelMap& map) {
+    const uint64_t current = head.load(std::memory_order_relaxed);
+    uint64_t oldest = tail.load(std::memory_order_acquire);
+    if (current - oldest == BUFFER_COUNT) {
+        // Full: the oldest buffer goes, unless the reader has just taken it
+        tail.compare_exchange_strong(oldest, oldest + 1, std::memory_order_acq_rel);
+    }
+    Slot& slot = slots[current % BUFFER_COUNT];
+    slot.map = map;
+    slot.sequence = current;
+    std::copy(interleaved, interleaved + BUFFER_FRAMES * map.channels, slot.samples);
+    head.store(current + 1, std::memory_order_release);
+}
+
+bool ChannelRing::read(ChannelBuffers& out, uint64_t* sequence) {
+    uint64_t current = tail.load(std::memory_order_acquire);
+    while (current != head.load(std::memory_order_acquire)) {
+        const Slot& slot = slots[current % BUFFER_COUNT];
+        out.map = slot.map;
+        if (sequence) *sequence = slot.sequence;
+        deinterleave(slot.samples, out);
+        // Fails when the writer dropped this buffer while we copied it; `current` is then the new oldest
+        if (tail.compare_exchange_strong(current, current + 1, std::memory_order_acq_rel)) return true;
+    }
+    return false;
+}
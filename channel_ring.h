@@ -0,0 +1,108 @@
+#ifndef CHANNEL_RING_H
+#define CHANNEL_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include "config_parser.h"
+
+const int MAX_CHANNELS = 8;  // Up to 7.1
+
+// Speaker positions we can label, weight and downmix
+enum class ChannelPosition : uint8_t {
+    MONO,
+    FRONT_LEFT,
+    FRONT_RIGHT,
+    FRONT_CENTER,
+    LFE,
+    REAR_LEFT,
+    REAR_RIGHT,
+    REAR_CENTER,
+    SIDE_LEFT,
+    SIDE_RIGHT,
+    UNKNOWN
+};
+
+/**
+ * @brief Channel count and the speaker position of each channel.
+ */
+struct ChannelMap {
+    int channels = 2;
+    ChannelPosition position[MAX_CHANNELS] = {ChannelPosition::FRONT_LEFT, ChannelPosition::FRONT_RIGHT};
+
+    // The usual layout for a channel count (WAVE order: 6 is 5.1, 8 is 7.1)
+    static ChannelMap standard(int channels);
+
+    // Short speaker name: "FL", "LFE", ...
+    const char* label(int channel) const;
+};
+
+/**
+ * @brief One buffer of every channel, deinterleaved, with the map it was captured with.
+ */
+struct ChannelBuffers {
+    ChannelMap map;
+    int16_t data[MAX_CHANNELS][BUFFER_FRAMES] = {{0}};
+
+    // Zeros the samples of every channel in the map
+    void clear();
+
+    // Makes this plain stereo from two buffers (remote streams carry no more)
+    void setStereo(const int16_t* left, const int16_t* right);
+};
+
+/**
+ * @brief Splits BUFFER_FRAMES interleaved frames into one buffer per channel.
+ *
+ * Dispatches to a loop with the channel count fixed at compile time, so
+ * the stride is a constant the compiler can vectorize; 7.1 gets an SSE2
+ * 8x8 transpose, which the compiler does not find on its own.
+ */
+void deinterleave(const int16_t* interleaved, ChannelBuffers& out);
+
+/**
+ * @brief Folds every channel into left and right for the stereo modes.
+ *
+ * Centre and surrounds go to both sides at -3 dB, the LFE is left out, and
+ * the sums are clipped. A plain front pair is copied as it is.
+ */
+void downmixStereo(const ChannelBuffers& in, int16_t* left, int16_t* right);
+
+/**
+ * @brief SPSC ring of interleaved buffers, each stored with its channel map.
+ *
+ * The map travels with the samples, so a layout change on the capture
+ * side can never be applied to buffers captured with the old one. When the
+ * reader falls behind, the writer drops the oldest buffer to make room, so
+ * the reader always finds the newest BUFFER_COUNT in order. A read that
+ * races with such a drop notices it and moves on to the next buffer.
+ * Buffers are numbered from 0 as they are written, as SampleHistory
+ * numbers the ones appended beside them.
+ */
+class ChannelRing {
+public:
+    static const int BUFFER_COUNT = 8;
+
+    // Stores BUFFER_FRAMES frames of `map.channels` interleaved samples
+    void write(const int16_t* interleaved, const ChannelMap& map);
+
+    // Deinterleaves the oldest buffer into `out`, and gives its number; false when there is none
+    bool read(ChannelBuffers& out, uint64_t* sequence = nullptr);
+
+private:
+    struct Slot {
+        ChannelMap map;
+        uint64_t sequence = 0;
+        int16_t samples[BUFFER_FRAMES * MAX_CHANNELS] = {0};
+    };
+    Slot slots[BUFFER_COUNT];
+    // Counts of buffers written and consumed (read or dropped); they never wrap, so a slot is never mistaken for a later one
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+};
+
+// Media time of a source's buffer `index`, numbered as ChannelRing and SampleHistory number them, in seconds
+inline double bufferTime(uint64_t index, uint32_t sampleRate) {
+    return sampleRate ? static_cast<double>(index) * BUFFER_FRAMES / sampleRate : 0.0;
+}
+
+#endif // CHANNEL_RING_H
@@ -1,13 +1,66 @@
 #include "config_parser.h"
-#include <fstream>
-#include <sstream>
+#include "mapped_file.h"
+#include "shape_cache.h"
+#include "svg_path.h"
+#include "expression.h"
 #include <algorithm>
-#include <cctype>
-#include <vector>
-#include <map>
+#include <charconv>
 #include <cmath>
+#include <cstring>
+#include <map>
+#include <string_view>
+#include <vector>
+
+float decay__factor = DEFAULT_DECAY_FACTOR;
+
+namespace {
+
+std::string_view trim(std::string_view text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string_view::npos) return std::string_view();
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+// Splits "key = value" into trimmed halves. Returns false if there is no '='.
+bool splitKeyValue(std::string_view line, std::string_view& key, std::string_view& value) {
+    size_t pos = line.find('=');
+    if (pos == std::string_view::npos) return false;
+    key = trim(line.substr(0, pos));
+    value = trim(line.substr(pos + 1));
+    return true;
+}
+
+template <typename T>
+bool parseNumber(std::string_view text, T& out) {
+    text = trim(text);
+    if (!text.empty() && text.front() == '+') text.remove_prefix(1);
+    if (text.empty()) return false;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), out);
+    return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+/**
+ * @brief Walks a buffer line by line without copying.
+ */
+struct LineCursor {
+    const char* pos;
+    const char* end;
+    int number = 0;
+
+    bool next(std::string_view& raw) {
+        if (pos >= end) return false;
+        const char* newline = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        const char* line_end = newline ? newline : end;
+        raw = std::string_view(pos, line_end - pos);
+        pos = newline ? newline + 1 : end;
+        number++;
+        return true;
+    }
+};
+
+}
 
-float decay__factor = 0.025f;
 ConfigParser::ConfigParser(const std::string& filename)
 : filename(filename) {}
 
@@ -19,26 +72,89 @@ std::vector<std::pair<int, int>> ConfigParser::getColorPairs() const {
     return gradientColorPairs;
 }
 
+CatchUpPolicy ConfigParser::getCatchUpPolicy() const {
+    return catchUpPolicy;
+}
+
+float ConfigParser::getDecayFactor() const {
+    return decayFactor;
+}
+
+int ConfigParser::getTargetFps() const {
+    return targetFps;
+}
+
+void ConfigParser::setShapeCache(const ShapeCache* cache) {
+    shapeCache = cache;
+}
+
+uint64_t ConfigParser::getContentHash() const {
+    return contentHash;
+}
+
+bool ConfigParser::shapesFromCache() const {
+    return cachedShapes;
+}
+
+std::vector<std::string> ConfigParser::getShapeDependencies() const {
+    return shapeDependencies;
+}
+
+QualitySettings ConfigParser::getQualitySettings() const {
+    return quality;
+}
+
 std::string ConfigParser::getError() const {
     return error;
 }
 
+void ConfigParser::reportError(int lineNum, int column, const std::string& message) {
+    // Keep the first problem; later ones are often fallout from it
+    if (error.empty()) {
+        error = filename + ":" + std::to_string(lineNum) + ":" + std::to_string(column) + ": " + message;
+    }
+}
+
 bool ConfigParser::parse() {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
+    FileContents file(filename);
+    if (!file.ok) {
         error = "Failed to open config file: " + filename;
         return false;
     }
 
-    std::string line;
-    int lineNum = 0;
+    // A cache hit means this exact text was parsed before; only the top-level
+    // settings are read again and the visualizer blocks are skipped
+    contentHash = ShapeCache::hashContent(file.data, file.size);
+    std::vector<CustomVisualizer> cached;
+    cachedShapes = shapeCache && shapeCache->lookup(filename, contentHash, cached, shapeDependencies);
+
+    LineCursor cursor{file.data, file.data + file.size};
+    std::string_view raw;
     bool parsing_visualizer = false;
+    int visualizer_line = 0;
     CustomVisualizer current_visualizer;
+    int formula_line[EXPR_SLOT_COUNT] = {};   // Where each formula was written, for errors
+    int formula_column[EXPR_SLOT_COUNT] = {};
 
-    while (std::getline(file, line)) {
-        lineNum++;
-        line.erase(0, line.find_first_not_of(" \t"));
-        line.erase(line.find_last_not_of(" \t") + 1);
+    // 1-based column of `token` within the current raw line
+    auto columnOf = [&](std::string_view token) {
+        return static_cast<int>(token.data() - raw.data()) + 1;
+    };
+
+    // Integer setting that must lie within [min_value, max_value]
+    auto parseRanged = [&](std::string_view key, std::string_view value, int min_value, int max_value, int& out) {
+        int parsed;
+        if (!parseNumber(value, parsed) || parsed < min_value || parsed > max_value) {
+            reportError(cursor.number, columnOf(value), std::string(key) + " must be an integer from " +
+                        std::to_string(min_value) + " to " + std::to_string(max_value));
+            return;
+        }
+        out = parsed;
+    };
+
+    while (cursor.next(raw)) {
+        const int lineNum = cursor.number;
+        std::string_view line = trim(raw);
 
         if (line.empty() || line[0] == '#') {
             if (parsing_visualizer && !current_visualizer.polygons.empty() && !current_visualizer.polygons.back().empty()) {
@@ -47,110 +163,193 @@ bool ConfigParser::parse() {
             continue;
         }
 
+        if (parsing_visualizer && cachedShapes) {
+            if (line == "}") parsing_visualizer = false;
+            continue;
+        }
+
         if (parsing_visualizer) {
             if (line == "}") {
                 if (!current_visualizer.polygons.empty() && current_visualizer.polygons.back().empty()) {
                     current_visualizer.polygons.pop_back();
                 }
-                customVisualizers.push_back(current_visualizer);
+                if (current_visualizer.type == ShapeVisualizerType::EXPRESSION) {
+                    auto program = std::make_shared<ExpressionProgram>();
+                    std::string compile_error;
+                    int slot;
+                    size_t offset;
+                    if (program->compile(current_visualizer.expressions.data(), compile_error, slot, offset)) {
+                        current_visualizer.program = program;
+                    } else if (formula_line[slot] > 0) {
+                        reportError(formula_line[slot], formula_column[slot] + static_cast<int>(offset), compile_error);
+                    } else {
+                        reportError(lineNum, columnOf(line), compile_error);
+                    }
+                } else {
+                    for (int slot = 0; slot < EXPR_SLOT_COUNT; ++slot) {
+                        if (formula_line[slot] > 0) {
+                            reportError(formula_line[slot], formula_column[slot], "formulas need visualizer_type = expression");
+                            break;
+                        }
+                    }
+                }
+                customVisualizers.push_back(std::move(current_visualizer));
                 parsing_visualizer = false;
                 continue;
             }
 
-            size_t pos = line.find('=');
-            if (pos == std::string::npos) continue;
-            std::string key = line.substr(0, pos);
-            std::string value = line.substr(pos + 1);
-            key.erase(key.find_last_not_of(" \t") + 1);
-            key.erase(0, key.find_first_not_of(" \t"));
-            value.erase(value.find_last_not_of(" \t") + 1);
-            value.erase(0, value.find_first_not_of(" \t"));
+            std::string_view key, value;
+            if (!splitKeyValue(line, key, value)) continue;
 
             if (key == "point") {
                 size_t commaPos = value.find(',');
-                if (commaPos == std::string::npos) continue;
-                try {
-                    float x = std::stof(value.substr(0, commaPos));
-                    float y = std::stof(value.substr(commaPos + 1));
-                    if (current_visualizer.polygons.empty()) {
-                        current_visualizer.polygons.push_back({});
-                    }
-                    current_visualizer.polygons.back().push_back({x, y});
-                } catch (const std::exception&) { continue; }
+                if (commaPos == std::string_view::npos) {
+                    reportError(lineNum, columnOf(value), "expected 'point = x,y'");
+                    continue;
+                }
+                float x, y;
+                std::string_view xs = value.substr(0, commaPos);
+                std::string_view ys = value.substr(commaPos + 1);
+                if (!parseNumber(xs, x)) { reportError(lineNum, columnOf(xs), "invalid x coordinate '" + std::string(trim(xs)) + "'"); continue; }
+                if (!parseNumber(ys, y)) { reportError(lineNum, columnOf(ys), "invalid y coordinate '" + std::string(trim(ys)) + "'"); continue; }
+                if (current_visualizer.polygons.empty()) {
+                    current_visualizer.polygons.push_back({});
+                }
+                current_visualizer.polygons.back().push_back({x, y});
             } else if (key == "shape" && value == "circle") {
                 int points = 128;
-                std::streampos old_pos = file.tellg();
-                if (std::getline(file, line)) {
-                    line.erase(0, line.find_first_not_of(" \t"));
-                    line.erase(line.find_last_not_of(" \t") + 1);
-                    if (line.rfind("points", 0) == 0) {
-                        size_t p_pos = line.find('=');
-                        if (p_pos != std::string::npos) {
-                           try { points = std::stoi(line.substr(p_pos + 1)); }
-                           catch(const std::exception&) {}
+                // An optional "points = N" on the very next line sets the resolution
+                LineCursor lookahead = cursor;
+                std::string_view next_raw;
+                if (lookahead.next(next_raw)) {
+                    std::string_view next_line = trim(next_raw);
+                    std::string_view next_key, next_value;
+                    if (next_line.substr(0, 6) == "points" && splitKeyValue(next_line, next_key, next_value)) {
+                        if (!parseNumber(next_value, points) || points < MIN_CIRCLE_POINTS || points > MAX_CIRCLE_POINTS) {
+                            reportError(lookahead.number, static_cast<int>(next_value.data() - next_raw.data()) + 1,
+                                        "circle points must be an integer from " + std::to_string(MIN_CIRCLE_POINTS) +
+                                        " to " + std::to_string(MAX_CIRCLE_POINTS));
+                            points = 128;
                         }
-                    } else {
-                       file.seekg(old_pos);
+                        cursor = lookahead;
                     }
                 }
                 std::vector<std::pair<float, float>> circle_poly;
+                circle_poly.reserve(points);
                 const float PI = 3.1415926535f;
                 for(int i = 0; i < points; ++i) {
                     float angle = 2.0f * PI * i / points;
                     circle_poly.push_back({100.0f * std::cos(angle), 100.0f * std::sin(angle)});
                 }
-                current_visualizer.polygons.push_back(circle_poly);
+                current_visualizer.polygons.push_back(std::move(circle_poly));
+            } else if (key == "svg" || key == "svg_path") {
+                ShapePolygons imported;
+                std::string svg_error;
+                bool imported_ok;
+                if (key == "svg") {
+                    // Relative paths are taken from the config file's directory
+                    std::string svg_file(value);
+                    size_t slash = filename.find_last_of('/');
+                    if (!svg_file.empty() && svg_file[0] != '/' && slash != std::string::npos) {
+                        svg_file = filename.substr(0, slash + 1) + svg_file;
+                    }
+                    shapeDependencies.push_back(svg_file);
+                    imported_ok = importSvgFile(svg_file, imported, svg_error);
+                } else {
+                    imported_ok = importSvgPath(value, imported, svg_error);
+                }
+                if (!imported_ok) {
+                    reportError(lineNum, columnOf(value), "svg: " + svg_error);
+                    continue;
+                }
+                for (auto& polygon : imported) current_visualizer.polygons.push_back(std::move(polygon));
+            } else if (key == "radius" || key == "x" || key == "y" || key == "color") {
+                int slot = key == "radius" ? EXPR_RADIUS : key == "x" ? EXPR_X : key == "y" ? EXPR_Y : EXPR_COLOR;
+                current_visualizer.expressions[slot] = std::string(value);
+                formula_line[slot] = lineNum;
+                formula_column[slot] = columnOf(value);
+            } else if (key == "num_points") {
+                parseRanged(key, value, MIN_RADIAL_POINTS, MAX_RADIAL_POINTS, current_visualizer.numPoints);
+            } else if (key == "smoothing_passes") {
+                parseRanged(key, value, MIN_SMOOTHING_PASSES, MAX_SMOOTHING_PASSES, current_visualizer.smoothingPasses);
+            } else if (key == "points_per_vertex_side") {
+                parseRanged(key, value, MIN_POINTS_PER_SIDE, MAX_POINTS_PER_SIDE, current_visualizer.pointsPerVertexSide);
             } else if (key == "visualizer_type") {
                 if (value == "distort") {
                     current_visualizer.type = ShapeVisualizerType::DISTORT;
-                } else {
+                } else if (value == "expand") {
                     current_visualizer.type = ShapeVisualizerType::EXPAND;
+                } else if (value == "expression") {
+                    current_visualizer.type = ShapeVisualizerType::EXPRESSION;
+                } else {
+                    reportError(lineNum, columnOf(value), "unknown visualizer_type '" + std::string(value) + "'");
                 }
             }
         } else {
             size_t spacePos = line.find(' ');
-            if (spacePos != std::string::npos) {
-                std::string command = line.substr(0, spacePos);
-                if (command == "new_visualizer") {
-                    size_t bracePos = line.find('{');
-                    if (bracePos == std::string::npos) continue;
-                    parsing_visualizer = true;
-                    current_visualizer = CustomVisualizer();
-                    current_visualizer.name = line.substr(spacePos + 1, bracePos - spacePos - 2);
-                    current_visualizer.polygons.clear();
+            if (spacePos != std::string_view::npos && line.substr(0, spacePos) == "new_visualizer") {
+                size_t bracePos = line.find('{');
+                if (bracePos == std::string_view::npos) {
+                    reportError(lineNum, columnOf(line) + static_cast<int>(line.size()), "expected '{' after visualizer name");
                     continue;
                 }
+                parsing_visualizer = true;
+                visualizer_line = lineNum;
+                current_visualizer = CustomVisualizer();
+                std::fill(std::begin(formula_line), std::end(formula_line), 0);
+                current_visualizer.name = std::string(trim(line.substr(spacePos + 1, bracePos - spacePos - 1)));
+                continue;
             }
-            size_t pos = line.find('=');
-            if (pos != std::string::npos) {
-                std::string key = line.substr(0, pos);
-                std::string value = line.substr(pos + 1);
-                key.erase(key.find_last_not_of(" \t") + 1);
-                key.erase(0, key.find_first_not_of(" \t"));
-                value.erase(value.find_last_not_of(" \t") + 1);
-                value.erase(0, value.find_first_not_of(" \t"));
-
-                if (key == "gradient_color") {
-                    size_t commaPos = value.find(',');
-                    if (commaPos == std::string::npos) continue;
-                    int fg = parseColor(value.substr(0, commaPos));
-                    int bg = parseColor(value.substr(commaPos + 1));
-                    if(fg != -1 && bg != -1) gradientColorPairs.emplace_back(fg,bg);
-                } else if (key == "visualizer_decay_factor") {
-                     try { decay__factor = std::stof(value); }
-                     catch (const std::exception&) { continue; }
+
+            std::string_view key, value;
+            if (!splitKeyValue(line, key, value)) continue;
+
+            if (key == "gradient_color") {
+                size_t commaPos = value.find(',');
+                if (commaPos == std::string_view::npos) {
+                    reportError(lineNum, columnOf(value), "expected 'gradient_color = fg,bg'");
+                    continue;
                 }
+                std::string_view fgs = trim(value.substr(0, commaPos));
+                std::string_view bgs = trim(value.substr(commaPos + 1));
+                int fg = parseColor(fgs);
+                int bg = parseColor(bgs);
+                if (fg == -1) reportError(lineNum, columnOf(fgs), "unknown color '" + std::string(fgs) + "'");
+                else if (bg == -1) reportError(lineNum, columnOf(bgs), "unknown color '" + std::string(bgs) + "'");
+                else gradientColorPairs.emplace_back(fg, bg);
+            } else if (key == "visualizer_decay_factor") {
+                float decay;
+                if (parseNumber(value, decay)) decayFactor = decay;
+                else reportError(lineNum, columnOf(value), "invalid decay factor '" + std::string(value) + "'");
+            } else if (key == "frame_catchup") {
+                if (value == "burst") catchUpPolicy = CatchUpPolicy::BURST;
+                else if (value == "skip") catchUpPolicy = CatchUpPolicy::SKIP;
+                else reportError(lineNum, columnOf(value), "frame_catchup must be 'skip' or 'burst'");
+            } else if (key == "target_fps") {
+                parseRanged(key, value, MIN_TARGET_FPS, MAX_TARGET_FPS, targetFps);
+            } else if (key == "eclipse_points") {
+                parseRanged(key, value, MIN_RADIAL_POINTS, MAX_RADIAL_POINTS, quality.eclipsePoints);
+            } else if (key == "eclipse_smoothing_passes") {
+                parseRanged(key, value, MIN_SMOOTHING_PASSES, MAX_SMOOTHING_PASSES, quality.eclipseSmoothingPasses);
+            } else if (key == "bar_count") {
+                parseRanged(key, value, MIN_BAR_COUNT, MAX_BAR_COUNT, quality.barCount);
+            } else if (key == "galaxy_max_particles") {
+                parseRanged(key, value, MIN_MAX_PARTICLES, MAX_MAX_PARTICLES, quality.galaxyMaxParticles);
             }
         }
     }
+    if (parsing_visualizer) {
+        reportError(visualizer_line, 1, "missing '}' for visualizer '" + current_visualizer.name + "'");
+    }
+    if (cachedShapes) customVisualizers = std::move(cached);
     if (gradientColorPairs.empty()) {
         gradientColorPairs.emplace_back(COLOR_GREEN, -1);
     }
-    return true;
+    return error.empty();
 }
 
-int ConfigParser::parseColor(const std::string& colorStr) {
-    static const std::map<std::string, int> colorMap = {
+int ConfigParser::parseColor(std::string_view colorStr) {
+    static const std::map<std::string, int, std::less<>> colorMap = {
         {"black", COLOR_BLACK}, {"red", COLOR_RED},
         {"green", COLOR_GREEN}, {"yellow", COLOR_YELLOW},
         {"blue", COLOR_BLUE}, {"magenta", COLOR_MAGENTA},
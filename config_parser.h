@@ -1,21 +1,84 @@
 #ifndef CONFIG_PARSER_H
 #define CONFIG_PARSER_H
 #include <ncurses.h>
+#include <cstdint>
+#include <array>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 
+class ShapeCache;
+class ExpressionProgram;
+
 const int BUFFER_FRAMES = 256;
+const float DEFAULT_DECAY_FACTOR = 0.025f;
+const int DISTORT_RAY_COUNT = 128;
+const size_t EXPAND_POINTS_PER_SIDE = 40;
+const int DEFAULT_ECLIPSE_POINTS = 128;
+const int DEFAULT_SMOOTHING_PASSES = 2;
+const int DEFAULT_BAR_COUNT = 32;
+const int DEFAULT_MAX_PARTICLES = 1000;
+
+// Accepted ranges for the quality keys; values outside are a config error.
+// Points and bars each take a slice of one buffer, so there are never more than its frames.
+const int MIN_RADIAL_POINTS = 8, MAX_RADIAL_POINTS = BUFFER_FRAMES;
+const int MIN_SMOOTHING_PASSES = 0, MAX_SMOOTHING_PASSES = 16;
+const int MIN_POINTS_PER_SIDE = 1, MAX_POINTS_PER_SIDE = 400;
+const int MIN_BAR_COUNT = 1, MAX_BAR_COUNT = BUFFER_FRAMES;
+const int MIN_MAX_PARTICLES = 0, MAX_MAX_PARTICLES = 50000;
+// A "shape = circle" outline; far finer than any terminal can show
+const int MIN_CIRCLE_POINTS = 3, MAX_CIRCLE_POINTS = 4096;
+const int DEFAULT_TARGET_FPS = 60;
+const int MIN_TARGET_FPS = 1;
+const int MAX_TARGET_FPS = 240;
 
 enum class ShapeVisualizerType {
     EXPAND,
-    DISTORT
+    DISTORT,
+    EXPRESSION
+};
+
+// Formula keys of an expression visualizer
+enum ExpressionSlot {
+    EXPR_RADIUS,
+    EXPR_X,
+    EXPR_Y,
+    EXPR_COLOR,
+    EXPR_SLOT_COUNT
+};
+
+// What the frame clock does when a frame overruns its deadline
+enum class CatchUpPolicy {
+    SKIP,  // Drop the missed frames and stay on the frame grid
+    BURST  // Render the missed frames back to back
+};
+
+// Cost/fidelity knobs of the built-in modes, so each host can pick its own balance
+struct QualitySettings {
+    int eclipsePoints = DEFAULT_ECLIPSE_POINTS;            // eclipse_points
+    int eclipseSmoothingPasses = DEFAULT_SMOOTHING_PASSES; // eclipse_smoothing_passes
+    int barCount = DEFAULT_BAR_COUNT;                      // bar_count
+    int galaxyMaxParticles = DEFAULT_MAX_PARTICLES;        // galaxy_max_particles
+
+    bool operator==(const QualitySettings& other) const {
+        return eclipsePoints == other.eclipsePoints && eclipseSmoothingPasses == other.eclipseSmoothingPasses &&
+               barCount == other.barCount && galaxyMaxParticles == other.galaxyMaxParticles;
+    }
 };
 
 struct CustomVisualizer {
     std::string name;
     ShapeVisualizerType type = ShapeVisualizerType::EXPAND;
+    int numPoints = DISTORT_RAY_COUNT;                  // DISTORT rays (num_points)
+    int smoothingPasses = DEFAULT_SMOOTHING_PASSES;     // DISTORT (smoothing_passes)
+    int pointsPerVertexSide = EXPAND_POINTS_PER_SIDE;   // EXPAND (points_per_vertex_side)
     std::vector<std::vector<std::pair<float, float>>> polygons;
+    std::vector<float> rayDistances; // Edge distance along each DISTORT ray, see prepareCustomVisualizer()
+    std::vector<std::pair<float, float>> perimeter; // Subdivided EXPAND outline, see prepareCustomVisualizer()
+    std::array<std::string, EXPR_SLOT_COUNT> expressions; // EXPRESSION formulas as written
+    std::shared_ptr<const ExpressionProgram> program;     // Compiled from `expressions`
 };
 
 class ConfigParser {
@@ -23,15 +86,38 @@ public:
     explicit ConfigParser(const std::string& filename);
     bool parse();
     std::vector<std::pair<int, int>> getColorPairs() const;
+    // First problem found by parse(), as "file:line:column: message"; empty if none
     std::string getError() const;
     std::vector<CustomVisualizer> getCustomVisualizers() const;
+    float getDecayFactor() const;
+    CatchUpPolicy getCatchUpPolicy() const;
+    int getTargetFps() const;
+    QualitySettings getQualitySettings() const;
+
+    // Optional: shapes for an unchanged config are taken from this cache instead of re-parsed
+    void setShapeCache(const ShapeCache* cache);
+    // FNV-1a hash of the file contents seen by parse()
+    uint64_t getContentHash() const;
+    // True if parse() took the custom visualizers from the shape cache (already prepared)
+    bool shapesFromCache() const;
+    // Files the shapes were built from besides the config itself (imported SVGs)
+    std::vector<std::string> getShapeDependencies() const;
 
 private:
     std::string filename;
+    const ShapeCache* shapeCache = nullptr;
+    uint64_t contentHash = 0;
+    bool cachedShapes = false;
+    std::vector<std::string> shapeDependencies;
     std::vector<std::pair<int, int>> gradientColorPairs;
     std::string error;
     std::vector<CustomVisualizer> customVisualizers;
-    int parseColor(const std::string& colorStr);
+    CatchUpPolicy catchUpPolicy = CatchUpPolicy::SKIP;
+    int targetFps = DEFAULT_TARGET_FPS;
+    float decayFactor = DEFAULT_DECAY_FACTOR;
+    QualitySettings quality;
+    int parseColor(std::string_view colorStr);
+    void reportError(int lineNum, int column, const std::string& message);
 };
 
 #endif // CONFIG_PARSER_H
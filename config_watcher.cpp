@@ -0,0 +1,116 @@
+#include "config_watcher.h"
+#include "visualizer.h"
+#include "shape_cache.h"
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <exception>
+
+namespace {
+// Editors often write a file in several steps; wait for them to settle
+const int SETTLE_MS = 50;
+}
+
+ConfigWatcher::ConfigWatcher(const std::string& path)
+: path(path), update_ready(false) {
+    size_t slash = path.find_last_of('/');
+    directory = (slash == std::string::npos) ? "." : path.substr(0, slash);
+    filename = (slash == std::string::npos) ? path : path.substr(slash + 1);
+}
+
+ConfigWatcher::~ConfigWatcher() {
+    if (thread.joinable()) {
+        uint64_t one = 1;
+        if (write(stop_fd, &one, sizeof(one)) < 0) {}
+        thread.join();
+    }
+    if (inotify_fd >= 0) close(inotify_fd);
+    if (stop_fd >= 0) close(stop_fd);
+}
+
+std::shared_ptr<ConfigSnapshot> ConfigWatcher::load(const std::string& path, std::string& error) {
+    static const ShapeCache cache;
+    auto parser = std::make_shared<ConfigParser>(path);
+    parser->setShapeCache(&cache);
+    bool ok = parser->parse();
+    error = parser->getError();
+    auto snapshot = std::make_shared<ConfigSnapshot>();
+    snapshot->customVisualizers = parser->getCustomVisualizers();
+    for (auto& viz : snapshot->customVisualizers) prepareCustomVisualizer(viz);
+    if (ok && !parser->shapesFromCache() && !snapshot->customVisualizers.empty()) {
+        // Best effort: a read-only cache directory just means parsing every time
+        cache.store(path, parser->getContentHash(), snapshot->customVisualizers, parser->getShapeDependencies());
+    }
+    snapshot->config = parser;
+    if (!ok && error.empty()) error = "Failed to parse " + path;
+    return snapshot;
+}
+
+bool ConfigWatcher::start() {
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) return false;
+    if (inotify_add_watch(inotify_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return false;
+    }
+    stop_fd = eventfd(0, EFD_CLOEXEC);
+    if (stop_fd < 0) return false;
+    thread = std::thread(&ConfigWatcher::run, this);
+    return true;
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigWatcher::takeUpdate(std::string& error) {
+    std::lock_guard<std::mutex> lock(mutex);
+    update_ready.store(false, std::memory_order_relaxed);
+    error = pending_error;
+    pending_error.clear();
+    return std::move(pending);
+}
+
+void ConfigWatcher::run() {
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{inotify_fd, POLLIN, 0}, {stop_fd, POLLIN, 0}};
+    bool changed = false;
+
+    for (;;) {
+        // While a change is pending, a quiet period of SETTLE_MS triggers the reload
+        int ret = poll(fds, 2, changed ? SETTLE_MS : -1);
+        if (ret < 0) continue;
+        if (fds[1].revents) return;
+
+        if (ret == 0 && changed) {
+            changed = false;
+            std::string error;
+            std::shared_ptr<ConfigSnapshot> snapshot;
+            try {
+                snapshot = load(path, error);
+            } catch (const std::exception& e) {
+                // An edit that asks for more than we can allocate is rejected like a parse error,
+                // rather than escaping this thread and terminating the process
+                error = "Cannot load " + path + ": " + e.what();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (error.empty()) {
+                pending = snapshot;
+                pending_error.clear();
+            } else {
+                // Keep whatever config is running; just report why the edit was rejected
+                pending.reset();
+                pending_error = error;
+            }
+            update_ready.store(true, std::memory_order_release);
+            continue;
+        }
+
+        ssize_t len;
+        while ((len = read(inotify_fd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + len; ) {
+                const inotify_event* event = reinterpret_cast<const inotify_event*>(ptr);
+                if (event->len > 0 && filename == event->name) changed = true;
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+    }
+}
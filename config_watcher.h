@@ -0,0 +1,66 @@
+#ifndef CONFIG_WATCHER_H
+#define CONFIG_WATCHER_H
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "config_parser.h"
+
+/**
+ * @brief An immutable, fully prepared configuration.
+ *
+ * Built on the watcher thread, then handed to the render loop as a whole so
+ * a frame never sees a half-applied config.
+ */
+struct ConfigSnapshot {
+    std::shared_ptr<const ConfigParser> config;
+    std::vector<CustomVisualizer> customVisualizers; // Already run through prepareCustomVisualizer()
+};
+
+/**
+ * @brief Watches the config file with inotify and re-parses it on change.
+ *
+ * The directory is watched rather than the file, so editors that save by
+ * writing a new file and renaming it over the old one are picked up too.
+ * Parsing happens on a background thread; the render loop only checks an
+ * atomic flag between frames and swaps in the finished snapshot.
+ */
+class ConfigWatcher {
+public:
+    explicit ConfigWatcher(const std::string& path);
+    ~ConfigWatcher();
+    ConfigWatcher(const ConfigWatcher&) = delete;
+    ConfigWatcher& operator=(const ConfigWatcher&) = delete;
+
+    // Starts watching. Returns false (and reloads are disabled) if inotify is unavailable.
+    bool start();
+
+    // Cheap check for the render loop: no locking, no syscalls.
+    bool hasUpdate() const { return update_ready.load(std::memory_order_acquire); }
+
+    // Takes the pending result. On a bad edit the snapshot is null and `error` says why.
+    std::shared_ptr<const ConfigSnapshot> takeUpdate(std::string& error);
+
+    // Parses and prepares a config synchronously (also used at startup).
+    static std::shared_ptr<ConfigSnapshot> load(const std::string& path, std::string& error);
+
+private:
+    std::string path;
+    std::string directory;
+    std::string filename;
+    int inotify_fd = -1;
+    int stop_fd = -1;
+    std::thread thread;
+
+    std::mutex mutex;
+    std::shared_ptr<const ConfigSnapshot> pending;
+    std::string pending_error;
+    std::atomic<bool> update_ready;
+
+    void run();
+};
+
+#endif // CONFIG_WATCHER_H
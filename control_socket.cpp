@@ -0,0 +1,170 @@
+#include "control_socket.h"
+#include "net_stream.h"
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+const size_t MAX_CLIENTS = 16;
+const size_t MAX_LINE = 512;
+const size_t MAX_PENDING_OUTPUT = 64 * 1024;
+const int EVENTS_PER_CALL = 16;
+
+std::string trim(const std::string& text) {
+    size_t start = text.find_first_not_of(" \t\r");
+    if (start == std::string::npos) return "";
+    size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(start, end - start + 1);
+}
+
+} // namespace
+
+ControlServer::~ControlServer() {
+    for (auto& entry : clients) close(entry.first);
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        unlink(path.c_str());
+    }
+    if (epoll_fd >= 0) close(epoll_fd);
+}
+
+bool ControlServer::open(const std::string& socketPath, std::string& error) {
+    sockaddr_un address{};
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        error = "Control socket path '" + socketPath + "' is too long";
+        return false;
+    }
+    if (!claimSocketPath(socketPath, error)) return false;
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (listen_fd < 0 || epoll_fd < 0) {
+        error = std::string("Cannot create control socket: ") + std::strerror(errno);
+        return false;
+    }
+    if (bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || listen(listen_fd, 8) != 0) {
+        error = "Cannot listen on " + socketPath + ": " + std::strerror(errno);
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    path = socketPath;
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listen_fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &event);
+    return true;
+}
+
+void ControlServer::service(const Handler& handler) {
+    epoll_event events[EVENTS_PER_CALL];
+    int count = epoll_wait(epoll_fd, events, EVENTS_PER_CALL, 0);
+    for (int i = 0; i < count; ++i) {
+        int fd = events[i].data.fd;
+        if (fd == listen_fd) {
+            acceptClients();
+            continue;
+        }
+        auto it = clients.find(fd);
+        if (it == clients.end()) continue;
+        bool alive = !(events[i].events & EPOLLERR);
+        if (alive && (events[i].events & (EPOLLIN | EPOLLHUP))) alive = readRequests(fd, it->second, handler);
+        if (alive) alive = flush(fd, it->second);
+        if (!alive) closeClient(fd);
+    }
+}
+
+void ControlServer::acceptClients() {
+    while (true) {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (clients.size() >= MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+        clients[fd] = Client();
+    }
+}
+
+/**
+ * @brief Reads what the client sent and queues a reply for every complete line.
+ *
+ * Returns false when the client has hung up or broken the protocol. Replies
+ * to the lines read before a hang-up are still attempted.
+ */
+bool ControlServer::readRequests(int fd, Client& client, const Handler& handler) {
+    char buffer[1024];
+    bool connected = true;
+    while (true) {
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n > 0) {
+            client.input.append(buffer, n);
+            if (client.input.size() > MAX_PENDING_OUTPUT) break;  // Answer these first; the rest waits for the next call
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) connected = false;
+        break;
+    }
+
+    size_t start = 0;
+    size_t newline;
+    while ((newline = client.input.find('\n', start)) != std::string::npos) {
+        std::string line = trim(client.input.substr(start, newline - start));
+        start = newline + 1;
+        if (line.empty()) continue;
+        size_t space = line.find_first_of(" \t");
+        std::string command = line.substr(0, space);
+        std::string argument = space == std::string::npos ? "" : trim(line.substr(space + 1));
+        std::transform(command.begin(), command.end(), command.begin(), [](unsigned char c) { return std::tolower(c); });
+        client.output += handler(command, argument);
+        client.output += '\n';
+    }
+    client.input.erase(0, start);
+
+    if (client.input.size() > MAX_LINE) {
+        client.output += "ERR line too long\n";
+        flush(fd, client);
+        return false;
+    }
+    if (!connected) flush(fd, client);
+    return connected;
+}
+
+/**
+ * @brief Writes queued replies; waits for EPOLLOUT instead of blocking if the socket is full.
+ */
+bool ControlServer::flush(int fd, Client& client) {
+    while (!client.output.empty()) {
+        ssize_t n = send(fd, client.output.data(), client.output.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) return false;
+        if (n < 0) break;
+        client.output.erase(0, n);
+    }
+    // A client that sends requests but never reads the replies
+    if (client.output.size() > MAX_PENDING_OUTPUT) return false;
+    epoll_event event{};
+    event.events = client.output.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    return true;
+}
+
+void ControlServer::closeClient(int fd) {
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    clients.erase(fd);
+}
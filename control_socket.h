@@ -0,0 +1,55 @@
+#ifndef CONTROL_SOCKET_H
+#define CONTROL_SOCKET_H
+
+#include <functional>
+#include <map>
+#include <string>
+
+/**
+ * @brief Unix-domain control socket with a line protocol.
+ *
+ * Each request is one line, a command word and an optional argument
+ * ("mode Bar Graph", "fps 30", "stats"); each gets exactly one reply line,
+ * "OK ..." or "ERR ...". Clients may pipeline requests and stay connected.
+ *
+ * The listening socket and all clients sit in one epoll set whose fd the
+ * render loop polls next to stdin, so a request wakes the loop at once and
+ * no thread is needed. Everything is non-blocking: a client that sends
+ * garbage or stops reading its replies is disconnected, never waited for.
+ */
+class ControlServer {
+public:
+    // Gets the lowercased command word and the rest of the line; returns the reply.
+    using Handler = std::function<std::string(const std::string& command, const std::string& argument)>;
+
+    ControlServer() = default;
+    ~ControlServer();
+    ControlServer(const ControlServer&) = delete;
+    ControlServer& operator=(const ControlServer&) = delete;
+
+    bool open(const std::string& path, std::string& error);
+
+    // Readable whenever there is something for service() to do.
+    int pollFd() const { return epoll_fd; }
+
+    // Accepts new clients and answers every complete request line.
+    void service(const Handler& handler);
+
+private:
+    struct Client {
+        std::string input;   // Bytes after the last complete line
+        std::string output;  // Replies the socket has not taken yet
+    };
+
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    std::string path;
+    std::map<int, Client> clients;
+
+    void acceptClients();
+    bool readRequests(int fd, Client& client, const Handler& handler);
+    bool flush(int fd, Client& client);
+    void closeClient(int fd);
+};
+
+#endif // CONTROL_SOCKET_H
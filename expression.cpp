@@ -0,0 +1,432 @@
+#include "expression.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <string_view>
+
+namespace {
+enum Op : uint8_t {
+    OP_ADD, OP_SUB, OP_MUL, OP_DIV, OP_MOD, OP_POW, OP_MIN, OP_MAX,
+    OP_NEG, OP_ABS, OP_SQRT, OP_SIN, OP_COS, OP_TAN, OP_EXP, OP_LOG, OP_FLOOR, OP_FRACT
+};
+
+// Input registers come first, in this order
+enum InputRegister { IN_ANGLE, IN_COS_ANGLE, IN_SIN_ANGLE, IN_BAND, IN_INDEX, IN_TIME, IN_BEAT, IN_LEVEL, INPUT_REGISTERS };
+
+// One definition of every operation, shared by constant folding and the interpreter
+inline float scalarOp(int op, float a, float b) {
+    switch (op) {
+    case OP_ADD: return a + b;
+    case OP_SUB: return a - b;
+    case OP_MUL: return a * b;
+    case OP_DIV: return a / b;
+    case OP_MOD: return std::fmod(a, b);
+    case OP_POW: return std::pow(a, b);
+    case OP_MIN: return std::min(a, b);
+    case OP_MAX: return std::max(a, b);
+    case OP_NEG: return -a;
+    case OP_ABS: return std::fabs(a);
+    case OP_SQRT: return std::sqrt(a);
+    case OP_SIN: return std::sin(a);
+    case OP_COS: return std::cos(a);
+    case OP_TAN: return std::tan(a);
+    case OP_EXP: return std::exp(a);
+    case OP_LOG: return std::log(a);
+    case OP_FLOOR: return std::floor(a);
+    case OP_FRACT: return a - std::floor(a);
+    }
+    return 0.0f;
+}
+
+// With OP fixed at compile time this is a branch-free loop the compiler can vectorize
+template <int OP>
+void applyBatch(float* dst, const float* a, const float* b) {
+    for (int i = 0; i < ExpressionProgram::BATCH; ++i) dst[i] = scalarOp(OP, a[i], b[i]);
+}
+
+bool isUnary(int op) { return op >= OP_NEG; }
+
+// Constants are deduplicated by bit pattern, which also copes with a folded NaN
+uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+const char* SLOT_NAMES[EXPR_SLOT_COUNT] = {"radius", "x", "y", "color"};
+}
+
+/**
+ * @brief Parses formulas into a folded expression DAG and emits bytecode.
+ */
+class ExpressionCompiler {
+public:
+    explicit ExpressionCompiler(ExpressionProgram& program) : program(program) {}
+
+    bool compile(const std::string* sources, std::string& error, int& errorSlot, size_t& errorOffset) {
+        int roots[EXPR_SLOT_COUNT];
+        for (int slot = 0; slot < EXPR_SLOT_COUNT; ++slot) {
+            roots[slot] = -1;
+            if (sources[slot].empty()) continue;
+            text = sources[slot];
+            pos = 0;
+            int root = parseExpression();
+            skipSpace();
+            if (root >= 0 && pos < text.size()) fail("unexpected '" + std::string(1, text[pos]) + "'");
+            if (root < 0 || !failure.empty()) {
+                error = std::string(SLOT_NAMES[slot]) + ": " + failure;
+                errorSlot = slot;
+                errorOffset = failure_pos;
+                return false;
+            }
+            roots[slot] = root;
+        }
+
+        errorOffset = 0;
+        bool has_radius = roots[EXPR_RADIUS] >= 0;
+        bool has_x = roots[EXPR_X] >= 0, has_y = roots[EXPR_Y] >= 0;
+        if (has_radius && (has_x || has_y)) {
+            error = "use either a radius formula or x and y formulas, not both";
+            errorSlot = EXPR_RADIUS;
+            return false;
+        }
+        if (!has_radius && !(has_x && has_y)) {
+            error = "expression visualizers need a radius formula, or both x and y";
+            errorSlot = has_x ? EXPR_X : has_y ? EXPR_Y : EXPR_RADIUS;
+            return false;
+        }
+        if (has_radius) {
+            // Polar form is sugar for the cartesian one
+            int angle = input(IN_ANGLE);
+            roots[EXPR_X] = binary(OP_MUL, roots[EXPR_RADIUS], unary(OP_COS, angle));
+            roots[EXPR_Y] = binary(OP_MUL, roots[EXPR_RADIUS], unary(OP_SIN, angle));
+        }
+        if (roots[EXPR_COLOR] < 0) roots[EXPR_COLOR] = input(IN_BAND);
+
+        // Constants get fixed registers after the inputs; temporaries follow them
+        std::map<uint32_t, int> constant_regs;
+        for (int slot : {EXPR_X, EXPR_Y, EXPR_COLOR}) collectConstants(roots[slot], constant_regs);
+        program.constants.clear();
+        for (auto& entry : constant_regs) {
+            entry.second = INPUT_REGISTERS + static_cast<int>(program.constants.size());
+            float value;
+            memcpy(&value, &entry.first, sizeof(value));
+            program.constants.push_back(value);
+        }
+        for (auto& node : nodes) {
+            if (node.kind == CONSTANT) node.reg = constant_regs[floatBits(node.value)];
+        }
+        top = INPUT_REGISTERS + static_cast<int>(program.constants.size());
+        program.code.clear();
+
+        // A shared radius is computed once and kept for both x and y
+        int too_deep_slot = EXPR_RADIUS;  // The first formula that ran out of registers
+        auto pinSlot = [&](int slot) {
+            bool before = too_deep;
+            int reg = pin(roots[slot]);
+            if (too_deep && !before) too_deep_slot = has_radius && slot != EXPR_COLOR ? EXPR_RADIUS : slot;
+            return reg;
+        };
+        if (has_radius) pinSlot(EXPR_RADIUS);
+        int reg_x = pinSlot(EXPR_X);
+        int reg_y = pinSlot(EXPR_Y);
+        int reg_color = pinSlot(EXPR_COLOR);
+        if (too_deep || top > ExpressionProgram::MAX_REGISTERS) {
+            // Registers are never shared, so running out fails the compile instead of emitting wrong code
+            error = std::string(SLOT_NAMES[too_deep_slot]) + ": formula is nested too deeply (needs more than " +
+                    std::to_string(ExpressionProgram::MAX_REGISTERS) + " registers)";
+            errorSlot = too_deep_slot;
+            return false;
+        }
+        program.outputX = reg_x;
+        program.outputY = reg_y;
+        program.outputColor = reg_color;
+        program.registerCount = top;
+        return true;
+    }
+
+private:
+    enum Kind { CONSTANT, INPUT, OPERATION };
+    struct Node {
+        Kind kind;
+        float value = 0.0f;  // CONSTANT
+        int op = 0;          // OPERATION
+        int a = -1, b = -1;  // Operand nodes
+        int reg = -1;        // Register once emitted (inputs and constants: always)
+    };
+
+    ExpressionProgram& program;
+    std::vector<Node> nodes;
+    std::string_view text;
+    size_t pos = 0;
+    std::string failure;
+    size_t failure_pos = 0;
+    int top = 0; // First free temporary register
+    bool too_deep = false;  // Some temporary did not fit in MAX_REGISTERS
+
+    int fail(const std::string& message) {
+        if (failure.empty()) {
+            failure = message;
+            failure_pos = pos;
+        }
+        return -1;
+    }
+
+    int constant(float value) {
+        nodes.push_back({CONSTANT, value});
+        return static_cast<int>(nodes.size()) - 1;
+    }
+    int input(int reg) {
+        Node node{INPUT};
+        node.reg = reg;
+        nodes.push_back(node);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+    bool isConstant(int n, float value) const {
+        return nodes[n].kind == CONSTANT && nodes[n].value == value;
+    }
+
+    int unary(int op, int a) {
+        if (a < 0) return -1;
+        if (nodes[a].kind == CONSTANT) return constant(scalarOp(op, nodes[a].value, 0.0f));
+        if (nodes[a].kind == INPUT && nodes[a].reg == IN_ANGLE) {
+            if (op == OP_COS) return input(IN_COS_ANGLE);
+            if (op == OP_SIN) return input(IN_SIN_ANGLE);
+        }
+        Node node{OPERATION};
+        node.op = op;
+        node.a = node.b = a;
+        nodes.push_back(node);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    int binary(int op, int a, int b) {
+        if (a < 0 || b < 0) return -1;
+        if (nodes[a].kind == CONSTANT && nodes[b].kind == CONSTANT) {
+            return constant(scalarOp(op, nodes[a].value, nodes[b].value));
+        }
+        // Identities that leave one operand unchanged
+        if ((op == OP_ADD || op == OP_SUB) && isConstant(b, 0.0f)) return a;
+        if (op == OP_ADD && isConstant(a, 0.0f)) return b;
+        if ((op == OP_MUL || op == OP_DIV || op == OP_POW) && isConstant(b, 1.0f)) return a;
+        if (op == OP_MUL && isConstant(a, 1.0f)) return b;
+        Node node{OPERATION};
+        node.op = op;
+        node.a = a;
+        node.b = b;
+        nodes.push_back(node);
+        return static_cast<int>(nodes.size()) - 1;
+    }
+
+    void collectConstants(int n, std::map<uint32_t, int>& regs) {
+        const Node& node = nodes[n];
+        if (node.kind == CONSTANT) regs.emplace(floatBits(node.value), 0);
+        else if (node.kind == OPERATION) {
+            collectConstants(node.a, regs);
+            if (node.b != node.a) collectConstants(node.b, regs);
+        }
+    }
+
+    // Emits code for node `n`; its temporaries are released again, except the result
+    int emit(int n) {
+        Node& node = nodes[n];
+        if (node.reg >= 0) return node.reg;
+        int base = top;
+        int ra = emit(node.a);
+        int rb = isUnary(node.op) ? ra : emit(node.b);
+        top = base;
+        int dst = top++;
+        if (dst >= ExpressionProgram::MAX_REGISTERS) {
+            // The compile fails; keep the byte fields in range until it does
+            too_deep = true;
+            dst = ExpressionProgram::MAX_REGISTERS - 1;
+        }
+        program.code.push_back({static_cast<uint8_t>(node.op), static_cast<uint8_t>(dst), static_cast<uint8_t>(ra),
+                                static_cast<uint8_t>(rb)});
+        return dst;
+    }
+
+    // Emits node `n` and keeps its register reserved until the end of the program
+    int pin(int n) {
+        int reg = emit(n);
+        nodes[n].reg = reg;
+        return reg;
+    }
+
+    void skipSpace() {
+        while (pos < text.size() && std::isspace(static_cast<unsigned char>(text[pos]))) pos++;
+    }
+    bool accept(char c) {
+        skipSpace();
+        if (pos < text.size() && text[pos] == c) {
+            pos++;
+            return true;
+        }
+        return false;
+    }
+
+    // expression := term (('+' | '-') term)*
+    int parseExpression() {
+        int left = parseTerm();
+        for (;;) {
+            if (accept('+')) left = binary(OP_ADD, left, parseTerm());
+            else if (accept('-')) left = binary(OP_SUB, left, parseTerm());
+            else return left;
+        }
+    }
+
+    // term := unary (('*' | '/' | '%') unary)*
+    int parseTerm() {
+        int left = parseUnary();
+        for (;;) {
+            if (accept('*')) left = binary(OP_MUL, left, parseUnary());
+            else if (accept('/')) left = binary(OP_DIV, left, parseUnary());
+            else if (accept('%')) left = binary(OP_MOD, left, parseUnary());
+            else return left;
+        }
+    }
+
+    // unary := '-' unary | power
+    int parseUnary() {
+        if (accept('-')) return unary(OP_NEG, parseUnary());
+        if (accept('+')) return parseUnary();
+        return parsePower();
+    }
+
+    // power := primary ('^' unary)?   (right associative)
+    int parsePower() {
+        int base = parsePrimary();
+        if (accept('^')) return binary(OP_POW, base, parseUnary());
+        return base;
+    }
+
+    int parsePrimary() {
+        skipSpace();
+        if (pos >= text.size()) return fail("unexpected end of formula");
+        char c = text[pos];
+        if (accept('(')) {
+            int inner = parseExpression();
+            if (!accept(')')) return fail("expected ')'");
+            return inner;
+        }
+        if (std::isdigit(static_cast<unsigned char>(c)) || c == '.') {
+            float value;
+            auto result = std::from_chars(text.data() + pos, text.data() + text.size(), value);
+            if (result.ec != std::errc()) return fail("invalid number");
+            pos = result.ptr - text.data();
+            return constant(value);
+        }
+        if (!std::isalpha(static_cast<unsigned char>(c))) return fail("unexpected '" + std::string(1, c) + "'");
+
+        size_t start = pos;
+        while (pos < text.size() && (std::isalnum(static_cast<unsigned char>(text[pos])) || text[pos] == '_')) pos++;
+        std::string_view name = text.substr(start, pos - start);
+
+        if (!accept('(')) {
+            if (name == "angle") return input(IN_ANGLE);
+            if (name == "band") return input(IN_BAND);
+            if (name == "index") return input(IN_INDEX);
+            if (name == "time") return input(IN_TIME);
+            if (name == "beat") return input(IN_BEAT);
+            if (name == "level") return input(IN_LEVEL);
+            if (name == "pi") return constant(3.14159265f);
+            pos = start;
+            return fail("unknown variable '" + std::string(name) + "'");
+        }
+
+        std::vector<int> args;
+        if (!accept(')')) {
+            do {
+                args.push_back(parseExpression());
+                if (args.back() < 0) return -1;
+            } while (accept(','));
+            if (!accept(')')) return fail("expected ')' or ','");
+        }
+
+        static const std::map<std::string_view, int> unary_functions = {
+            {"sin", OP_SIN}, {"cos", OP_COS}, {"tan", OP_TAN}, {"abs", OP_ABS}, {"sqrt", OP_SQRT},
+            {"exp", OP_EXP}, {"log", OP_LOG}, {"floor", OP_FLOOR}, {"fract", OP_FRACT}};
+        static const std::map<std::string_view, int> binary_functions = {
+            {"min", OP_MIN}, {"max", OP_MAX}, {"pow", OP_POW}, {"mod", OP_MOD}};
+
+        auto expect = [&](size_t count) {
+            if (args.size() == count) return true;
+            pos = start;
+            fail(std::string(name) + "() takes " + std::to_string(count) + " argument" + (count == 1 ? "" : "s"));
+            return false;
+        };
+        if (auto it = unary_functions.find(name); it != unary_functions.end()) {
+            return expect(1) ? unary(it->second, args[0]) : -1;
+        }
+        if (auto it = binary_functions.find(name); it != binary_functions.end()) {
+            return expect(2) ? binary(it->second, args[0], args[1]) : -1;
+        }
+        if (name == "clamp") {
+            return expect(3) ? binary(OP_MIN, binary(OP_MAX, args[0], args[1]), args[2]) : -1;
+        }
+        if (name == "mix") {
+            // a + (b - a) * t
+            return expect(3) ? binary(OP_ADD, args[0], binary(OP_MUL, binary(OP_SUB, args[1], args[0]), args[2])) : -1;
+        }
+        pos = start;
+        return fail("unknown function '" + std::string(name) + "'");
+    }
+};
+
+bool ExpressionProgram::compile(const std::string* sources, std::string& error, int& errorSlot, size_t& errorOffset) {
+    ExpressionCompiler compiler(*this);
+    return compiler.compile(sources, error, errorSlot, errorOffset);
+}
+
+void ExpressionProgram::run(const ExpressionInputs& inputs, size_t count, float* x, float* y, float* color) const {
+    alignas(32) float regs[MAX_REGISTERS][BATCH];
+    // Uniforms and constants are the same for every batch
+    for (int r : {IN_ANGLE, IN_COS_ANGLE, IN_SIN_ANGLE, IN_BAND, IN_INDEX}) std::fill_n(regs[r], BATCH, 0.0f);
+    std::fill_n(regs[IN_TIME], BATCH, inputs.time);
+    std::fill_n(regs[IN_BEAT], BATCH, inputs.beat);
+    std::fill_n(regs[IN_LEVEL], BATCH, inputs.level);
+    for (size_t k = 0; k < constants.size(); ++k) std::fill_n(regs[INPUT_REGISTERS + k], BATCH, constants[k]);
+
+    for (size_t base = 0; base < count; base += BATCH) {
+        const size_t lanes = std::min<size_t>(BATCH, count - base);
+        memcpy(regs[IN_ANGLE], inputs.angle + base, lanes * sizeof(float));
+        memcpy(regs[IN_COS_ANGLE], inputs.cosAngle + base, lanes * sizeof(float));
+        memcpy(regs[IN_SIN_ANGLE], inputs.sinAngle + base, lanes * sizeof(float));
+        memcpy(regs[IN_BAND], inputs.band + base, lanes * sizeof(float));
+        memcpy(regs[IN_INDEX], inputs.index + base, lanes * sizeof(float));
+
+        // Always full batches: the tail lanes compute garbage that is never copied out
+        for (const Instruction& ins : code) {
+            float* d = regs[ins.dst];
+            const float* a = regs[ins.a];
+            const float* b = regs[ins.b];
+            switch (ins.op) {
+            case OP_ADD: applyBatch<OP_ADD>(d, a, b); break;
+            case OP_SUB: applyBatch<OP_SUB>(d, a, b); break;
+            case OP_MUL: applyBatch<OP_MUL>(d, a, b); break;
+            case OP_DIV: applyBatch<OP_DIV>(d, a, b); break;
+            case OP_MOD: applyBatch<OP_MOD>(d, a, b); break;
+            case OP_POW: applyBatch<OP_POW>(d, a, b); break;
+            case OP_MIN: applyBatch<OP_MIN>(d, a, b); break;
+            case OP_MAX: applyBatch<OP_MAX>(d, a, b); break;
+            case OP_NEG: applyBatch<OP_NEG>(d, a, b); break;
+            case OP_ABS: applyBatch<OP_ABS>(d, a, b); break;
+            case OP_SQRT: applyBatch<OP_SQRT>(d, a, b); break;
+            case OP_SIN: applyBatch<OP_SIN>(d, a, b); break;
+            case OP_COS: applyBatch<OP_COS>(d, a, b); break;
+            case OP_TAN: applyBatch<OP_TAN>(d, a, b); break;
+            case OP_EXP: applyBatch<OP_EXP>(d, a, b); break;
+            case OP_LOG: applyBatch<OP_LOG>(d, a, b); break;
+            case OP_FLOOR: applyBatch<OP_FLOOR>(d, a, b); break;
+            case OP_FRACT: applyBatch<OP_FRACT>(d, a, b); break;
+            }
+        }
+
+        memcpy(x + base, regs[outputX], lanes * sizeof(float));
+        memcpy(y + base, regs[outputY], lanes * sizeof(float));
+        memcpy(color + base, regs[outputColor], lanes * sizeof(float));
+    }
+}
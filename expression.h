@@ -0,0 +1,74 @@
+#ifndef EXPRESSION_H
+#define EXPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config_parser.h"
+
+/**
+ * @brief Per-frame inputs of an expression visualizer.
+ *
+ * `angle`, `band` and `index` hold one value per point; the rest are the
+ * same for every point in a frame.
+ */
+struct ExpressionInputs {
+    const float* angle;    // Radians, 0 to 2*pi around the circle
+    const float* cosAngle; // cos(angle) and sin(angle), from the caller's trig table
+    const float* sinAngle;
+    const float* band;     // Decayed energy of this point's frequency slice, about 0 to 1
+    const float* index;    // Point number, 0 to count - 1
+    float time;            // Media time in seconds: where the audio drawn is, not the wall clock
+    float beat;            // 1 on a detected beat, decaying towards 0
+    float level;           // Overall RMS level, 0 to 1
+};
+
+/**
+ * @brief The formulas of an expression visualizer, compiled to register bytecode.
+ *
+ * All formulas of one visualizer compile into a single program. A `radius`
+ * formula is turned into `x = radius * cos(angle)`, `y = radius * sin(angle)`
+ * at compile time, and constant sub-expressions are folded away, so the
+ * program only does the work that really varies per point. cos(angle) and
+ * sin(angle) are read from the caller's trig table instead of computed.
+ *
+ * Registers are arrays of BATCH floats and every instruction runs over a
+ * whole batch in a plain loop, so the interpreter pays its dispatch cost
+ * once per batch rather than once per point, and the compiler can vectorize
+ * the loops.
+ *
+ * Formulas use + - * / % ^, parentheses, the variables angle, band, index,
+ * time, beat, level and pi, and the functions sin cos tan abs sqrt exp log
+ * floor fract min max pow mod clamp mix.
+ */
+class ExpressionProgram {
+public:
+    static const int BATCH = 64;
+    static const int MAX_REGISTERS = 64;
+
+    // Compiles the formulas in `sources` (indexed by ExpressionSlot; empty means unset).
+    // On failure, `errorSlot` and `errorOffset` locate the problem within its formula.
+    bool compile(const std::string* sources, std::string& error, int& errorSlot, size_t& errorOffset);
+
+    // Evaluates `count` points, writing shape-space positions and 0-1 colors.
+    void run(const ExpressionInputs& inputs, size_t count, float* x, float* y, float* color) const;
+
+    size_t instructionCount() const { return code.size(); }
+
+private:
+    struct Instruction {
+        uint8_t op;
+        uint8_t dst;
+        uint8_t a;
+        uint8_t b;
+    };
+    std::vector<Instruction> code;
+    std::vector<float> constants;  // Values of the constant registers, in register order
+    int registerCount = 0;
+    uint8_t outputX = 0, outputY = 0, outputColor = 0;
+
+    friend class ExpressionCompiler;
+};
+
+#endif // EXPRESSION_H
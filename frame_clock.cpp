@@ -0,0 +1,137 @@
+#include "frame_clock.h"
+#include <sys/timerfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <algorithm>
+
+namespace {
+// Upper bounds (in microseconds) of the jitter histogram buckets; the last bucket is open-ended.
+const int64_t BUCKET_LIMITS_US[FrameClock::JITTER_BUCKETS - 1] = {100, 250, 500, 1000, 2000, 4000, 8000};
+const char* BUCKET_LABELS[FrameClock::JITTER_BUCKETS] = {
+    "<0.1ms", "<0.25ms", "<0.5ms", "<1ms", "<2ms", "<4ms", "<8ms", ">=8ms"
+};
+const int MAX_BURST = 4; // Frames rendered back to back before giving up and resyncing
+
+timespec toTimespec(int64_t ns) {
+    timespec ts;
+    ts.tv_sec = ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return ts;
+}
+}
+
+FrameClock::FrameClock(CatchUpPolicy policy)
+: timer_fd(timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK)), policy(policy), deadline_ns(now()) {}
+
+FrameClock::~FrameClock() {
+    if (timer_fd >= 0) close(timer_fd);
+}
+
+int64_t FrameClock::now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+void FrameClock::setPeriod(std::chrono::nanoseconds period) {
+    period_ns = std::max<int64_t>(1, period.count());
+}
+
+const char* FrameClock::bucketLabel(int bucket) {
+    return BUCKET_LABELS[bucket];
+}
+
+double FrameClock::meanJitterUs() const {
+    return samples ? (total_jitter_ns / static_cast<double>(samples)) / 1000.0 : 0.0;
+}
+
+void FrameClock::recordJitter(int64_t lateness_ns) {
+    lateness_ns = std::max<int64_t>(0, lateness_ns);
+    int bucket = 0;
+    while (bucket < JITTER_BUCKETS - 1 && lateness_ns >= BUCKET_LIMITS_US[bucket] * 1000) bucket++;
+    histogram[bucket]++;
+    samples++;
+    total_jitter_ns += lateness_ns;
+    max_jitter_ns = std::max(max_jitter_ns, lateness_ns);
+}
+
+void FrameClock::scheduleNextFrame() {
+    deadline_ns += period_ns;
+    due_now = false;
+    int64_t current = now();
+
+    if (current >= deadline_ns) {
+        // The last frame overran its slot
+        int64_t behind = (current - deadline_ns) / period_ns + 1;
+        if (policy == CatchUpPolicy::BURST && burst_run < MAX_BURST) {
+            // Render the missed frame right away; the grid stays where it was
+            burst_run++;
+            burst_frames++;
+            due_now = true;
+            return;
+        }
+        // Drop the missed slots and wait for the next grid point
+        missed_frames += behind;
+        deadline_ns += behind * period_ns;
+    }
+    burst_run = 0;
+
+    if (timer_fd >= 0) {
+        itimerspec spec = {};
+        spec.it_value = toTimespec(deadline_ns);
+        if (timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &spec, nullptr) < 0) {
+            close(timer_fd);
+            timer_fd = -1; // Fall back to ppoll() timeouts
+        }
+    }
+}
+
+int FrameClock::wait(const int* fds, int count) {
+    if (due_now) {
+        due_now = false;
+        recordJitter(now() - deadline_ns);
+        return FRAME_DUE;
+    }
+
+    pollfd pfds[MAX_WAIT_FDS + 1];
+    count = std::min(count, MAX_WAIT_FDS);
+    for (int i = 0; i < count; ++i) {
+        pfds[i].fd = fds[i];
+        pfds[i].events = POLLIN;
+        pfds[i].revents = 0;
+    }
+    int nfds = count;
+    if (timer_fd >= 0) {
+        pfds[nfds].fd = timer_fd;
+        pfds[nfds].events = POLLIN;
+        pfds[nfds].revents = 0;
+        nfds++;
+    }
+
+    for (;;) {
+        timespec timeout;
+        timespec* timeout_ptr = nullptr;
+        if (timer_fd < 0) {
+            timeout = toTimespec(std::max<int64_t>(0, deadline_ns - now()));
+            timeout_ptr = &timeout;
+        }
+        int ret = ppoll(pfds, nfds, timeout_ptr, nullptr);
+        if (ret < 0) {
+            if (errno == EINTR) return INTERRUPTED;
+            break;
+        }
+        // Input first, so a keystroke that lands with the tick is seen by this frame
+        for (int i = 0; i < count; ++i) {
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) return i;
+        }
+        if (timer_fd >= 0 && (pfds[count].revents & POLLIN)) {
+            uint64_t expirations;
+            if (read(timer_fd, &expirations, sizeof(expirations)) < 0 && errno == EAGAIN) continue;
+            break;
+        }
+        if (timer_fd < 0 && now() >= deadline_ns) break;
+    }
+    recordJitter(now() - deadline_ns);
+    return FRAME_DUE;
+}
@@ -0,0 +1,68 @@
+#ifndef FRAME_CLOCK_H
+#define FRAME_CLOCK_H
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ctime>
+#include "config_parser.h"
+
+/**
+ * @brief Frame timer driven by absolute CLOCK_MONOTONIC deadlines.
+ *
+ * Deadlines live on a fixed grid (start + n * period), so oversleeping one
+ * frame never shifts the following ones. The wait is done on a timerfd armed
+ * with TFD_TIMER_ABSTIME and polled together with the caller's descriptors
+ * (stdin and friends), so input is handled the moment it arrives without
+ * any per-frame syscalls when nothing is pending.
+ */
+class FrameClock {
+public:
+    static const int JITTER_BUCKETS = 8;
+    static const int MAX_WAIT_FDS = 8;
+    static const int FRAME_DUE = -1;    // wait(): the frame deadline has been reached
+    static const int INTERRUPTED = -2;  // wait(): a signal arrived (e.g. SIGWINCH)
+
+    explicit FrameClock(CatchUpPolicy policy);
+    ~FrameClock();
+    FrameClock(const FrameClock&) = delete;
+    FrameClock& operator=(const FrameClock&) = delete;
+
+    void setPeriod(std::chrono::nanoseconds period);
+    void setPolicy(CatchUpPolicy newPolicy) { policy = newPolicy; }
+
+    // Moves to the next deadline on the frame grid and arms the timer.
+    void scheduleNextFrame();
+
+    // Blocks until the scheduled deadline or until one of `fds` is readable.
+    // Returns the index of the readable fd, INTERRUPTED, or FRAME_DUE (after
+    // recording how late we woke up). Call again after handling an fd.
+    int wait(const int* fds, int count);
+
+    uint64_t missedFrames() const { return missed_frames; }
+    uint64_t burstFrames() const { return burst_frames; }
+    double meanJitterUs() const;
+    double maxJitterUs() const { return max_jitter_ns / 1000.0; }
+    const std::array<uint64_t, JITTER_BUCKETS>& jitterHistogram() const { return histogram; }
+    static const char* bucketLabel(int bucket);
+
+private:
+    int timer_fd;
+    CatchUpPolicy policy;
+    int64_t period_ns = 16666667;
+    int64_t deadline_ns;
+    int burst_run = 0;
+    bool due_now = false;   // Burst policy: the next frame is already late, don't sleep
+
+    uint64_t missed_frames = 0;
+    uint64_t burst_frames = 0;
+    uint64_t samples = 0;
+    int64_t total_jitter_ns = 0;
+    int64_t max_jitter_ns = 0;
+    std::array<uint64_t, JITTER_BUCKETS> histogram = {};
+
+    static int64_t now();
+    void recordJitter(int64_t lateness_ns);
+};
+
+#endif // FRAME_CLOCK_H
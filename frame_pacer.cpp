@@ -0,0 +1,74 @@
+#include "frame_pacer.h"
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <algorithm>
+
+namespace {
+// Fraction of the target rate used at each pacing level. Level 1 keeps the
+// full rate but asks the renderer for fewer escape sequences.
+const float LEVEL_FPS_SCALE[] = {1.0f, 1.0f, 0.75f, 0.5f, 0.33f, 0.25f};
+const int MAX_LEVEL = sizeof(LEVEL_FPS_SCALE) / sizeof(LEVEL_FPS_SCALE[0]) - 1;
+const int MIN_FPS = 10;
+
+const int SATURATED_QUEUE_BYTES = 2048;  // Terminal is not keeping up
+const int SKIP_QUEUE_BYTES = 16384;      // Anything drawn now is already stale
+const int FRAMES_BEFORE_STEP_DOWN = 8;
+const float FLUSH_EMA_WEIGHT = 0.1f;
+}
+
+FramePacer::FramePacer(int outputFd, int targetFps)
+: output_fd(outputFd), target_fps(std::max(1, targetFps)) {}
+
+void FramePacer::setTargetFps(int fps) {
+    target_fps = std::max(1, fps);
+    level = 0;
+    saturated_frames = 0;
+    drained_frames = 0;
+}
+
+int FramePacer::readOutputQueue() const {
+    int pending = 0;
+    if (ioctl(output_fd, TIOCOUTQ, &pending) < 0) return 0;
+    return pending;
+}
+
+int FramePacer::currentFps() const {
+    int fps = static_cast<int>(target_fps * LEVEL_FPS_SCALE[level] + 0.5f);
+    return std::max(std::min(MIN_FPS, target_fps), fps);
+}
+
+std::chrono::microseconds FramePacer::frameDuration() const {
+    return std::chrono::microseconds(1000000 / currentFps());
+}
+
+void FramePacer::recordFlush(std::chrono::microseconds flushTime) {
+    avg_flush_us += (static_cast<float>(flushTime.count()) - avg_flush_us) * FLUSH_EMA_WEIGHT;
+    queued_bytes = readOutputQueue();
+
+    const float budget_us = static_cast<float>(frameDuration().count());
+    bool saturated = queued_bytes > SATURATED_QUEUE_BYTES || avg_flush_us > budget_us * 0.5f;
+    bool drained = queued_bytes == 0 && avg_flush_us < budget_us * 0.25f;
+
+    if (saturated) {
+        drained_frames = 0;
+        if (++saturated_frames >= FRAMES_BEFORE_STEP_DOWN && level < MAX_LEVEL) {
+            level++;
+            saturated_frames = 0;
+        }
+    } else if (drained) {
+        saturated_frames = 0;
+        // Ramp back up only after a full second of healthy frames
+        if (++drained_frames >= currentFps() && level > 0) {
+            level--;
+            drained_frames = 0;
+        }
+    } else {
+        saturated_frames = 0;
+        drained_frames = 0;
+    }
+}
+
+bool FramePacer::shouldSkipFrame() {
+    queued_bytes = readOutputQueue();
+    return queued_bytes > SKIP_QUEUE_BYTES;
+}
@@ -0,0 +1,47 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+
+/**
+ * @brief Adapts the frame rate to how fast the terminal drains our output.
+ *
+ * After every flush the pacer is told how long doupdate() blocked and it
+ * samples the tty output queue (TIOCOUTQ). When the terminal falls behind
+ * (slow SSH links, busy terminal emulators) it first drops to a cheaper
+ * rendering level, then lowers the frame rate step by step. Once the queue
+ * drains it ramps back up to the target rate.
+ */
+class FramePacer {
+public:
+    FramePacer(int outputFd, int targetFps);
+
+    // Changes the rate the pacer ramps back up to; pacing restarts at full detail.
+    void setTargetFps(int fps);
+
+    // Call once per frame with the time spent inside doupdate().
+    void recordFlush(std::chrono::microseconds flushTime);
+
+    // True when the output queue is so deep that a new frame would only add latency.
+    bool shouldSkipFrame();
+
+    std::chrono::microseconds frameDuration() const;
+    int currentFps() const;
+    int targetFps() const { return target_fps; }
+    bool reducedDetail() const { return level > 0; }
+    int queuedBytes() const { return queued_bytes; }
+    float averageFlushMs() const { return avg_flush_us / 1000.0f; }
+
+private:
+    int output_fd;
+    int target_fps;
+    int level = 0;              // 0 = full rate and detail, higher = cheaper
+    int saturated_frames = 0;
+    int drained_frames = 0;
+    int queued_bytes = 0;
+    float avg_flush_us = 0.0f;
+
+    int readOutputQueue() const;
+};
+
+#endif // FRAME_PACER_H
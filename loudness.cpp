@@ -0,0 +1,116 @@
+#include "loudness.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+// BS.1770 channel weight: surrounds count 1.41 times, the LFE not at all
+float loudnessWeight(ChannelPosition position) {
+    switch (position) {
+        case ChannelPosition::LFE: return 0.0f;
+        case ChannelPosition::REAR_LEFT:
+        case ChannelPosition::REAR_RIGHT:
+        case ChannelPosition::SIDE_LEFT:
+        case ChannelPosition::SIDE_RIGHT: return 1.41f;
+        default: return 1.0f;
+    }
+}
+
+bool sameLayout(const ChannelMap& a, const ChannelMap& b) {
+    return a.channels == b.channels && std::equal(a.position, a.position + a.channels, b.position);
+}
+
+float loudnessOf(double meanSquare) {
+    return meanSquare > 0.0 ? -0.691f + 10.0f * static_cast<float>(std::log10(meanSquare)) : -INFINITY;
+}
+
+} // namespace
+
+/**
+ * @brief Builds the K-weighting filters for a sample rate (BS.1770-4, as in libebur128).
+ */
+void LoudnessMeter::buildKWeighting(uint32_t sampleRate) {
+    const double PI = 3.14159265358979323846;
+    // Stage 1: high shelf modelling the head, +4 dB above about 1.5 kHz
+    double f0 = 1681.974450955533, gain_db = 3.999843853973347, q = 0.7071752369554196;
+    double k = std::tan(PI * f0 / sampleRate);
+    double vh = std::pow(10.0, gain_db / 20.0);
+    double vb = std::pow(vh, 0.4996667741545416);
+    double a0 = 1.0 + k / q + k * k;
+    shelf.b0 = static_cast<float>((vh + vb * k / q + k * k) / a0);
+    shelf.b1 = static_cast<float>(2.0 * (k * k - vh) / a0);
+    shelf.b2 = static_cast<float>((vh - vb * k / q + k * k) / a0);
+    shelf.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    shelf.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+    // Stage 2: the RLB high-pass
+    f0 = 38.13547087602444;
+    q = 0.5003270373238773;
+    k = std::tan(PI * f0 / sampleRate);
+    a0 = 1.0 + k / q + k * k;
+    highPass.b0 = 1.0f;
+    highPass.b1 = -2.0f;
+    highPass.b2 = 1.0f;
+    highPass.a1 = static_cast<float>(2.0 * (k * k - 1.0) / a0);
+    highPass.a2 = static_cast<float>((1.0 - k / q + k * k) / a0);
+}
+
+void LoudnessMeter::reset() {
+    std::fill(block_energy.begin(), block_energy.end(), 0.0f);
+    std::fill(&filter_state[0][0], &filter_state[0][0] + MAX_CHANNELS * 4, 0.0f);
+    std::fill(window_sum, window_sum + MAX_CHANNELS, 0.0);
+    std::fill(peak_db, peak_db + MAX_CHANNELS, -INFINITY);
+    next_block = 0;
+    filled_blocks = 0;
+}
+
+bool LoudnessMeter::addBuffer(const ChannelBuffers& channels, uint32_t sampleRate) {
+    bool started_over = false;
+    if (sample_rate != sampleRate || !sameLayout(map, channels.map)) {
+        if (sample_rate != sampleRate) {
+            buildKWeighting(sampleRate);
+            // Only on a rate change; the window is then reused buffer after buffer
+            window_blocks = std::max(1, static_cast<int>(std::lround(WINDOW_SECONDS * sampleRate / BUFFER_FRAMES)));
+            block_energy.assign(static_cast<size_t>(window_blocks) * MAX_CHANNELS, 0.0f);
+        }
+        sample_rate = sampleRate;
+        map = channels.map;
+        reset();
+        started_over = true;
+    }
+
+    // Add this buffer as one block of the window, dropping the oldest
+    float* block = &block_energy[static_cast<size_t>(next_block) * MAX_CHANNELS];
+    for (int c = 0; c < map.channels; ++c) {
+        float* z = filter_state[c];
+        float sum_sq = 0.0f;
+        int peak = 0;
+        for (int i = 0; i < BUFFER_FRAMES; ++i) {
+            int sample = channels.data[c][i];
+            peak = std::max(peak, std::abs(sample));
+            float y = highPass.process(shelf.process(sample / 32768.0f, z[0], z[1]), z[2], z[3]);
+            sum_sq += y * y;
+        }
+        float energy = sum_sq / BUFFER_FRAMES;
+        window_sum[c] += static_cast<double>(energy) - block[c];
+        if (window_sum[c] < 0.0) window_sum[c] = 0.0;  // Rounding, after long silence
+        block[c] = energy;
+        peak_db[c] = peak > 0 ? 20.0f * std::log10(peak / 32768.0f) : -INFINITY;
+    }
+    next_block = (next_block + 1) % window_blocks;
+    filled_blocks = std::min(filled_blocks + 1, window_blocks);
+    return started_over;
+}
+
+float LoudnessMeter::channelLoudness(int channel) const {
+    return filled_blocks > 0 ? loudnessOf(window_sum[channel] / filled_blocks) : -INFINITY;
+}
+
+float LoudnessMeter::momentary() const {
+    if (filled_blocks == 0) return -INFINITY;
+    double weighted_sum = 0.0;
+    for (int c = 0; c < map.channels; ++c) {
+        weighted_sum += loudnessWeight(map.position[c]) * window_sum[c] / filled_blocks;
+    }
+    return loudnessOf(weighted_sum);
+}
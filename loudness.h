@@ -0,0 +1,62 @@
+#ifndef LOUDNESS_H
+#define LOUDNESS_H
+
+#include <cstdint>
+#include <vector>
+#include "channel_ring.h"
+
+/**
+ * @brief One biquad section, transposed direct form II.
+ */
+struct Biquad {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+
+    float process(float x, float& z1, float& z2) const {
+        float y = b0 * x + z1;
+        z1 = b1 * x - a1 * y + z2;
+        z2 = b2 * x - a2 * y;
+        return y;
+    }
+};
+
+/**
+ * @brief Momentary loudness of every channel: ITU-R BS.1770 K-weighting over 400 ms.
+ *
+ * Each buffer adds one block of mean squares per channel; running sums
+ * over the window are updated by adding the new block and removing the
+ * one it replaces, so a buffer costs the same whatever the window size.
+ * Shared by the channel meter and the offline analysis, so both read the
+ * same numbers.
+ */
+class LoudnessMeter {
+public:
+    static constexpr float WINDOW_SECONDS = 0.4f;
+
+    // Adds one buffer; true when a new rate or layout made the meter start over first
+    bool addBuffer(const ChannelBuffers& channels, uint32_t sampleRate);
+    // Forgets the window and the filter state
+    void reset();
+
+    // LUFS over the window, -INFINITY for silence
+    float channelLoudness(int channel) const;
+    // All channels together, weighted as BS.1770 does (the LFE is left out)
+    float momentary() const;
+    // Sample peak of the last buffer in dBFS, -INFINITY for silence
+    float peakDb(int channel) const { return peak_db[channel]; }
+
+private:
+    uint32_t sample_rate = 0;          // Filters and window are built for this rate
+    ChannelMap map;                    // and this layout; either changing starts over
+    Biquad shelf, highPass;            // The two K-weighting stages
+    float filter_state[MAX_CHANNELS][4] = {{0}};
+    std::vector<float> block_energy;   // Window of blocks x MAX_CHANNELS mean squares
+    double window_sum[MAX_CHANNELS] = {0};
+    int window_blocks = 1;
+    int next_block = 0;
+    int filled_blocks = 0;
+    float peak_db[MAX_CHANNELS] = {0};
+
+    void buildKWeighting(uint32_t sampleRate);
+};
+
+#endif // LOUDNESS_H
@@ -0,0 +1,71 @@
+/*
+ * mallard_shm.h - layout of the analysis published in POSIX shared memory.
+ *
+ * Plain C so status bars and scripts can read it without any of the
+ * visualizer's code. Open the region read-only with shm_open(name, O_RDONLY),
+ * mmap sizeof(struct mallard_shm) bytes, check magic, version and the size
+ * fields, then call mallard_shm_read() as often as you like. Readers never
+ * write to the region, so any number of them cost the producer nothing.
+ *
+ * The frame is guarded by a seqlock: the producer makes `sequence` odd,
+ * writes the frame, then makes it even again. A reader copies the frame and
+ * keeps the copy only if `sequence` was the same even value before and after.
+ *
+ * Later versions only append fields to the end of struct mallard_shm_frame,
+ * so a reader built against version N works with any version >= N whose
+ * frame_size is at least sizeof(struct mallard_shm_frame). The region stays
+ * in place when the producer exits (producer_pid becomes 0), and a restarted
+ * producer takes it over, so readers can keep their mapping.
+ */
+#ifndef MALLARD_SHM_H
+#define MALLARD_SHM_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define MALLARD_SHM_DEFAULT_NAME "/mallard"
+#define MALLARD_SHM_MAGIC 0x4d4c5348u /* "MLSH" */
+#define MALLARD_SHM_VERSION 1u
+#define MALLARD_SHM_BANDS 32
+#define MALLARD_SHM_WAVEFORM_POINTS 128
+
+struct mallard_shm_frame {
+    uint64_t frame_number;      /* Increases by one per published frame */
+    uint64_t timestamp_ns;      /* CLOCK_MONOTONIC time of publication */
+    uint32_t sample_rate;
+    uint32_t audio_active;      /* 0 while the producer has no audio */
+    float rms[2];               /* Left, right; 0 to 1 */
+    float peak[2];              /* 0 to 1 */
+    float bands[2][MALLARD_SHM_BANDS];           /* 0 to 1 */
+    float waveform[2][MALLARD_SHM_WAVEFORM_POINTS]; /* -1 to 1 */
+};
+
+struct mallard_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t header_size;       /* offsetof(struct mallard_shm, frame) */
+    uint32_t frame_size;        /* sizeof(struct mallard_shm_frame) */
+    uint32_t bands;             /* MALLARD_SHM_BANDS */
+    uint32_t waveform_points;   /* MALLARD_SHM_WAVEFORM_POINTS */
+    uint32_t producer_pid;      /* 0 once the producer has exited */
+    uint32_t sequence;          /* Seqlock counter; odd while the frame is being written */
+    struct mallard_shm_frame frame;
+};
+
+/*
+ * Copies the current frame into `out`. Returns 1 on success, or 0 if the
+ * producer kept writing through every attempt (try again next poll).
+ */
+static inline int mallard_shm_read(const struct mallard_shm* shm, struct mallard_shm_frame* out) {
+    int attempt;
+    for (attempt = 0; attempt < 16; ++attempt) {
+        uint32_t before = __atomic_load_n(&shm->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1u) continue;
+        memcpy(out, (const void*)&shm->frame, sizeof(*out));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&shm->sequence, __ATOMIC_RELAXED) == before) return 1;
+    }
+    return 0;
+}
+
+#endif /* MALLARD_SHM_H */
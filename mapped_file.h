@@ -0,0 +1,86 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <string>
+
+/**
+ * @brief Read-only memory mapping of a whole file, unmapped on destruction.
+ *
+ * `ok` is true when the file could be opened; an empty file maps to
+ * `data == nullptr, size == 0`.
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            ok = true;
+            size = static_cast<size_t>(st.st_size);
+            if (size > 0) {
+                void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) { ok = false; size = 0; }
+                else data = static_cast<const char*>(mapped);
+            }
+        }
+        close(fd);
+    }
+    ~MappedFile() {
+        if (data) munmap(const_cast<char*>(data), size);
+    }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool ok = false;
+    const char* data = nullptr;
+    size_t size = 0;
+};
+
+/**
+ * @brief A copy of a whole file, read with read(2), for files a user edits.
+ *
+ * A MappedFile faults with SIGBUS if the file is truncated while it is
+ * being read, which an editor saving the config or an SVG can do at any
+ * moment. A copy only ever sees a stale or half-written text, which the
+ * parser reports. Same `ok`, `data` and `size` as MappedFile.
+ */
+class FileContents {
+public:
+    explicit FileContents(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return;
+        struct stat st;
+        if (fstat(fd, &st) == 0) text.reserve(static_cast<size_t>(st.st_size));
+        // Read to end of file rather than to st_size, which may be stale by now
+        char chunk[65536];
+        for (;;) {
+            ssize_t got = ::read(fd, chunk, sizeof(chunk));
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) { close(fd); return; }
+            if (got == 0) break;
+            text.append(chunk, static_cast<size_t>(got));
+        }
+        close(fd);
+        ok = true;
+        data = text.data();
+        size = text.size();
+    }
+    FileContents(const FileContents&) = delete;
+    FileContents& operator=(const FileContents&) = delete;
+
+    bool ok = false;
+    const char* data = nullptr;
+    size_t size = 0;
+
+private:
+    std::string text;
+};
+
+#endif // MAPPED_FILE_H
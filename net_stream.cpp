@@ -0,0 +1,583 @@
+#include "net_stream.h"
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const uint8_t MAGIC_0 = 'M';
+const uint8_t MAGIC_1 = 'S';
+const uint8_t STREAM_VERSION = 1;
+const uint8_t FLAG_KEYFRAME = 1;
+const uint8_t FLAG_AUDIO_ACTIVE = 2;
+const size_t NOT_SMALLER = SIZE_MAX; // encodeDelta(): the delta would not beat a keyframe
+const size_t MAX_RUN = 255;
+const size_t MAX_CLIENTS = 32;
+const size_t STREAM_LENGTH_BYTES = 2; // On TCP and Unix sockets every packet is preceded by its u16 length
+const std::chrono::seconds RECONNECT_DELAY(1);
+// A keyframe further behind the newest frame than reordering ever puts one comes from a restarted publisher
+const uint32_t RESTART_DISTANCE = 2 * STREAM_KEYFRAME_INTERVAL;
+
+void putU16(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v);
+    p[1] = static_cast<uint8_t>(v >> 8);
+}
+
+void putU32(uint8_t* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<uint8_t>(v >> (8 * i));
+}
+
+uint32_t getU16(const uint8_t* p) {
+    return p[0] | (p[1] << 8);
+}
+
+uint32_t getU32(const uint8_t* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Sequence numbers wrap, so "newer" means less than half the range ahead.
+bool isNewer(uint32_t a, uint32_t b) {
+    return static_cast<int32_t>(a - b) > 0;
+}
+
+/**
+ * @brief Encodes `current` against `reference` as (unchanged count, changed count, changed bytes) runs.
+ *
+ * Trailing unchanged bytes are implied. Returns NOT_SMALLER once the output
+ * would reach the size of the frame itself.
+ */
+size_t encodeDelta(const uint8_t* current, const uint8_t* reference, uint8_t* out) {
+    size_t length = 0;
+    size_t i = 0;
+    while (i < QUANTIZED_FRAME_BYTES) {
+        size_t same = 0;
+        while (i < QUANTIZED_FRAME_BYTES && same < MAX_RUN && current[i] == reference[i]) { ++same; ++i; }
+        if (i == QUANTIZED_FRAME_BYTES) break;
+        size_t start = i;
+        while (i < QUANTIZED_FRAME_BYTES && i - start < MAX_RUN && current[i] != reference[i]) ++i;
+        size_t changed = i - start;
+        if (length + 2 + changed >= QUANTIZED_FRAME_BYTES) return NOT_SMALLER;
+        out[length++] = static_cast<uint8_t>(same);
+        out[length++] = static_cast<uint8_t>(changed);
+        std::memcpy(out + length, current + start, changed);
+        length += changed;
+    }
+    return length;
+}
+
+bool applyDelta(const uint8_t* reference, const uint8_t* delta, size_t length, uint8_t* out) {
+    std::memcpy(out, reference, QUANTIZED_FRAME_BYTES);
+    size_t pos = 0;
+    size_t i = 0;
+    while (i < length) {
+        if (length - i < 2) return false;
+        size_t same = delta[i];
+        size_t changed = delta[i + 1];
+        i += 2;
+        if (length - i < changed || pos + same + changed > QUANTIZED_FRAME_BYTES) return false;
+        pos += same;
+        std::memcpy(out + pos, delta + i, changed);
+        pos += changed;
+        i += changed;
+    }
+    return true;
+}
+
+bool resolve(const StreamEndpoint& endpoint, bool passive, sockaddr_storage& address, socklen_t& length, std::string& error) {
+    if (endpoint.transport == StreamEndpoint::UNIX) {
+        sockaddr_un& local = reinterpret_cast<sockaddr_un&>(address);
+        if (endpoint.path.size() >= sizeof(local.sun_path)) {
+            error = "Socket path '" + endpoint.path + "' is too long";
+            return false;
+        }
+        std::memset(&local, 0, sizeof(local));
+        local.sun_family = AF_UNIX;
+        std::memcpy(local.sun_path, endpoint.path.c_str(), endpoint.path.size() + 1);
+        length = offsetof(sockaddr_un, sun_path) + endpoint.path.size() + 1;
+        return true;
+    }
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = endpoint.transport == StreamEndpoint::TCP ? SOCK_STREAM : SOCK_DGRAM;
+    hints.ai_flags = passive ? AI_PASSIVE : 0;
+    addrinfo* result = nullptr;
+    const char* host = endpoint.host.empty() ? nullptr : endpoint.host.c_str();
+    int rc = getaddrinfo(host, endpoint.port.c_str(), &hints, &result);
+    if (rc != 0 || !result) {
+        error = "Cannot resolve '" + endpoint.host + ":" + endpoint.port + "': " + gai_strerror(rc);
+        return false;
+    }
+    std::memcpy(&address, result->ai_addr, result->ai_addrlen);
+    length = result->ai_addrlen;
+    freeaddrinfo(result);
+    return true;
+}
+
+bool isMulticast(const sockaddr_storage& address) {
+    if (address.ss_family == AF_INET) {
+        return IN_MULTICAST(ntohl(reinterpret_cast<const sockaddr_in&>(address).sin_addr.s_addr));
+    }
+    if (address.ss_family == AF_INET6) {
+        return IN6_IS_ADDR_MULTICAST(&reinterpret_cast<const sockaddr_in6&>(address).sin6_addr);
+    }
+    return false;
+}
+
+std::string systemError(const std::string& what) {
+    return what + ": " + std::strerror(errno);
+}
+
+// Gives up on a socket open() could not set up, leaving the object unopened
+bool abandonSocket(int& fd) {
+    close(fd);
+    fd = -1;
+    return false;
+}
+
+} // namespace
+
+// --- Codec ---
+
+size_t StreamEncoder::encode(const QuantizedFrame& frame, uint8_t* packet) {
+    uint8_t* body = packet + STREAM_HEADER_BYTES;
+    bool keyframe = !have_reference || (base == LAST_KEYFRAME && frames_since_key >= STREAM_KEYFRAME_INTERVAL);
+    size_t payload = keyframe ? NOT_SMALLER : encodeDelta(frame.bytes, reference, body);
+    if (payload == NOT_SMALLER) {
+        keyframe = true;
+        std::memcpy(body, frame.bytes, QUANTIZED_FRAME_BYTES);
+        payload = QUANTIZED_FRAME_BYTES;
+    }
+
+    packet[0] = MAGIC_0;
+    packet[1] = MAGIC_1;
+    packet[2] = STREAM_VERSION;
+    packet[3] = (keyframe ? FLAG_KEYFRAME : 0) | (frame.audioActive ? FLAG_AUDIO_ACTIVE : 0);
+    putU32(packet + 4, sequence);
+    putU32(packet + 8, keyframe ? sequence : reference_sequence);
+    putU32(packet + 12, frame.sampleRate);
+    putU16(packet + 16, static_cast<uint32_t>(payload));
+
+    if (keyframe || base == PREVIOUS_FRAME) {
+        std::memcpy(reference, frame.bytes, QUANTIZED_FRAME_BYTES);
+        reference_sequence = sequence;
+        have_reference = true;
+    }
+    frames_since_key = keyframe ? 1 : frames_since_key + 1;
+    sequence++;
+    return STREAM_HEADER_BYTES + payload;
+}
+
+bool StreamDecoder::decode(const uint8_t* packet, size_t length, QuantizedFrame& out) {
+    if (length < STREAM_HEADER_BYTES || packet[0] != MAGIC_0 || packet[1] != MAGIC_1 ||
+        packet[2] != STREAM_VERSION || length != STREAM_HEADER_BYTES + getU16(packet + 16)) {
+        counters.undecodable++;
+        return false;
+    }
+    const uint8_t flags = packet[3];
+    const uint32_t sequence = getU32(packet + 4);
+    const uint32_t base = getU32(packet + 8);
+    const uint8_t* body = packet + STREAM_HEADER_BYTES;
+    const size_t payload = length - STREAM_HEADER_BYTES;
+
+    const auto now = std::chrono::steady_clock::now();
+    if (have_sequence && !isNewer(sequence, newest_sequence)) {
+        // A restarted publisher counts from 0 again: its first keyframe after a
+        // silence, or from far behind, starts the stream over instead of being late
+        const bool restarted = (flags & FLAG_KEYFRAME) &&
+                               (now - last_decoded > STREAM_TIMEOUT || newest_sequence - sequence > RESTART_DISTANCE);
+        if (!restarted) {
+            counters.late++;
+            return false;
+        }
+        reset();
+    }
+
+    uint8_t decoded[QUANTIZED_FRAME_BYTES];
+    if (flags & FLAG_KEYFRAME) {
+        if (payload != QUANTIZED_FRAME_BYTES) {
+            counters.undecodable++;
+            return false;
+        }
+        std::memcpy(decoded, body, QUANTIZED_FRAME_BYTES);
+        std::memcpy(key, body, QUANTIZED_FRAME_BYTES);
+        key_sequence = sequence;
+        have_key = true;
+    } else {
+        const uint8_t* reference = nullptr;
+        if (have_key && base == key_sequence) reference = key;
+        else if (have_last && base == last_sequence) reference = last;
+        if (!reference || !applyDelta(reference, body, payload, decoded)) {
+            counters.undecodable++;
+            return false;
+        }
+    }
+
+    // Only a packet that decoded moves the window; a broken one must not hide the frames before it
+    if (have_sequence) counters.lost += sequence - newest_sequence - 1;
+    have_sequence = true;
+    newest_sequence = sequence;
+    last_decoded = now;
+    std::memcpy(last, decoded, QUANTIZED_FRAME_BYTES);
+    last_sequence = sequence;
+    have_last = true;
+
+    std::memcpy(out.bytes, decoded, QUANTIZED_FRAME_BYTES);
+    out.sampleRate = getU32(packet + 12);
+    out.audioActive = (flags & FLAG_AUDIO_ACTIVE) != 0;
+    counters.packets++;
+    counters.bytes += length;
+    return true;
+}
+
+void StreamDecoder::reset() {
+    have_sequence = false;
+    have_key = false;
+    have_last = false;
+}
+
+std::string defaultStreamSocketPath() {
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) return std::string(runtime) + "/mallard.sock";
+    return "/tmp/mallard-" + std::to_string(getuid()) + ".sock";
+}
+
+/**
+ * @brief Clears the way for binding a Unix socket at `path`.
+ *
+ * A socket file nobody answers on is left over from a crash and is removed;
+ * a live one belongs to another process.
+ */
+bool claimSocketPath(const std::string& path, std::string& error) {
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0) return true;
+    if (!S_ISSOCK(st.st_mode)) {
+        error = "'" + path + "' exists and is not a socket";
+        return false;
+    }
+    sockaddr_un address{};
+    if (path.size() >= sizeof(address.sun_path)) {
+        error = "Socket path '" + path + "' is too long";
+        return false;
+    }
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    bool in_use = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    if (probe >= 0) close(probe);
+    if (in_use) {
+        error = "Another process is already serving " + path;
+        return false;
+    }
+    unlink(path.c_str());
+    return true;
+}
+
+bool parseStreamUrl(const std::string& url, StreamEndpoint& out, std::string& error) {
+    size_t scheme_end = url.find("://");
+    std::string scheme = scheme_end == std::string::npos ? "" : url.substr(0, scheme_end);
+    if (scheme != "udp" && scheme != "tcp" && scheme != "unix") {
+        error = "Stream address '" + url + "' must start with udp://, tcp:// or unix://";
+        return false;
+    }
+    std::string rest = url.substr(scheme_end + 3);
+    if (scheme == "unix") {
+        out.transport = StreamEndpoint::UNIX;
+        out.path = rest.empty() ? defaultStreamSocketPath() : rest;
+        return true;
+    }
+    size_t colon = rest.rfind(':');
+    if (colon == std::string::npos || colon + 1 == rest.size()) {
+        error = "Stream address '" + url + "' has no port";
+        return false;
+    }
+    out.transport = scheme == "tcp" ? StreamEndpoint::TCP : StreamEndpoint::UDP;
+    out.host = rest.substr(0, colon);
+    out.port = rest.substr(colon + 1);
+    // [::1]:port style IPv6 literals
+    if (out.host.size() >= 2 && out.host.front() == '[' && out.host.back() == ']') {
+        out.host = out.host.substr(1, out.host.size() - 2);
+    }
+    return true;
+}
+
+// --- Publisher ---
+
+StreamPublisher::~StreamPublisher() {
+    for (Client& client : clients) close(client.fd);
+    if (socket_fd >= 0) close(socket_fd);
+    if (!socket_path.empty()) unlink(socket_path.c_str());
+}
+
+bool StreamPublisher::open(const std::string& url, std::string& error) {
+    StreamEndpoint endpoint;
+    if (!parseStreamUrl(url, endpoint, error)) return false;
+    if (endpoint.transport == StreamEndpoint::UDP && endpoint.host.empty()) {
+        error = "UDP stream address '" + url + "' needs a destination host";
+        return false;
+    }
+    sockaddr_storage address;
+    socklen_t address_length;
+    if (!resolve(endpoint, endpoint.byteStream(), address, address_length, error)) return false;
+
+    byte_stream = endpoint.byteStream();
+    socket_fd = socket(address.ss_family, (byte_stream ? SOCK_STREAM : SOCK_DGRAM) | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0) {
+        error = systemError("Cannot create stream socket");
+        return false;
+    }
+    int one = 1;
+    if (endpoint.transport == StreamEndpoint::UNIX) {
+        if (!claimSocketPath(endpoint.path, error)) return abandonSocket(socket_fd);
+    }
+    if (byte_stream) {
+        if (endpoint.transport == StreamEndpoint::TCP) setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(socket_fd, reinterpret_cast<sockaddr*>(&address), address_length) != 0 || listen(socket_fd, 8) != 0) {
+            error = systemError("Cannot listen on " + url);
+            return abandonSocket(socket_fd);
+        }
+        if (endpoint.transport == StreamEndpoint::UNIX) socket_path = endpoint.path;
+    } else {
+        // Connecting a datagram socket just fixes its destination; broadcast needs explicit permission
+        setsockopt(socket_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one));
+        if (connect(socket_fd, reinterpret_cast<sockaddr*>(&address), address_length) != 0) {
+            error = systemError("Cannot send to " + url);
+            return abandonSocket(socket_fd);
+        }
+    }
+    return true;
+}
+
+void StreamPublisher::acceptClients() {
+    while (true) {
+        int fd = accept4(socket_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) return;
+        if (clients.size() >= MAX_CLIENTS) {
+            close(fd);
+            continue;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));  // Fails harmlessly on Unix sockets
+        clients.emplace_back(fd);
+    }
+}
+
+/**
+ * @brief Sends what is left of a client's last packet.
+ *
+ * Returns false if the connection is gone. A client is only given a new
+ * packet once `pending` is empty.
+ */
+bool StreamPublisher::flush(Client& client) {
+    while (!client.pending.empty()) {
+        ssize_t n = send(client.fd, client.pending.data(), client.pending.size(), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0) return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+        client.pending.erase(client.pending.begin(), client.pending.begin() + n);
+    }
+    return true;
+}
+
+void StreamPublisher::publish(const AnalysisFrame& frame) {
+    if (socket_fd < 0) return;
+    QuantizedFrame quantized;
+    quantizeFrame(frame, quantized);
+    uint8_t packet[STREAM_LENGTH_BYTES + STREAM_MAX_PACKET_BYTES];
+
+    if (!byte_stream) {
+        size_t length = datagram_encoder.encode(quantized, packet);
+        // Nobody listening shows up as ECONNREFUSED on a later send; that is not our problem
+        if (send(socket_fd, packet, length, MSG_DONTWAIT) >= 0) {
+            counters.packets++;
+            counters.bytes += length;
+        }
+        return;
+    }
+
+    acceptClients();
+    for (size_t i = 0; i < clients.size();) {
+        Client& client = clients[i];
+        bool alive = flush(client);
+        if (alive && client.pending.empty()) {
+            size_t length = client.encoder.encode(quantized, packet + STREAM_LENGTH_BYTES);
+            putU16(packet, static_cast<uint32_t>(length));
+            length += STREAM_LENGTH_BYTES;
+            ssize_t n = send(client.fd, packet, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                alive = false;
+            } else {
+                size_t sent = n < 0 ? 0 : static_cast<size_t>(n);
+                client.pending.assign(packet + sent, packet + length);
+                counters.packets++;
+                counters.bytes += length;
+            }
+        }
+        if (alive) {
+            ++i;
+        } else {
+            close(client.fd);
+            clients.erase(clients.begin() + i);
+        }
+    }
+}
+
+// --- Receiver ---
+
+StreamReceiver::~StreamReceiver() {
+    if (socket_fd >= 0) close(socket_fd);
+}
+
+bool StreamReceiver::open(const std::string& url, std::string& error) {
+    if (!parseStreamUrl(url, endpoint, error)) return false;
+    if (endpoint.transport == StreamEndpoint::TCP && endpoint.host.empty()) {
+        error = "TCP stream address '" + url + "' needs the publisher's host";
+        return false;
+    }
+    if (!resolve(endpoint, !endpoint.byteStream(), address, address_length, error)) return false;
+    if (endpoint.byteStream()) {
+        connectStream();
+        return true;
+    }
+
+    socket_fd = socket(address.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0) {
+        error = systemError("Cannot create stream socket");
+        return false;
+    }
+    int one = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    // A multicast group is joined, and the port is bound on every interface
+    sockaddr_storage local = address;
+    bool multicast = isMulticast(address);
+    if (multicast && local.ss_family == AF_INET) reinterpret_cast<sockaddr_in&>(local).sin_addr.s_addr = htonl(INADDR_ANY);
+    if (multicast && local.ss_family == AF_INET6) reinterpret_cast<sockaddr_in6&>(local).sin6_addr = in6addr_any;
+    if (bind(socket_fd, reinterpret_cast<sockaddr*>(&local), address_length) != 0) {
+        error = systemError("Cannot listen on " + url);
+        return abandonSocket(socket_fd);
+    }
+    if (multicast) {
+        int rc;
+        if (address.ss_family == AF_INET) {
+            ip_mreq group{};
+            group.imr_multiaddr = reinterpret_cast<sockaddr_in&>(address).sin_addr;
+            group.imr_interface.s_addr = htonl(INADDR_ANY);
+            rc = setsockopt(socket_fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &group, sizeof(group));
+        } else {
+            ipv6_mreq group{};
+            group.ipv6mr_multiaddr = reinterpret_cast<sockaddr_in6&>(address).sin6_addr;
+            rc = setsockopt(socket_fd, IPPROTO_IPV6, IPV6_JOIN_GROUP, &group, sizeof(group));
+        }
+        if (rc != 0) {
+            error = systemError("Cannot join multicast group " + endpoint.host);
+            return abandonSocket(socket_fd);
+        }
+    }
+    state = CONNECTED;
+    return true;
+}
+
+void StreamReceiver::connectStream() {
+    next_attempt = std::chrono::steady_clock::now() + RECONNECT_DELAY;
+    socket_fd = socket(address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (socket_fd < 0) return;
+    decoder.reset();
+    buffer.clear();
+    if (connect(socket_fd, reinterpret_cast<sockaddr*>(&address), address_length) == 0) {
+        state = CONNECTED;
+    } else if (errno == EINPROGRESS) {
+        state = CONNECTING;
+    } else {
+        disconnect();
+    }
+}
+
+/**
+ * @brief Checks, without waiting, whether a non-blocking connect has finished.
+ */
+bool StreamReceiver::pollConnect() {
+    pollfd pfd{socket_fd, POLLOUT, 0};
+    if (poll(&pfd, 1, 0) <= 0) return false;
+    int socket_error = 0;
+    socklen_t length = sizeof(socket_error);
+    if (getsockopt(socket_fd, SOL_SOCKET, SO_ERROR, &socket_error, &length) != 0 || socket_error != 0) {
+        disconnect();
+        return false;
+    }
+    state = CONNECTED;
+    return true;
+}
+
+void StreamReceiver::disconnect() {
+    if (socket_fd >= 0) close(socket_fd);
+    socket_fd = -1;
+    state = IDLE;
+}
+
+bool StreamReceiver::receive(AnalysisFrame& frame) {
+    if (endpoint.byteStream()) {
+        if (state == IDLE && std::chrono::steady_clock::now() >= next_attempt) connectStream();
+        if (state == CONNECTING && !pollConnect()) return false;
+    }
+    if (state != CONNECTED) return false;
+
+    QuantizedFrame decoded;
+    QuantizedFrame newest;
+    bool got_frame = false;
+    uint8_t chunk[4096];
+    while (true) {
+        ssize_t n = recv(socket_fd, chunk, sizeof(chunk), MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        if (n < 0 && errno == EINTR) continue;
+        if (!endpoint.byteStream()) {
+            // Stray ICMP errors surface as failed reads; they do not end a datagram socket
+            if (n < 0) break;
+            if (decoder.decode(chunk, n, decoded)) {
+                newest = decoded;
+                got_frame = true;
+            }
+            continue;
+        }
+        if (n <= 0) {
+            disconnect();
+            break;
+        }
+        buffer.insert(buffer.end(), chunk, chunk + n);
+        size_t offset = 0;
+        while (buffer.size() - offset >= STREAM_LENGTH_BYTES) {
+            size_t length = getU16(buffer.data() + offset);
+            if (buffer.size() - offset - STREAM_LENGTH_BYTES < length) break;
+            if (decoder.decode(buffer.data() + offset + STREAM_LENGTH_BYTES, length, decoded)) {
+                newest = decoded;
+                got_frame = true;
+            }
+            offset += STREAM_LENGTH_BYTES + length;
+        }
+        buffer.erase(buffer.begin(), buffer.begin() + offset);
+        if (buffer.size() > STREAM_LENGTH_BYTES + STREAM_MAX_PACKET_BYTES) {
+            // Longer than any packet we send: not one of our publishers
+            disconnect();
+            break;
+        }
+    }
+
+    if (!got_frame) return false;
+    dequantizeFrame(newest, frame);
+    last_frame = std::chrono::steady_clock::now();
+    have_frame = true;
+    source_active = newest.audioActive;
+    return true;
+}
+
+bool StreamReceiver::active() const {
+    return have_frame && source_active && std::chrono::steady_clock::now() - last_frame < STREAM_TIMEOUT;
+}
@@ -0,0 +1,205 @@
+#ifndef NET_STREAM_H
+#define NET_STREAM_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <sys/socket.h>
+#include "analysis_frame.h"
+
+const int STREAM_KEYFRAME_INTERVAL = 30;  // A lost datagram costs at most this many frames
+const size_t STREAM_HEADER_BYTES = 18;
+const size_t STREAM_MAX_PACKET_BYTES = STREAM_HEADER_BYTES + QUANTIZED_FRAME_BYTES;
+const std::chrono::milliseconds STREAM_TIMEOUT(1000);
+
+/**
+ * @brief Counters of one end of an analysis stream.
+ */
+struct StreamStats {
+    uint64_t packets = 0;      // Sent, or received and decoded
+    uint64_t bytes = 0;
+    uint64_t lost = 0;         // Sequence numbers skipped over
+    uint64_t late = 0;         // Arrived after a newer frame and were dropped
+    uint64_t undecodable = 0;  // Malformed, or a delta whose base frame is missing
+};
+
+/**
+ * @brief Turns quantized frames into stream packets.
+ *
+ * A packet is an 18-byte header (magic, version, flags, sequence, base
+ * sequence, sample rate, payload length; little-endian) followed by either
+ * the whole frame (a keyframe) or its byte-wise difference from the base
+ * frame, with runs of unchanged bytes collapsed. Whichever is smaller is sent.
+ *
+ * With LAST_KEYFRAME every delta is against the latest keyframe, so losing
+ * any packet only loses that frame; a lost keyframe is made good by the next
+ * one. PREVIOUS_FRAME deltas are smaller but need every packet to arrive,
+ * which only a byte stream guarantees.
+ */
+class StreamEncoder {
+public:
+    enum DeltaBase { LAST_KEYFRAME, PREVIOUS_FRAME };
+
+    explicit StreamEncoder(DeltaBase base) : base(base) {}
+
+    // Writes the next packet (at most STREAM_MAX_PACKET_BYTES) and returns its length.
+    size_t encode(const QuantizedFrame& frame, uint8_t* packet);
+
+private:
+    DeltaBase base;
+    uint32_t sequence = 0;
+    int frames_since_key = 0;
+    bool have_reference = false;
+    uint32_t reference_sequence = 0;
+    uint8_t reference[QUANTIZED_FRAME_BYTES] = {};
+};
+
+/**
+ * @brief Turns stream packets back into frames, tolerating loss and reordering.
+ *
+ * Keeps the latest keyframe and the latest decoded frame as delta bases.
+ * Packets older than the newest one decoded are dropped, since a visualizer
+ * has no use for a frame it has already drawn past. The exception is a
+ * keyframe after STREAM_TIMEOUT of silence, or from far behind: that is a
+ * publisher that restarted its sequence, and the decoder starts over with it.
+ */
+class StreamDecoder {
+public:
+    // Returns true if `packet` decoded into a frame newer than any before it.
+    bool decode(const uint8_t* packet, size_t length, QuantizedFrame& out);
+
+    // Forgets all bases, e.g. after reconnecting to a publisher that restarted its sequence.
+    void reset();
+
+    const StreamStats& stats() const { return counters; }
+
+private:
+    bool have_sequence = false;
+    uint32_t newest_sequence = 0;
+    std::chrono::steady_clock::time_point last_decoded;
+    bool have_key = false;
+    uint32_t key_sequence = 0;
+    uint8_t key[QUANTIZED_FRAME_BYTES] = {};
+    bool have_last = false;
+    uint32_t last_sequence = 0;
+    uint8_t last[QUANTIZED_FRAME_BYTES] = {};
+    StreamStats counters;
+};
+
+/**
+ * @brief Where a stream goes or comes from: "udp://host:port", "tcp://host:port" or "unix://path".
+ *
+ * An empty host means every interface when binding or listening; an empty
+ * unix path means defaultStreamSocketPath().
+ */
+struct StreamEndpoint {
+    enum Transport { UDP, TCP, UNIX };
+    Transport transport = UDP;
+    std::string host;
+    std::string port;
+    std::string path;
+
+    // TCP and Unix sockets carry length-prefixed packets to connected clients
+    bool byteStream() const { return transport != UDP; }
+};
+
+// $XDG_RUNTIME_DIR/mallard.sock, or /tmp/mallard-<uid>.sock without a runtime directory.
+std::string defaultStreamSocketPath();
+
+bool parseStreamUrl(const std::string& url, StreamEndpoint& out, std::string& error);
+
+// Removes a stale Unix socket file at `path`; fails if it is live or not a socket.
+bool claimSocketPath(const std::string& path, std::string& error);
+
+/**
+ * @brief Sends the analysis of every frame to remote viewers.
+ *
+ * UDP sends one datagram per frame to the given address (unicast, broadcast
+ * or a multicast group) with keyframe-relative deltas. TCP listens on the
+ * given port (Unix sockets on the given path, so local viewers need no
+ * network setup) and gives every client its own previous-frame encoder; a client
+ * whose socket is full skips frames rather than stalling the render loop,
+ * and its next delta is simply taken against the last frame it did get.
+ * Everything is non-blocking and runs on the render thread.
+ */
+class StreamPublisher {
+public:
+    StreamPublisher() = default;
+    ~StreamPublisher();
+    StreamPublisher(const StreamPublisher&) = delete;
+    StreamPublisher& operator=(const StreamPublisher&) = delete;
+
+    bool open(const std::string& url, std::string& error);
+    void publish(const AnalysisFrame& frame);
+
+    size_t clientCount() const { return clients.size(); }
+    const StreamStats& stats() const { return counters; }
+
+private:
+    struct Client {
+        explicit Client(int fd) : fd(fd) {}
+        int fd;
+        StreamEncoder encoder{StreamEncoder::PREVIOUS_FRAME};
+        std::vector<uint8_t> pending;  // Unsent tail of a partially written packet
+    };
+
+    int socket_fd = -1;
+    bool byte_stream = false;
+    std::string socket_path;  // Unix socket file to remove again on exit
+    StreamEncoder datagram_encoder{StreamEncoder::LAST_KEYFRAME};
+    std::vector<Client> clients;
+    StreamStats counters;
+
+    void acceptClients();
+    bool flush(Client& client);
+};
+
+/**
+ * @brief Receives an analysis stream for a remote viewer.
+ *
+ * UDP binds the given address (joining it if it is a multicast group); TCP
+ * and Unix sockets connect to a publisher and keep retrying once a second
+ * if it goes away.
+ * receive() drains everything pending without blocking and keeps only the
+ * newest frame.
+ */
+class StreamReceiver {
+public:
+    StreamReceiver() = default;
+    ~StreamReceiver();
+    StreamReceiver(const StreamReceiver&) = delete;
+    StreamReceiver& operator=(const StreamReceiver&) = delete;
+
+    bool open(const std::string& url, std::string& error);
+
+    // Returns true if `frame` was replaced by a newer frame.
+    bool receive(AnalysisFrame& frame);
+
+    // A frame arrived within STREAM_TIMEOUT and its publisher had live audio.
+    bool active() const;
+
+    const StreamStats& stats() const { return decoder.stats(); }
+
+private:
+    enum State { IDLE, CONNECTING, CONNECTED };
+
+    StreamEndpoint endpoint;
+    sockaddr_storage address{};
+    socklen_t address_length = 0;
+    int socket_fd = -1;
+    State state = IDLE;
+    std::chrono::steady_clock::time_point next_attempt;
+    std::chrono::steady_clock::time_point last_frame;
+    bool have_frame = false;
+    bool source_active = false;
+    std::vector<uint8_t> buffer;  // Bytes of an incomplete stream packet
+    StreamDecoder decoder;
+
+    void connectStream();
+    bool pollConnect();
+    void disconnect();
+};
+
+#endif // NET_STREAM_H
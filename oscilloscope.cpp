@@ -12,8 +12,28 @@
 #include <mutex>
 #include <algorithm>
 #include <condition_variable>
+#include <memory>
+#include <charconv>
+#include <deque>
+#include <limits>
 #include "config_parser.h"
 #include "visualizer.h"
+#include "frame_pacer.h"
+#include "frame_clock.h"
+#include "config_watcher.h"
+#include "net_stream.h"
+#include "shm_analysis.h"
+#include "raw_output.h"
+#include "control_socket.h"
+#include "channel_ring.h"
+#include "sample_history.h"
+#include "analysis_log.h"
+#include "batch_analysis.h"
+#include "spectrogram.h"
+#include "cast_render.h"
+#include "cast_recorder.h"
+#include <strings.h>
+#include <unistd.h>
 
 // Built-in modes
 enum BuiltInMode {
@@ -23,56 +43,99 @@ enum BuiltInMode {
     GALAXY,
     ELLIPSE,
     ECLIPSE,
+    CHANNELS,
+    STEREO_FIELD,
     NUM_BUILT_IN_MODES
 };
 
 // --- Global State ---
 const int DEFAULT_SAMPLE_RATE = 44100;
 std::atomic<uint32_t> global_sample_rate(DEFAULT_SAMPLE_RATE);
-const int TOTAL_SAMPLES = BUFFER_FRAMES * 2;
 std::atomic<bool> running(true);
 std::atomic<bool> audio_stream_active(false);
 std::vector<int> colorPairIDs;
+std::vector<int> monoPairIDs;
 int edgePairID = 0;
 
-// --- SPSC Lock-Free Ring Buffer ---
-class RingBuffer {
-public:
-    RingBuffer() : m_head(0), m_tail(0) {}
-    void write(const int16_t* data) {
-        size_t head = m_head.load(std::memory_order_relaxed);
-        size_t next_head = (head + 1) % BUFFER_COUNT;
-        if (next_head == m_tail.load(std::memory_order_acquire)) {
-            // Buffer full, overwrite oldest
-        } 
-        std::copy(data, data + TOTAL_SAMPLES, m_buffer[head]);
-        m_head.store(next_head, std::memory_order_release);
-    }
-    bool read(int16_t* destLeft, int16_t* destRight) {
-        const size_t tail = m_tail.load(std::memory_order_relaxed);
-        const size_t head = m_head.load(std::memory_order_acquire);
-        if (tail == head) return false;
-        const int16_t* source_buffer = m_buffer[tail];
-        for (int i = 0; i < BUFFER_FRAMES; i++) {
-            destLeft[i] = source_buffer[i * 2];
-            destRight[i] = source_buffer[i * 2 + 1];
-        }
-        m_tail.store((tail + 1) % BUFFER_COUNT, std::memory_order_release);
-        return true;
-    }
-private:
-    static const int BUFFER_COUNT = 8; // Increased buffer count for stability
-    int16_t m_buffer[BUFFER_COUNT][TOTAL_SAMPLES] = {{0}};
-    std::atomic<size_t> m_head;
-    std::atomic<size_t> m_tail;
+const size_t MAX_CAPTURE_SOURCES = 16;
+
+// Capture errors are printed until the terminal is taken over, then shown in its status bar
+std::mutex capture_error_mutex;
+std::string capture_error;  // The latest one not shown yet
+bool terminal_owned = false;
+
+void reportCaptureError(const std::string& message) {
+    std::lock_guard<std::mutex> lock(capture_error_mutex);
+    if (terminal_owned) capture_error = message;
+    else std::cerr << message << std::endl;
+}
+
+// Hands the terminal to curses (errors wait for takeCaptureError()) or back (they are printed again)
+void setTerminalOwned(bool owned) {
+    std::lock_guard<std::mutex> lock(capture_error_mutex);
+    terminal_owned = owned;
+    if (!owned && !capture_error.empty()) std::cerr << capture_error << std::endl;
+    capture_error.clear();
+}
+
+std::string takeCaptureError() {
+    std::lock_guard<std::mutex> lock(capture_error_mutex);
+    std::string message;
+    message.swap(capture_error);
+    return message;
+}
+
+/**
+ * @brief One thing to capture: the default output, a sink, a microphone or an application.
+ *
+ * Each source has its own ring and state. Only its own stream callback
+ * writes them and only the render loop reads them, so sources never share
+ * a lock and a slow or missing source cannot hold up another.
+ */
+struct CaptureSource {
+    enum Kind {
+        DEFAULT_MONITOR,  // What the default sink plays
+        SINK_MONITOR,     // What the named sink plays
+        MICROPHONE,       // The named (or default) source
+        APPLICATION       // What the named application plays
+    };
+    Kind kind = DEFAULT_MONITOR;
+    std::string target;  // Sink, source or application name; empty for the default
+    std::string label;   // As given on the command line, shown next to the source
+    // Layout asked for, then the one negotiated; set on the capture thread
+    // before any buffer flows, never while a stream callback runs
+    ChannelMap map;
+    ChannelRing ring;
+    SampleHistory history;  // Every buffer of the last --history seconds, for freeze and scrub
+    std::atomic<bool> active{false};
+    std::atomic<uint32_t> sampleRate{DEFAULT_SAMPLE_RATE};
 };
-RingBuffer audioBuffer;
+// Filled before the capture thread starts and never resized afterwards
+std::deque<CaptureSource> captureSources;
+
+/**
+ * @brief Parses a --source argument: default, sink:NAME, mic, mic:NAME or app:NAME.
+ */
+bool parseSourceSpec(const std::string& spec, CaptureSource::Kind& kind, std::string& target) {
+    size_t colon = spec.find(':');
+    std::string prefix = spec.substr(0, colon);
+    target = colon == std::string::npos ? "" : spec.substr(colon + 1);
+    if (prefix == "default" && colon == std::string::npos) kind = CaptureSource::DEFAULT_MONITOR;
+    else if (prefix == "sink" && !target.empty()) kind = CaptureSource::SINK_MONITOR;
+    else if (prefix == "mic" && (colon == std::string::npos || !target.empty())) kind = CaptureSource::MICROPHONE;
+    else if (prefix == "app" && !target.empty()) kind = CaptureSource::APPLICATION;
+    else return false;
+    return true;
+}
 
 #ifdef USE_PIPEWIRE
 #include <pipewire/pipewire.h>
 #include <spa/param/audio/raw-utils.h>
 #include <spa/param/param.h>
 #include <spa/pod/filter.h>
+#ifndef PW_KEY_TARGET_OBJECT
+#define PW_KEY_TARGET_OBJECT "target.object"  // Before PipeWire 0.3.64
+#endif
 struct pw_main_loop *global_pw_loop = nullptr;
 std::mutex loop_mutex;
 #else // PulseAudio
@@ -89,47 +152,84 @@ void signal_handler(int) {
 #ifdef USE_PIPEWIRE
 // --- PipeWire Audio Capture Implementation ---
 struct PipeWireData {
-    struct pw_main_loop *loop;
     struct pw_stream *stream;
+    CaptureSource* source;
+};
+
+const std::pair<ChannelPosition, uint32_t> SPA_POSITIONS[] = {
+    {ChannelPosition::MONO, SPA_AUDIO_CHANNEL_MONO},
+    {ChannelPosition::FRONT_LEFT, SPA_AUDIO_CHANNEL_FL},
+    {ChannelPosition::FRONT_RIGHT, SPA_AUDIO_CHANNEL_FR},
+    {ChannelPosition::FRONT_CENTER, SPA_AUDIO_CHANNEL_FC},
+    {ChannelPosition::LFE, SPA_AUDIO_CHANNEL_LFE},
+    {ChannelPosition::REAR_LEFT, SPA_AUDIO_CHANNEL_RL},
+    {ChannelPosition::REAR_RIGHT, SPA_AUDIO_CHANNEL_RR},
+    {ChannelPosition::REAR_CENTER, SPA_AUDIO_CHANNEL_RC},
+    {ChannelPosition::SIDE_LEFT, SPA_AUDIO_CHANNEL_SL},
+    {ChannelPosition::SIDE_RIGHT, SPA_AUDIO_CHANNEL_SR},
 };
 
+uint32_t toSpaPosition(ChannelPosition position) {
+    for (const auto& entry : SPA_POSITIONS) if (entry.first == position) return entry.second;
+    return SPA_AUDIO_CHANNEL_UNKNOWN;
+}
+
+ChannelPosition fromSpaPosition(uint32_t position) {
+    for (const auto& entry : SPA_POSITIONS) if (entry.second == position) return entry.first;
+    return ChannelPosition::UNKNOWN;
+}
+
 static void on_process(void *userdata) {
     struct pw_buffer *b;
     PipeWireData* data = static_cast<PipeWireData*>(userdata);
     if ((b = pw_stream_dequeue_buffer(data->stream)) != nullptr) {
         struct spa_buffer *buf = b->buffer;
         if (buf->datas[0].data) {
+            CaptureSource* source = data->source;
             size_t n_bytes = buf->datas[0].chunk->size;
-            if (n_bytes >= sizeof(int16_t) * TOTAL_SAMPLES) {
-                audioBuffer.write(static_cast<int16_t*>(buf->datas[0].data));
-                if(!audio_stream_active) audio_stream_active = true;
+            if (n_bytes >= sizeof(int16_t) * BUFFER_FRAMES * source->map.channels) {
+                const uint32_t rate = source->sampleRate.load(std::memory_order_relaxed);
+                source->ring.write(static_cast<int16_t*>(buf->datas[0].data), source->map);
+                source->history.append(static_cast<int16_t*>(buf->datas[0].data), source->map, rate,
+                                       bufferTime(source->history.end(), rate));
+                if(!source->active) source->active = true;
             }
         }
         pw_stream_queue_buffer(data->stream, b);
     }
 }
 
-static void on_state_changed(void *, enum pw_stream_state, enum pw_stream_state new_state, const char *error) {
+static void on_state_changed(void *userdata, enum pw_stream_state, enum pw_stream_state new_state, const char *error) {
+    CaptureSource* source = static_cast<PipeWireData*>(userdata)->source;
     switch (new_state) {
         case PW_STREAM_STATE_STREAMING: 
-            audio_stream_active = true; 
+            source->active = true; 
             break;
         case PW_STREAM_STATE_ERROR:
-            audio_stream_active = false;
-            std::cerr << "PipeWire Stream Error: " << (error ? error : "Unknown") << std::endl;
+            source->active = false;
+            reportCaptureError("PipeWire Stream Error (" + source->label + "): " + (error ? error : "Unknown"));
             break;
         default: 
-            audio_stream_active = false; 
+            source->active = false; 
             break;
     }
 }
 
 static void on_param_changed(void *userdata, uint32_t id, const struct spa_pod *param) {
     if (id != SPA_PARAM_Format || !param) return;
+    CaptureSource* source = static_cast<PipeWireData*>(userdata)->source;
     struct spa_audio_info_raw info;
     if (spa_format_audio_raw_parse(param, &info) >= 0) {
         if (info.rate > 0) {
-            global_sample_rate.store(info.rate, std::memory_order_relaxed);
+            source->sampleRate.store(info.rate, std::memory_order_relaxed);
+        }
+        // We asked for our own layout, but the graph has the last word
+        if (info.channels > 0 && info.channels <= static_cast<uint32_t>(MAX_CHANNELS)) {
+            source->map.channels = info.channels;
+            for (uint32_t c = 0; c < info.channels; ++c) {
+                source->map.position[c] = (info.flags & SPA_AUDIO_FLAG_UNPOSITIONED) ? ChannelPosition::UNKNOWN
+                                                                                      : fromSpaPosition(info.position[c]);
+            }
         }
     }
 }
@@ -141,50 +241,68 @@ static const struct pw_stream_events stream_events = {
     .process = on_process 
 };
 
+/**
+ * @brief Creates and connects the capture stream of one source on `loop`.
+ */
+bool connectPipeWireStream(struct pw_main_loop *loop, PipeWireData& data) {
+    const CaptureSource& source = *data.source;
+    struct pw_properties *props = pw_properties_new(
+        PW_KEY_MEDIA_TYPE, "Audio", 
+        PW_KEY_MEDIA_CATEGORY, "Capture",
+        PW_KEY_MEDIA_ROLE, "Music", 
+        PW_KEY_NODE_NAME, "visualizer_capture",
+        nullptr);
+    if (source.kind == CaptureSource::DEFAULT_MONITOR || source.kind == CaptureSource::SINK_MONITOR) {
+        pw_properties_set(props, PW_KEY_STREAM_CAPTURE_SINK, "true"); // Crucial for system audio
+    }
+    // A sink, source or application stream node, by name or serial
+    if (!source.target.empty()) pw_properties_set(props, PW_KEY_TARGET_OBJECT, source.target.c_str());
+
+    data.stream = pw_stream_new_simple(pw_main_loop_get_loop(loop), "Ncurses Visualizer", props, &stream_events, &data);
+    if (!data.stream) return false;
+
+    uint8_t buffer[1024];
+    struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+    struct spa_audio_info_raw info = {};
+    info.format = SPA_AUDIO_FORMAT_S16;
+    info.channels = source.map.channels;
+    info.rate = DEFAULT_SAMPLE_RATE;
+    for (int c = 0; c < source.map.channels; ++c) info.position[c] = toSpaPosition(source.map.position[c]);
+
+    const struct spa_pod *params[1] = { spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info) };
+    
+    int ret = pw_stream_connect(data.stream, PW_DIRECTION_INPUT, PW_ID_ANY,
+        static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS),
+        params, 1);
+    if (ret < 0) {
+        reportCaptureError("Failed to connect PipeWire stream for " + source.label + ": " + strerror(-ret));
+        return false;
+    }
+    return true;
+}
+
 void audioCaptureThread() {
     pw_init(nullptr, nullptr);
     while (running) {
-        PipeWireData data = {};
-        data.loop = pw_main_loop_new(nullptr);
-        
-        { std::lock_guard<std::mutex> lock(loop_mutex); global_pw_loop = data.loop; }
-
-        data.stream = pw_stream_new_simple(
-            pw_main_loop_get_loop(data.loop), "Ncurses Visualizer",
-            pw_properties_new(
-                PW_KEY_MEDIA_TYPE, "Audio", 
-                PW_KEY_MEDIA_CATEGORY, "Capture",
-                PW_KEY_MEDIA_ROLE, "Music", 
-                PW_KEY_NODE_NAME, "visualizer_capture",
-                PW_KEY_STREAM_CAPTURE_SINK, "true", // Crucial for system audio
-                nullptr),
-            &stream_events, &data);
-
-        uint8_t buffer[1024];
-        struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
-        struct spa_audio_info_raw info = {};
-        info.format = SPA_AUDIO_FORMAT_S16;
-        info.channels = 2;
-        info.rate = DEFAULT_SAMPLE_RATE;
-
-        const struct spa_pod *params[1] = { spa_format_audio_raw_build(&b, SPA_PARAM_EnumFormat, &info) };
+        struct pw_main_loop *loop = pw_main_loop_new(nullptr);
         
-        int ret = pw_stream_connect(data.stream, PW_DIRECTION_INPUT, PW_ID_ANY,
-            static_cast<pw_stream_flags>(PW_STREAM_FLAG_AUTOCONNECT | PW_STREAM_FLAG_MAP_BUFFERS | PW_STREAM_FLAG_RT_PROCESS),
-            params, 1);
+        { std::lock_guard<std::mutex> lock(loop_mutex); global_pw_loop = loop; }
 
-        if (ret < 0) {
-            std::cerr << "Failed to connect PipeWire stream: " << strerror(ret) << std::endl;
-        } else {
-            pw_main_loop_run(data.loop);
+        // Every source is one more stream on this loop, so one thread captures them all
+        std::vector<PipeWireData> streams(captureSources.size());
+        bool connected = false;
+        for (size_t i = 0; i < streams.size(); ++i) {
+            streams[i].source = &captureSources[i];
+            if (connectPipeWireStream(loop, streams[i])) connected = true;
         }
+        if (connected) pw_main_loop_run(loop);
 
         { std::lock_guard<std::mutex> lock(loop_mutex); global_pw_loop = nullptr; }
         
-        if(data.stream) pw_stream_destroy(data.stream);
-        if(data.loop) pw_main_loop_destroy(data.loop);
+        for (auto& data : streams) if (data.stream) pw_stream_destroy(data.stream);
+        pw_main_loop_destroy(loop);
         
-        audio_stream_active = false;
+        for (auto& source : captureSources) source.active = false;
         if (running) std::this_thread::sleep_for(std::chrono::seconds(1));
     }
     pw_deinit();
@@ -192,85 +310,248 @@ void audioCaptureThread() {
 
 #else // --- PulseAudio (Explicit Monitor) ---
 
+struct PulseData;
+
+// One record stream and the source it feeds
+struct PulseStream {
+    PulseData* owner = nullptr;
+    CaptureSource* source = nullptr;
+    pa_stream* stream = nullptr;
+    uint32_t sink_input = PA_INVALID_INDEX;  // APPLICATION: the sink input being monitored
+    bool lookup_pending = false;             // APPLICATION: a sink info request is in flight
+    pa_time_event* retry = nullptr;          // Any other kind: reconnecting after a failure
+};
+
 struct PulseData {
     pa_mainloop* mainloop;
     pa_context* context;
-    pa_stream* stream;
-    std::string monitor_name;
+    std::vector<PulseStream> streams;
 };
 
+const std::pair<ChannelPosition, pa_channel_position_t> PA_POSITIONS[] = {
+    {ChannelPosition::MONO, PA_CHANNEL_POSITION_MONO},
+    {ChannelPosition::FRONT_LEFT, PA_CHANNEL_POSITION_FRONT_LEFT},
+    {ChannelPosition::FRONT_RIGHT, PA_CHANNEL_POSITION_FRONT_RIGHT},
+    {ChannelPosition::FRONT_CENTER, PA_CHANNEL_POSITION_FRONT_CENTER},
+    {ChannelPosition::LFE, PA_CHANNEL_POSITION_LFE},
+    {ChannelPosition::REAR_LEFT, PA_CHANNEL_POSITION_REAR_LEFT},
+    {ChannelPosition::REAR_RIGHT, PA_CHANNEL_POSITION_REAR_RIGHT},
+    {ChannelPosition::REAR_CENTER, PA_CHANNEL_POSITION_REAR_CENTER},
+    {ChannelPosition::SIDE_LEFT, PA_CHANNEL_POSITION_SIDE_LEFT},
+    {ChannelPosition::SIDE_RIGHT, PA_CHANNEL_POSITION_SIDE_RIGHT},
+};
+
+// The server remixes the source to the layout we ask for, so ours is the one we get
+pa_channel_map toPulseChannelMap(const ChannelMap& map) {
+    pa_channel_map result;
+    result.channels = static_cast<uint8_t>(map.channels);
+    for (int c = 0; c < map.channels; ++c) {
+        result.map[c] = PA_CHANNEL_POSITION_MONO;
+        for (const auto& entry : PA_POSITIONS) if (entry.first == map.position[c]) result.map[c] = entry.second;
+    }
+    return result;
+}
+
 static void stream_read_callback(pa_stream* s, size_t length, void* userdata) {
+    CaptureSource* source = static_cast<PulseStream*>(userdata)->source;
+    const size_t buffer_bytes = sizeof(int16_t) * BUFFER_FRAMES * source->map.channels;
     const void* data;
     if (pa_stream_peek(s, &data, &length) < 0) return;
     if (data && length > 0) {
-        size_t to_write = std::min(length, sizeof(int16_t) * TOTAL_SAMPLES);
-        if (to_write >= sizeof(int16_t) * TOTAL_SAMPLES) {
-             audioBuffer.write(static_cast<const int16_t*>(data));
-             if(!audio_stream_active) audio_stream_active = true;
+        size_t to_write = std::min(length, buffer_bytes);
+        if (to_write >= buffer_bytes) {
+             const uint32_t rate = source->sampleRate.load(std::memory_order_relaxed);
+             source->ring.write(static_cast<const int16_t*>(data), source->map);
+             source->history.append(static_cast<const int16_t*>(data), source->map, rate,
+                                    bufferTime(source->history.end(), rate));
+             if(!source->active) source->active = true;
         }
     }
     if (length > 0) pa_stream_drop(s);
 }
 
+static void scheduleRetry(PulseStream& ps);
+
 static void stream_state_callback(pa_stream* s, void* userdata) {
-    PulseData* data = static_cast<PulseData*>(userdata);
+    PulseStream* ps = static_cast<PulseStream*>(userdata);
+    PulseData* data = ps->owner;
+    // An application stream ends whenever the application stops playing and
+    // waits for it to come back; any other stream that fails is reconnected
+    // on its own. Either way the other sources keep running.
+    const bool application = ps->source->kind == CaptureSource::APPLICATION;
     switch (pa_stream_get_state(s)) {
         case PA_STREAM_READY:
-            audio_stream_active = true;
-            global_sample_rate.store(DEFAULT_SAMPLE_RATE, std::memory_order_relaxed);
+            ps->source->active = true;
+            ps->source->sampleRate.store(DEFAULT_SAMPLE_RATE, std::memory_order_relaxed);
             break;
         case PA_STREAM_FAILED:
-            std::cerr << "PulseAudio Stream Failed: " << pa_strerror(pa_context_errno(data->context)) << std::endl;
-            audio_stream_active = false;
-            pa_mainloop_quit(data->mainloop, 1);
-            break;
         case PA_STREAM_TERMINATED:
-            audio_stream_active = false;
-            pa_mainloop_quit(data->mainloop, 0);
+            ps->source->active = false;
+            // A context going away takes its streams along and restarts them all
+            if (application || pa_context_get_state(data->context) != PA_CONTEXT_READY) break;
+            if (pa_stream_get_state(s) == PA_STREAM_FAILED) {
+                reportCaptureError("PulseAudio Stream Failed (" + ps->source->label + "): " +
+                                   pa_strerror(pa_context_errno(data->context)));
+            }
+            scheduleRetry(*ps);
             break;
         default: break;
     }
 }
 
-static void server_info_callback(pa_context* c, const pa_server_info* i, void* userdata) {
-    PulseData* data = static_cast<PulseData*>(userdata);
-    
-    // Fallback logic: Try monitor of default sink, otherwise use default source (mic)
-    const char* target_device = nullptr;
-    if (i && i->default_sink_name) {
-        data->monitor_name = std::string(i->default_sink_name) + ".monitor";
-        target_device = data->monitor_name.c_str();
-    } else {
-        std::cerr << "No default sink found. Attempting default source (mic)..." << std::endl;
-        target_device = nullptr; // Records from default source
-    }
-
-    pa_sample_spec ss = { .format = PA_SAMPLE_S16LE, .rate = DEFAULT_SAMPLE_RATE, .channels = 2 };
+/**
+ * @brief Creates and connects one record stream.
+ *
+ * `device` is a source name (nullptr for the default source); a valid
+ * `sink_input` restricts the recording to that one application's stream.
+ */
+static void connectPulseStream(PulseStream& ps, const char* device, uint32_t sink_input) {
+    PulseData* data = ps.owner;
+    const ChannelMap& map = ps.source->map;
+    pa_sample_spec ss = { .format = PA_SAMPLE_S16LE, .rate = DEFAULT_SAMPLE_RATE, .channels = static_cast<uint8_t>(map.channels) };
+    pa_channel_map channel_map = toPulseChannelMap(map);
     // Adjust buffer attributes for stability
     pa_buffer_attr buffer_attr;
     buffer_attr.maxlength = (uint32_t) -1;
     buffer_attr.tlength = (uint32_t) -1;
     buffer_attr.prebuf = (uint32_t) -1;
     buffer_attr.minreq = (uint32_t) -1;
-    buffer_attr.fragsize = (uint32_t)(TOTAL_SAMPLES * sizeof(int16_t)); // Important for visualizer latency
+    buffer_attr.fragsize = (uint32_t)(BUFFER_FRAMES * map.channels * sizeof(int16_t)); // Important for visualizer latency
 
-    data->stream = pa_stream_new(data->context, "VisualizerCapture", &ss, nullptr);
-    if (!data->stream) {
-        std::cerr << "Failed to create stream: " << pa_strerror(pa_context_errno(c)) << std::endl;
-        pa_mainloop_quit(data->mainloop, 1);
+    if (ps.stream) pa_stream_unref(ps.stream);  // A dead stream, never the current callback's
+    ps.stream = pa_stream_new(data->context, "VisualizerCapture", &ss, &channel_map);
+    if (!ps.stream) {
+        reportCaptureError("Failed to create stream (" + ps.source->label + "): " +
+                           pa_strerror(pa_context_errno(data->context)));
+        scheduleRetry(ps);
         return;
     }
+    if (sink_input != PA_INVALID_INDEX) pa_stream_set_monitor_stream(ps.stream, sink_input);
 
-    pa_stream_set_state_callback(data->stream, stream_state_callback, userdata);
-    pa_stream_set_read_callback(data->stream, stream_read_callback, userdata);
+    pa_stream_set_state_callback(ps.stream, stream_state_callback, &ps);
+    pa_stream_set_read_callback(ps.stream, stream_read_callback, &ps);
     
-    int ret = pa_stream_connect_record(data->stream, target_device, &buffer_attr, 
+    int ret = pa_stream_connect_record(ps.stream, device, &buffer_attr, 
         static_cast<pa_stream_flags_t>(PA_STREAM_ADJUST_LATENCY | PA_STREAM_AUTO_TIMING_UPDATE));
         
     if (ret < 0) {
-        std::cerr << "Failed to connect record: " << pa_strerror(pa_context_errno(c)) << std::endl;
-        pa_mainloop_quit(data->mainloop, 1);
+        reportCaptureError("Failed to connect record (" + ps.source->label + "): " +
+                           pa_strerror(pa_context_errno(data->context)));
+        scheduleRetry(ps);
+    }
+}
+
+static bool streamAlive(const PulseStream& ps) {
+    if (!ps.stream) return false;
+    pa_stream_state_t state = pa_stream_get_state(ps.stream);
+    return state == PA_STREAM_CREATING || state == PA_STREAM_READY;
+}
+
+static void sink_info_callback(pa_context*, const pa_sink_info* i, int eol, void* userdata) {
+    PulseStream* ps = static_cast<PulseStream*>(userdata);
+    if (eol) {
+        ps->lookup_pending = false;
+        return;
+    }
+    if (i && i->monitor_source_name) connectPulseStream(*ps, i->monitor_source_name, ps->sink_input);
+}
+
+/**
+ * @brief Starts monitoring a sink input if it belongs to the wanted application.
+ *
+ * Matches the application name or binary, ignoring case. The monitor stream
+ * is recorded from the monitor of whichever sink the application plays on.
+ */
+static void sink_input_info_callback(pa_context* c, const pa_sink_input_info* i, int eol, void* userdata) {
+    PulseStream* ps = static_cast<PulseStream*>(userdata);
+    if (eol || !i || ps->lookup_pending || streamAlive(*ps)) return;
+    const char* name = pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_NAME);
+    const char* binary = pa_proplist_gets(i->proplist, PA_PROP_APPLICATION_PROCESS_BINARY);
+    const char* wanted = ps->source->target.c_str();
+    if (!(name && strcasecmp(name, wanted) == 0) && !(binary && strcasecmp(binary, wanted) == 0)) return;
+    ps->sink_input = i->index;
+    ps->lookup_pending = true;
+    pa_operation* op = pa_context_get_sink_info_by_index(c, i->sink, sink_info_callback, ps);
+    if (op) pa_operation_unref(op);
+    else ps->lookup_pending = false;
+}
+
+// A new sink input may be an application a source is waiting for
+static void subscribe_callback(pa_context* c, pa_subscription_event_type_t type, uint32_t index, void* userdata) {
+    if ((type & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) != PA_SUBSCRIPTION_EVENT_SINK_INPUT ||
+        (type & PA_SUBSCRIPTION_EVENT_TYPE_MASK) != PA_SUBSCRIPTION_EVENT_NEW) return;
+    PulseData* data = static_cast<PulseData*>(userdata);
+    for (auto& ps : data->streams) {
+        if (ps.source->kind != CaptureSource::APPLICATION || ps.lookup_pending || streamAlive(ps)) continue;
+        pa_operation* op = pa_context_get_sink_input_info(c, index, sink_input_info_callback, &ps);
+        if (op) pa_operation_unref(op);
+    }
+}
+
+/**
+ * @brief Connects one source's stream; an application only starts looking for its sink input.
+ *
+ * Returns whether the source is an application, which needs sink input events.
+ */
+static bool connectSource(pa_context* c, const pa_server_info* i, PulseStream& ps) {
+    const CaptureSource& source = *ps.source;
+    std::string device;
+    switch (source.kind) {
+        case CaptureSource::DEFAULT_MONITOR:
+            // Fallback logic: Try monitor of default sink, otherwise use default source (mic)
+            if (i && i->default_sink_name) {
+                device = std::string(i->default_sink_name) + ".monitor";
+            } else {
+                reportCaptureError("No default sink found. Attempting default source (mic)...");
+            }
+            break;
+        case CaptureSource::SINK_MONITOR:
+            device = source.target + ".monitor";
+            break;
+        case CaptureSource::MICROPHONE:
+            device = source.target;  // Empty records from the default source
+            break;
+        case CaptureSource::APPLICATION: {
+            pa_operation* op = pa_context_get_sink_input_info_list(c, sink_input_info_callback, &ps);
+            if (op) pa_operation_unref(op);
+            return true;
+        }
     }
+    connectPulseStream(ps, device.empty() ? nullptr : device.c_str(), PA_INVALID_INDEX);
+    return false;
+}
+
+static void server_info_callback(pa_context* c, const pa_server_info* i, void* userdata) {
+    PulseData* data = static_cast<PulseData*>(userdata);
+    bool wants_applications = false;
+    for (auto& ps : data->streams) {
+        if (connectSource(c, i, ps)) wants_applications = true;
+    }
+
+    if (wants_applications) {
+        pa_context_set_subscribe_callback(c, subscribe_callback, userdata);
+        pa_operation* op = pa_context_subscribe(c, PA_SUBSCRIPTION_MASK_SINK_INPUT, nullptr, nullptr);
+        if (op) pa_operation_unref(op);
+    }
+}
+
+// The default sink may have changed since the stream first connected, so it is looked up again
+static void retry_server_info_callback(pa_context* c, const pa_server_info* i, void* userdata) {
+    connectSource(c, i, *static_cast<PulseStream*>(userdata));
+}
+
+static void retry_callback(pa_mainloop_api* api, pa_time_event* event, const struct timeval*, void* userdata) {
+    PulseStream* ps = static_cast<PulseStream*>(userdata);
+    api->time_free(event);
+    ps->retry = nullptr;
+    pa_operation* op = pa_context_get_server_info(ps->owner->context, retry_server_info_callback, ps);
+    if (op) pa_operation_unref(op);
+}
+
+// Reconnects one failed stream a second from now
+static void scheduleRetry(PulseStream& ps) {
+    if (ps.retry) return;
+    ps.retry = pa_context_rttime_new(ps.owner->context, pa_rtclock_now() + PA_USEC_PER_SEC, retry_callback, &ps);
 }
 
 static void context_state_callback(pa_context* c, void* userdata) {
@@ -281,7 +562,7 @@ static void context_state_callback(pa_context* c, void* userdata) {
             break;
         case PA_CONTEXT_FAILED:
         case PA_CONTEXT_TERMINATED:
-            std::cerr << "PulseAudio Context Failed/Terminated" << std::endl;
+            reportCaptureError("PulseAudio Context Failed/Terminated");
             pa_mainloop_quit(data->mainloop, 1);
             break;
         default: break;
@@ -299,13 +580,21 @@ void audioCaptureThread() {
 
         { std::lock_guard<std::mutex> lock(loop_mutex); global_pa_loop = data.mainloop; }
 
+        // Every source is one more stream on this context, so one thread captures them all
+        data.streams.resize(captureSources.size());
+        for (size_t i = 0; i < data.streams.size(); ++i) {
+            data.streams[i].owner = &data;
+            data.streams[i].source = &captureSources[i];
+        }
+
         pa_mainloop_api* api = pa_mainloop_get_api(data.mainloop);
         data.context = pa_context_new(api, "Ncurses Visualizer");
         
         pa_context_set_state_callback(data.context, context_state_callback, &data);
         
         if (pa_context_connect(data.context, nullptr, PA_CONTEXT_NOAUTOSPAWN, nullptr) < 0) {
-            std::cerr << "PulseAudio connect failed." << std::endl;
+            reportCaptureError("PulseAudio connect failed.");
+            { std::lock_guard<std::mutex> lock(loop_mutex); global_pa_loop = nullptr; }
             pa_context_unref(data.context);
             pa_mainloop_free(data.mainloop);
             std::this_thread::sleep_for(std::chrono::seconds(1));
@@ -317,9 +606,10 @@ void audioCaptureThread() {
         // Cleanup sequence
         { std::lock_guard<std::mutex> lock(loop_mutex); global_pa_loop = nullptr; }
         
-        if (data.stream) {
-            pa_stream_disconnect(data.stream);
-            pa_stream_unref(data.stream);
+        for (auto& ps : data.streams) {
+            if (!ps.stream) continue;
+            pa_stream_disconnect(ps.stream);
+            pa_stream_unref(ps.stream);
         }
         if (data.context) {
             pa_context_disconnect(data.context);
@@ -327,7 +617,7 @@ void audioCaptureThread() {
         }
         pa_mainloop_free(data.mainloop);
         
-        audio_stream_active = false;
+        for (auto& source : captureSources) source.active = false;
         if (running) std::this_thread::sleep_for(std::chrono::seconds(1));
     }
 }
@@ -347,131 +637,1228 @@ int initColors(const std::vector<std::pair<int, int>>& configPairs) {
         init_pair(1, COLOR_WHITE, COLOR_BLACK);
         colorPairIDs.push_back(1);
     }
+    monoPairIDs.assign(1, colorPairIDs.front());
     return colorPairIDs.size() + 2;
 }
 
-int main() {
-    const char* home_dir_cstr = std::getenv("HOME");
-    if (home_dir_cstr == nullptr) {
-        std::cerr << "Error: HOME environment variable not found." << std::endl;
-        return 1;
+/**
+ * @brief Compares two lists of custom visualizers by their definition.
+ */
+bool sameVisualizers(const std::vector<CustomVisualizer>& a, const std::vector<CustomVisualizer>& b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i].name != b[i].name || a[i].type != b[i].type || a[i].polygons != b[i].polygons) return false;
     }
-    std::string full_path = std::string(home_dir_cstr) + "/.config/oscilloscope.conf";
-    ConfigParser parser(full_path);
-    parser.parse();
-    
-    auto colorConfig = parser.getColorPairs();
-    auto customVisualizers = parser.getCustomVisualizers();
-    
-    // Start Audio Thread First
-    std::thread audioThread(audioCaptureThread);
-
-    // Initialize Ncurses
-    initscr();
-    cbreak();
-    noecho();
-    curs_set(0);
-    nodelay(stdscr, TRUE);
-    keypad(stdscr, TRUE); 
-    
-    if (has_colors()) {
-        edgePairID = initColors(colorConfig);
+    return true;
+}
+
+/**
+ * @brief Moves the target frame rate to the next common refresh rate up or down.
+ */
+int stepTargetFps(int current, bool up) {
+    static const int steps[] = {MIN_TARGET_FPS, 10, 15, 20, 24, 30, 48, 60, 75, 90, 120, 144, 165, MAX_TARGET_FPS};
+    if (up) {
+        for (int fps : steps) if (fps > current) return fps;
+        return MAX_TARGET_FPS;
     }
+    for (int i = sizeof(steps) / sizeof(steps[0]) - 1; i >= 0; --i) if (steps[i] < current) return steps[i];
+    return MIN_TARGET_FPS;
+}
+
+/**
+ * @brief Draws the frame timing statistics in the top-right corner of the window.
+ *
+ * Shows flush cost, the tty output queue, missed/burst frames and a histogram
+ * of how late the frame clock woke up relative to its deadlines.
+ */
+void drawStatsPanel(WINDOW *win, int width, const FrameClock& clock, const FramePacer& pacer,
+                    const StreamStats* sent, const StreamStats* received) {
+    const int panel_width = 34;
+    int x = std::max(0, width - panel_width - 1);
+    const auto& histogram = clock.jitterHistogram();
+    uint64_t total = 0;
+    for (uint64_t count : histogram) total += count;
 
-    bkgd(' ' | COLOR_PAIR(0));
-    refresh();
+    wattron(win, A_REVERSE);
+    mvwprintw(win, 0, x, " %-*s", panel_width - 1, "Frame stats (S: hide)");
+    wattroff(win, A_REVERSE);
+    mvwprintw(win, 1, x, " Flush %5.2fms  Queue %6dB ", pacer.averageFlushMs(), pacer.queuedBytes());
+    mvwprintw(win, 2, x, " Jitter mean %5.0fus max %6.2fms ", clock.meanJitterUs(), clock.maxJitterUs() / 1000.0);
+    mvwprintw(win, 3, x, " Missed %-8llu Burst %-8llu ",
+              static_cast<unsigned long long>(clock.missedFrames()),
+              static_cast<unsigned long long>(clock.burstFrames()));
+    const int bar_width = 12;
+    for (int b = 0; b < FrameClock::JITTER_BUCKETS; ++b) {
+        int filled = total ? static_cast<int>(histogram[b] * bar_width / total) : 0;
+        mvwprintw(win, 4 + b, x, " %-8s%-*s %8llu ", FrameClock::bucketLabel(b), bar_width,
+                  std::string(filled, '#').c_str(), static_cast<unsigned long long>(histogram[b]));
+    }
+    int y = 4 + FrameClock::JITTER_BUCKETS;
+    if (sent) {
+        mvwprintw(win, y++, x, " Sent %-9llu avg %4lluB/frame ",
+                  static_cast<unsigned long long>(sent->packets),
+                  static_cast<unsigned long long>(sent->packets ? sent->bytes / sent->packets : 0));
+    }
+    if (received) {
+        mvwprintw(win, y++, x, " Recv %-9llu avg %4lluB/frame ",
+                  static_cast<unsigned long long>(received->packets),
+                  static_cast<unsigned long long>(received->packets ? received->bytes / received->packets : 0));
+        mvwprintw(win, y++, x, " Lost %-7llu Late %-5llu Bad %-4llu ",
+                  static_cast<unsigned long long>(received->lost),
+                  static_cast<unsigned long long>(received->late),
+                  static_cast<unsigned long long>(received->undecodable));
+    }
+}
 
-    int height, width;
-    getmaxyx(stdscr, height, width);
-    WINDOW *vis_win = newwin(height - 1, width, 0, 0);
+// The latest buffers of one source, as the render loop draws them
+struct SourceAudio {
+    ChannelBuffers channels;             // Every captured channel, for the channel meter
+    int16_t left[BUFFER_FRAMES] = {0};   // Their stereo downmix, for every other mode
+    int16_t right[BUFFER_FRAMES] = {0};
+    uint32_t sampleRate = DEFAULT_SAMPLE_RATE;
+    bool active = false;
+    int64_t historyIndex = -1;           // Their number in the source's history; -1 when nothing new was read
+    double time = 0.0;                   // Their media time in seconds, for expression shapes
+};
 
-    signal(SIGINT, signal_handler);
-    signal(SIGTERM, signal_handler);
+/**
+ * @brief The built-in modes' names followed by the config's shapes, in mode order.
+ */
+std::vector<std::string> modeNamesFor(const std::vector<CustomVisualizer>& customVisualizers) {
+    std::vector<std::string> names = { "Oscilloscope", "VU Meter", "Bar Graph", "Galaxy", "Ellipse", "Eclipse", "Channels", "Stereo Field" };
+    for (const auto& viz : customVisualizers) names.push_back(viz.name);
+    return names;
+}
 
-    using namespace std::chrono;
-    const auto frame_duration = microseconds(16667); // ~60 FPS
-    auto next_frame_time = steady_clock::now();
-    int16_t leftAudio[BUFFER_FRAMES] = {0};
-    int16_t rightAudio[BUFFER_FRAMES] = {0};
-    
-    std::vector<std::string> modeNames = {
-        "Oscilloscope", "VU Meter", "Bar Graph", "Galaxy", "Ellipse", "Eclipse"
+/**
+ * @brief Finds a mode by name (any case) or index; -1 when there is none.
+ */
+int findMode(const std::vector<std::string>& modeNames, const std::string& name) {
+    for (size_t i = 0; i < modeNames.size(); ++i) {
+        if (strcasecmp(modeNames[i].c_str(), name.c_str()) == 0) return static_cast<int>(i);
+    }
+    int index;
+    auto result = std::from_chars(name.data(), name.data() + name.size(), index);
+    bool is_index = result.ec == std::errc() && result.ptr == name.data() + name.size();
+    return is_index && index >= 0 && index < static_cast<int>(modeNames.size()) ? index : -1;
+}
+
+/**
+ * @brief Draws one mode from one source's audio, for the terminal and the offline renderer alike.
+ */
+void drawMode(int mode, WINDOW* win, int w, int h, const SourceAudio& audio, const std::vector<int>& pairIDs,
+              const std::vector<CustomVisualizer>& customVisualizers) {
+    if (mode < NUM_BUILT_IN_MODES) {
+        switch(static_cast<BuiltInMode>(mode)) {
+            case OSCILLOSCOPE: drawOscilloscope(win, w, h, audio.left, audio.right, pairIDs, edgePairID); break;
+            case VU_METER: drawVuMeter(win, w, h, audio.left, audio.right, pairIDs, audio.active); break;
+            case BAR_GRAPH: drawBarGraph(win, w, h, audio.left, audio.right, pairIDs, audio.active); break;
+            case GALAXY: drawGalaxy(win, w, h, audio.left, audio.right, pairIDs, audio.active); break;
+            case ELLIPSE: drawEllipse(win, w, h, audio.left, audio.right, pairIDs); break;
+            case ECLIPSE: drawEclipse(win, w, h, audio.left, audio.right, pairIDs); break;
+            case CHANNELS: drawChannelMeter(win, w, h, audio.channels, audio.sampleRate, pairIDs, audio.active); break;
+            case STEREO_FIELD: drawStereoField(win, w, h, pairIDs); break;
+            default: break;
+        }
+    } else {
+        int custom_idx = mode - NUM_BUILT_IN_MODES;
+        if (custom_idx < static_cast<int>(customVisualizers.size())) {
+            drawCustomShape(win, w, h, audio.left, audio.right, pairIDs, customVisualizers[custom_idx], audio.time);
+        }
+    }
+
+    if (mode == OSCILLOSCOPE || mode == VU_METER || mode == BAR_GRAPH) {
+        wattron(win, A_BOLD);
+        mvwprintw(win, 0, 2, "L");
+        mvwprintw(win, h / 2, 2, "R");
+        wattroff(win, A_BOLD);
+    }
+}
+
+/**
+ * @brief Feeds one buffer to the running measurements of a mode, which must see every buffer, not only the drawn ones.
+ */
+void analyzeMode(int mode, const ChannelBuffers& channels, const int16_t* left, const int16_t* right,
+                 uint32_t sampleRate, bool active) {
+    if (mode == CHANNELS) meterChannels(channels, sampleRate, active);
+    else if (mode == STEREO_FIELD) analyzeStereoField(left, right, sampleRate, active);
+    else if (mode >= NUM_BUILT_IN_MODES) trackBeats(left, right, sampleRate, active);
+}
+
+/**
+ * @brief Equal sub-windows of the visualizer window, one per source.
+ *
+ * All tiles have the same size, so every source shares the visualizers'
+ * one geometry. They are only rebuilt when the window or layout changes;
+ * subwindows share the parent's cells, so the parent's single erase and
+ * refresh per frame cover them.
+ */
+struct SourceTiles {
+    std::vector<WINDOW*> windows;
+    int width = 0;
+    int height = 0;
+
+    ~SourceTiles() { clear(); }
+
+    void layout(WINDOW* parent, int count) {
+        clear();
+        int parent_height, parent_width;
+        getmaxyx(parent, parent_height, parent_width);
+        // Wider than tall when the count is not square: terminals are wide
+        int columns = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+        int rows = (count + columns - 1) / columns;
+        width = parent_width / columns;
+        height = parent_height / rows;
+        for (int i = 0; i < count; ++i) {
+            bool fits = width > 0 && height > 0;
+            windows.push_back(fits ? derwin(parent, height, width, (i / columns) * height, (i % columns) * width) : nullptr);
+        }
+    }
+
+    void clear() {
+        for (WINDOW* win : windows) if (win) delwin(win);
+        windows.clear();
+    }
+};
+
+/**
+ * @brief Frames drawn from the history, so going back over them is only a copy.
+ *
+ * Each frame is an off-screen pad, keyed by everything that went into it:
+ * source, buffer, mode, size and colors. When the cache is full the least
+ * recently shown frame is drawn over, reusing its pad if the size matches.
+ */
+struct HistoryFrameCache {
+    static const size_t CAPACITY = 64;
+    struct Entry {
+        int source;
+        uint64_t index;
+        int mode;
+        int width, height;
+        const std::vector<int>* pairIDs;
+        WINDOW* pad;
+        uint64_t lastUse;
     };
-    for(const auto& viz : customVisualizers) {
-        modeNames.push_back(viz.name);
+    std::vector<Entry> entries;
+    uint64_t uses = 0;
+
+    ~HistoryFrameCache() { clear(); }
+
+    WINDOW* find(int source, uint64_t index, int mode, int width, int height, const std::vector<int>* pairIDs) {
+        for (Entry& entry : entries) {
+            if (entry.source == source && entry.index == index && entry.mode == mode && entry.width == width &&
+                entry.height == height && entry.pairIDs == pairIDs) {
+                entry.lastUse = ++uses;
+                return entry.pad;
+            }
+        }
+        return nullptr;
+    }
+
+    // A pad of this size for a new frame, or nullptr if curses cannot make one
+    WINDOW* insert(int source, uint64_t index, int mode, int width, int height, const std::vector<int>* pairIDs) {
+        Entry* slot = nullptr;
+        if (entries.size() < CAPACITY) {
+            entries.push_back(Entry{});
+            slot = &entries.back();
+            slot->pad = nullptr;
+        } else {
+            slot = &*std::min_element(entries.begin(), entries.end(),
+                                      [](const Entry& a, const Entry& b) { return a.lastUse < b.lastUse; });
+            if (slot->width != width || slot->height != height) {
+                delwin(slot->pad);
+                slot->pad = nullptr;
+            }
+        }
+        if (!slot->pad) slot->pad = newpad(height, width);
+        if (!slot->pad) {
+            entries.erase(entries.begin() + (slot - entries.data()));
+            return nullptr;
+        }
+        *slot = Entry{source, index, mode, width, height, pairIDs, slot->pad, ++uses};
+        return slot->pad;
+    }
+
+    void clear() {
+        for (Entry& entry : entries) if (entry.pad) delwin(entry.pad);
+        entries.clear();
+    }
+};
+
+/**
+ * @brief Options given on the command line.
+ */
+struct CommandLine {
+    std::vector<std::string> publishUrls;  // --publish: send the analysis of every frame to each of these
+    std::string remoteUrl;                 // --remote: draw frames received from here instead of capturing
+    std::string replayPath;                // --replay: draw frames from an analysis log instead of capturing
+    ReplaySpeed replaySpeed = ReplaySpeed::REALTIME;
+    std::string analysisLogPath;           // --record-analysis: append every analysis frame to this log
+    bool raw = false;                      // --raw: write bar values instead of drawing
+    RawOutputOptions rawOptions;
+    bool daemon = false;                   // --daemon: capture and publish only
+    std::string controlPath;               // --control: serve the control protocol on this Unix socket
+    int fps = 60;                          // --fps: frame rate of the headless modes
+    std::vector<std::string> sources;      // --source: what to capture, one view each (default sink monitor if none)
+    bool overlay = false;                  // --layout overlay: draw every source in the full window
+    int channels = 2;                      // --channels: capture this many channels from every source
+    int historySeconds = 60;               // --history: seconds kept per source for freeze and scrub
+    BatchOptions batch;                    // --analyze: files to analyze offline instead of capturing
+    CastOptions cast;                      // --render: a file to render to a recording instead of capturing
+    SpectrogramOptions spectrogram;        // --spectrogram: a file to render to an image instead of capturing
+    CastRecordOptions record;              // --record...: live recording of the terminal
+};
+
+const int MAX_HISTORY_SECONDS = 600;
+const int MAX_JOBS = 256;
+const int MAX_RECORD_MEGABYTES = 4096;
+const int MAX_RECORD_FILES = 100;
+const int MIN_SPECTROGRAM_FFT = 256;
+const int MAX_SPECTROGRAM_FFT = 32768;
+const int MIN_CAST_SIZE = 10;
+const int MAX_CAST_SIZE = 1000;
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--publish URL]... [--remote URL] [--raw TARGET [raw options]] [--daemon]\n"
+              << "       [--control PATH] [--source SPEC]... [--layout tiles|overlay] [--channels N]\n"
+              << "       [--history SECONDS] [--record] [--record-dir DIR] [--record-limit MB] [--record-files N]\n"
+              << "       [--record-analysis FILE] [--replay FILE [--replay-speed 1x|slow|max]]\n"
+              << "       " << program << " --analyze FILE... [--features csv|binary] [--output-dir DIR] [--jobs N]\n"
+              << "       [--chunk SECONDS]\n"
+              << "       " << program << " --render FILE [--mode NAME] [--size WxH] [--fps N] [--cast-out PATH]\n"
+              << "       [--jobs N] [--chunk SECONDS]\n"
+              << "       " << program << " --spectrogram FILE [--image-out PATH] [--palette gray|color] [--fft N]\n"
+              << "       [--hop N] [--floor DB] [--jobs N]\n"
+              << "  --publish URL  Publish the analysis of every frame to URL\n"
+              << "                 (udp://host:port sends to host, tcp://:port accepts viewers,\n"
+              << "                 unix://path accepts local viewers, shm://name writes shared\n"
+              << "                 memory /name, see mallard_shm.h)\n"
+              << "  --remote URL   Show published analysis instead of capturing audio\n"
+              << "                 (udp://:port listens, tcp://host:port and unix://path connect,\n"
+              << "                 shm://name reads)\n"
+              << "  --raw TARGET   Write bar values to TARGET (- for stdout, or a FIFO) without ncurses\n"
+              << "  --raw-format ascii|binary  ascii: values separated by ';', one line per frame (default)\n"
+              << "  --bars N       Number of bars, " << MIN_BAR_COUNT << "-" << MAX_BAR_COUNT << " (default " << DEFAULT_BAR_COUNT << ")\n"
+              << "  --bits 8|16    Bar values run from 0 to 2^bits - 1 (default 16)\n"
+              << "  --fps N        Raw output and daemon frame rate, " << MIN_TARGET_FPS << "-" << MAX_TARGET_FPS << " (default 60)\n"
+              << "  --daemon       Capture once and serve every viewer, without a terminal\n"
+              << "                 (publishes to unix:// unless --publish is given;\n"
+              << "                 an empty unix:// path means " << defaultStreamSocketPath() << ")\n"
+              << "  --control PATH Accept commands on a Unix socket (send \"help\" for the list)\n"
+              << "  --source SPEC  Capture SPEC, repeatable up to " << MAX_CAPTURE_SOURCES << " times, each with its own view:\n"
+              << "                 default (what the default sink plays), sink:NAME, mic, mic:NAME\n"
+              << "                 or app:NAME (what one application plays)\n"
+              << "  --layout tiles|overlay  Show several sources side by side (default) or on top\n"
+              << "                 of each other, one color per source (L switches)\n"
+              << "  --channels N   Capture N channels, 1-" << MAX_CHANNELS << " (default 2; 6 is 5.1, 8 is 7.1); the\n"
+              << "                 Channels mode meters each one, the other modes show a stereo downmix\n"
+              << "  --history SECONDS  Keep the last SECONDS of audio per source, 0-" << MAX_HISTORY_SECONDS << " (default 60;\n"
+              << "                 0 turns it off). F freezes the display, Left/Right and PgUp/PgDn\n"
+              << "                 scrub through it, Home goes to the oldest, End back to live\n"
+              << "  --record       Record the screen to an asciicast file from the start (R toggles)\n"
+              << "  --record-dir DIR  Write recordings to DIR (default the current directory)\n"
+              << "  --record-limit MB  Start a new file once a recording file holds MB, 1-" << MAX_RECORD_MEGABYTES << " (default 32)\n"
+              << "  --record-files N  Keep the newest N files of a recording, 1-" << MAX_RECORD_FILES << " (default 4)\n"
+              << "  --record-analysis FILE  Append every analysis frame to FILE, an analysis log\n"
+              << "                 (see analysis_log.h), to replay the session without its audio\n"
+              << "  --replay FILE  Show an analysis log instead of capturing audio\n"
+              << "  --replay-speed 1x|slow|max  As recorded (default), a quarter of that, or one\n"
+              << "                 recorded frame per frame drawn; > cycles\n"
+              << "  --analyze FILE...  Analyze WAVE files offline as fast as possible, writing levels,\n"
+              << "                 bands, onsets and loudness per hop to FILE.features.csv (or .bin)\n"
+              << "  --features csv|binary  Feature file format (default csv; binary is described in\n"
+              << "                 batch_analysis.h)\n"
+              << "  --output-dir DIR  Write feature files to DIR instead of next to each input\n"
+              << "  --jobs N       Worker threads (processes for --render), 1-" << MAX_JOBS << " (default one per core)\n"
+              << "  --chunk SECONDS  Split files into chunks of this much audio, 1-3600 (default 30)\n"
+              << "  --render FILE  Draw a mode for a WAVE file into an asciicast v2 recording, as fast\n"
+              << "                 as possible and without a terminal (see cast_render.h)\n"
+              << "  --mode NAME    Mode to render, by name or number (default the first)\n"
+              << "  --size WxH     Size of the recording in cells, " << MIN_CAST_SIZE << "x" << MIN_CAST_SIZE << " to "
+              << MAX_CAST_SIZE << "x" << MAX_CAST_SIZE << " (default 100x30)\n"
+              << "  --cast-out PATH  Write the recording to PATH (default FILE.cast)\n"
+              << "  --spectrogram FILE  Render a WAVE file into a spectrogram image, time running down\n"
+              << "                 and frequency across (see spectrogram.h)\n"
+              << "  --image-out PATH  Write the image to PATH (default FILE.pgm, or FILE.ppm in color)\n"
+              << "  --palette gray|color  A gray PGM (default) or a heat-map PPM\n"
+              << "  --fft N        Samples per row, a power of two " << MIN_SPECTROGRAM_FFT << "-" << MAX_SPECTROGRAM_FFT
+              << " (default 2048); the image is N/2 wide\n"
+              << "  --hop N        Samples between rows, 1-" << MAX_SPECTROGRAM_FFT << " (default 512)\n"
+              << "  --floor DB     Level drawn black, -200 to -10 dBFS (default -100)" << std::endl;
+}
+
+bool parseIntOption(const std::string& text, int min, int max, int& out) {
+    int value;
+    auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (result.ec != std::errc() || result.ptr != text.data() + text.size() || value < min || value > max) return false;
+    out = value;
+    return true;
+}
+
+/**
+ * @brief Parses "WIDTHxHEIGHT", each within the recording size limits.
+ */
+bool parseCastSize(const std::string& text, CastOptions& out) {
+    size_t x = text.find('x');
+    if (x == std::string::npos) return false;
+    int width, height;
+    if (!parseIntOption(text.substr(0, x), MIN_CAST_SIZE, MAX_CAST_SIZE, width) ||
+        !parseIntOption(text.substr(x + 1), MIN_CAST_SIZE, MAX_CAST_SIZE, height)) return false;
+    out.width = width;
+    out.height = height;
+    return true;
+}
+
+bool parseCommandLine(int argc, char* argv[], CommandLine& out) {
+    int floor_db;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--publish" && i + 1 < argc) {
+            out.publishUrls.push_back(argv[++i]);
+        } else if (arg == "--remote" && i + 1 < argc) {
+            out.remoteUrl = argv[++i];
+        } else if (arg == "--raw" && i + 1 < argc) {
+            out.raw = true;
+            out.rawOptions.target = argv[++i];
+        } else if (arg == "--raw-format" && i + 1 < argc && (argv[i + 1] == std::string("ascii") || argv[i + 1] == std::string("binary"))) {
+            out.rawOptions.format = argv[++i] == std::string("ascii") ? RawFormat::ASCII : RawFormat::BINARY;
+        } else if (arg == "--bars" && i + 1 < argc && parseIntOption(argv[i + 1], MIN_BAR_COUNT, MAX_BAR_COUNT, out.rawOptions.bars)) {
+            ++i;
+        } else if (arg == "--bits" && i + 1 < argc && (argv[i + 1] == std::string("8") || argv[i + 1] == std::string("16"))) {
+            out.rawOptions.bits = std::atoi(argv[++i]);
+        } else if (arg == "--fps" && i + 1 < argc && parseIntOption(argv[i + 1], MIN_TARGET_FPS, MAX_TARGET_FPS, out.fps)) {
+            ++i;
+        } else if (arg == "--daemon") {
+            out.daemon = true;
+        } else if (arg == "--control" && i + 1 < argc) {
+            out.controlPath = argv[++i];
+        } else if (arg == "--source" && i + 1 < argc) {
+            CaptureSource::Kind kind;
+            std::string target;
+            if (!parseSourceSpec(argv[i + 1], kind, target)) {
+                std::cerr << "Error: unknown source '" << argv[i + 1] << "'." << std::endl;
+                printUsage(argv[0]);
+                return false;
+            }
+            out.sources.push_back(argv[++i]);
+        } else if (arg == "--channels" && i + 1 < argc && parseIntOption(argv[i + 1], 1, MAX_CHANNELS, out.channels)) {
+            ++i;
+        } else if (arg == "--history" && i + 1 < argc && parseIntOption(argv[i + 1], 0, MAX_HISTORY_SECONDS, out.historySeconds)) {
+            ++i;
+        } else if (arg == "--analyze" && i + 1 < argc) {
+            // Every argument up to the next option is a file, so shell globs work
+            while (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) out.batch.inputs.push_back(argv[++i]);
+        } else if (arg == "--features" && i + 1 < argc && (argv[i + 1] == std::string("csv") || argv[i + 1] == std::string("binary"))) {
+            out.batch.format = argv[++i] == std::string("csv") ? FeatureFormat::CSV : FeatureFormat::BINARY;
+        } else if (arg == "--output-dir" && i + 1 < argc) {
+            out.batch.outputDir = argv[++i];
+        } else if (arg == "--jobs" && i + 1 < argc && parseIntOption(argv[i + 1], 1, MAX_JOBS, out.batch.jobs)) {
+            ++i;
+        } else if (arg == "--chunk" && i + 1 < argc && parseIntOption(argv[i + 1], 1, 3600, out.batch.chunkSeconds)) {
+            ++i;
+        } else if (arg == "--record-analysis" && i + 1 < argc) {
+            out.analysisLogPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            out.replayPath = argv[++i];
+        } else if (arg == "--replay-speed" && i + 1 < argc && parseReplaySpeed(argv[i + 1], out.replaySpeed)) {
+            ++i;
+        } else if (arg == "--record") {
+            out.record.startNow = true;
+        } else if (arg == "--record-dir" && i + 1 < argc) {
+            out.record.directory = argv[++i];
+        } else if (arg == "--record-limit" && i + 1 < argc && parseIntOption(argv[i + 1], 1, MAX_RECORD_MEGABYTES, out.record.fileMegabytes)) {
+            ++i;
+        } else if (arg == "--record-files" && i + 1 < argc && parseIntOption(argv[i + 1], 1, MAX_RECORD_FILES, out.record.files)) {
+            ++i;
+        } else if (arg == "--spectrogram" && i + 1 < argc) {
+            out.spectrogram.input = argv[++i];
+        } else if (arg == "--image-out" && i + 1 < argc) {
+            out.spectrogram.output = argv[++i];
+        } else if (arg == "--palette" && i + 1 < argc && (argv[i + 1] == std::string("gray") || argv[i + 1] == std::string("color"))) {
+            out.spectrogram.color = argv[++i] == std::string("color");
+        } else if (arg == "--fft" && i + 1 < argc && parseIntOption(argv[i + 1], MIN_SPECTROGRAM_FFT, MAX_SPECTROGRAM_FFT, out.spectrogram.fftSize) &&
+                   (out.spectrogram.fftSize & (out.spectrogram.fftSize - 1)) == 0) {
+            ++i;
+        } else if (arg == "--hop" && i + 1 < argc && parseIntOption(argv[i + 1], 1, MAX_SPECTROGRAM_FFT, out.spectrogram.hop)) {
+            ++i;
+        } else if (arg == "--floor" && i + 1 < argc && parseIntOption(argv[i + 1], -200, -10, floor_db)) {
+            out.spectrogram.floorDb = static_cast<float>(floor_db);
+            ++i;
+        } else if (arg == "--render" && i + 1 < argc) {
+            out.cast.input = argv[++i];
+        } else if (arg == "--mode" && i + 1 < argc) {
+            out.cast.mode = argv[++i];
+        } else if (arg == "--size" && i + 1 < argc && parseCastSize(argv[i + 1], out.cast)) {
+            ++i;
+        } else if (arg == "--cast-out" && i + 1 < argc) {
+            out.cast.output = argv[++i];
+        } else if (arg == "--layout" && i + 1 < argc && (argv[i + 1] == std::string("tiles") || argv[i + 1] == std::string("overlay"))) {
+            out.overlay = argv[++i] == std::string("overlay");
+        } else {
+            printUsage(argv[0]);
+            return false;
+        }
+    }
+    if (!out.publishUrls.empty() && !out.remoteUrl.empty()) {
+        std::cerr << "Error: --publish and --remote cannot be combined." << std::endl;
+        return false;
+    }
+    if (out.daemon && (out.raw || !out.remoteUrl.empty())) {
+        std::cerr << "Error: --daemon cannot be combined with --raw or --remote." << std::endl;
+        return false;
+    }
+    if ((!out.controlPath.empty() || out.record.startNow) && (out.daemon || out.raw)) {
+        std::cerr << "Error: --control and --record only apply to the terminal visualizer." << std::endl;
+        return false;
+    }
+    if (!out.sources.empty() && !out.remoteUrl.empty()) {
+        std::cerr << "Error: --source and --remote cannot be combined." << std::endl;
+        return false;
+    }
+    if (out.sources.size() > 1 && (out.daemon || out.raw)) {
+        std::cerr << "Error: --daemon and --raw capture a single --source." << std::endl;
+        return false;
+    }
+    if (out.sources.size() > MAX_CAPTURE_SOURCES) {
+        std::cerr << "Error: at most " << MAX_CAPTURE_SOURCES << " sources can be captured." << std::endl;
+        return false;
+    }
+    if (!out.batch.inputs.empty() && (out.daemon || out.raw || !out.remoteUrl.empty() || !out.sources.empty() ||
+                                      !out.publishUrls.empty() || !out.controlPath.empty())) {
+        std::cerr << "Error: --analyze works on files and cannot be combined with capture or stream options." << std::endl;
+        return false;
+    }
+    if (!out.cast.input.empty() && (out.daemon || out.raw || !out.remoteUrl.empty() || !out.sources.empty() ||
+                                    !out.publishUrls.empty() || !out.controlPath.empty() || !out.batch.inputs.empty())) {
+        std::cerr << "Error: --render works on a file and cannot be combined with capture, stream or --analyze options." << std::endl;
+        return false;
+    }
+    if (!out.spectrogram.input.empty() && (out.daemon || out.raw || !out.remoteUrl.empty() || !out.sources.empty() ||
+                                           !out.publishUrls.empty() || !out.controlPath.empty() || !out.batch.inputs.empty() ||
+                                           !out.cast.input.empty() || !out.replayPath.empty())) {
+        std::cerr << "Error: --spectrogram works on a file and cannot be combined with capture, stream, replay, --analyze or --render options." << std::endl;
+        return false;
+    }
+    if (!out.replayPath.empty() && (out.daemon || !out.remoteUrl.empty() || !out.sources.empty() || !out.publishUrls.empty() ||
+                                    !out.analysisLogPath.empty() || !out.batch.inputs.empty() || !out.cast.input.empty())) {
+        std::cerr << "Error: --replay cannot be combined with capture, stream, --record-analysis, --analyze or --render options." << std::endl;
+        return false;
+    }
+    if (out.daemon && out.publishUrls.empty()) out.publishUrls.push_back("unix://");
+    out.rawOptions.fps = out.fps;
+    out.cast.fps = out.fps;
+    out.cast.jobs = out.batch.jobs;
+    out.cast.chunkSeconds = out.batch.chunkSeconds;
+    out.spectrogram.jobs = out.batch.jobs;
+    return true;
+}
+
+/**
+ * @brief Stops the audio capture thread, if one was started.
+ */
+void stopAudioCapture(std::thread& audioThread) {
+    // 1. Force Audio Loop to Wake/Quit
+    {
+        std::lock_guard<std::mutex> lock(loop_mutex);
+        #ifdef USE_PIPEWIRE
+        if (global_pw_loop) pw_main_loop_quit(global_pw_loop);
+        #else
+        if (global_pa_loop) pa_mainloop_quit(global_pa_loop, 0);
+        #endif
+    }
+
+    // 2. Join Thread (Safe because loop was signaled)
+    if (audioThread.joinable()) {
+        audioThread.join();
     }
-    const int total_modes = modeNames.size();
+}
+
+/**
+ * @brief What main() opened for the terminal visualizer: its views, their audio and the streams it serves.
+ */
+struct TerminalSetup {
+    const CommandLine* options = nullptr;
+    std::shared_ptr<const ConfigSnapshot> config;
+    std::string configPath;                            // Watched for hot reloads
+    std::string configError;                           // Shown once the terminal is up
+    std::vector<SourceAudio>* sourceAudio = nullptr;   // One per view; readAudio fills the first
+    std::vector<SampleHistory*> histories;             // Each view's history, for freeze and scrub
+    std::vector<std::string> labels;                   // Each view's name, for the legend and `sources`
+    std::function<bool(int16_t*, int16_t*)> readAudio;
+    StreamPublisher* publisher = nullptr;              // For the stats panel
+    StreamReceiver* receiver = nullptr;
+    AnalysisReplayer* replayer = nullptr;
+    ControlServer* control = nullptr;
+    std::thread* audioThread = nullptr;                // Stopped before the terminal is given back
+};
+
+/**
+ * @brief The interactive terminal: its windows, modes, freeze and scrub state, and the render loop.
+ *
+ * run() owns the terminal from initscr() to endwin(). Every frame it drains
+ * the sources, draws each view live or from its history, and then sleeps
+ * until the next one, answering keys (handleKey()) and control socket
+ * requests (handleCommand()) as they arrive.
+ */
+struct TerminalApp {
+    using Clock = std::chrono::steady_clock;
+    static constexpr std::chrono::milliseconds RESIZE_DEBOUNCE{80};
+    static constexpr int STDIN_SOURCE = 0;
+    static constexpr int CONTROL_SOURCE = 1;
+    // The analysis of a frozen frame runs the mode over the buffers leading up
+    // to it: every buffer is measured and those drawn live are drawn again,
+    // so decays, windows and histories look as they did live. A frame just
+    // after the last one analyzed carries on from there; anything else starts
+    // over this long before it.
+    static constexpr double HISTORY_WARMUP_SECONDS = 0.5;
+
+    struct ScrubState {
+        bool valid = false;
+        uint64_t index = 0;
+        int mode = -1;
+        int width = 0, height = 0;
+    };
+
+    TerminalSetup setup;
+    const int source_count;
+    std::vector<SourceAudio>& sourceAudio;
+    std::shared_ptr<const ConfigSnapshot> activeConfig;
+
+    WINDOW* vis_win = nullptr;
+    int height = 0, width = 0;
+    bool overlay;
+    SourceTiles tiles;
+    HistoryFrameCache frameCache;
+    // Overlaid sources are told apart by color: each gets one pair, spread over the gradient
+    std::vector<std::vector<int>> overlayPairIDs;
+
+    FramePacer pacer;
+    // Records beside the loop, which only hands it each flushed screen
+    CastRecorder recorder;
+    FrameClock frameClock;
+    // Config hot reload: the watcher parses on its own thread, we only swap between frames
+    ConfigWatcher configWatcher;
+    bool show_stats = false;
+    int frame_count = 0;
+    Clock::time_point last_time = Clock::now();
+    float last_fps = 0.0f;
+    std::vector<std::string> modeNames;
+    int total_modes = 0;
     int currentModeIdx = 0;
+    int measuredMode = 0;  // The mode the running measurements belong to
 
-    // --- Main Rendering Loop ---
-    while (running) {
-        next_frame_time += frame_duration;
-        int ch = getch();
-        if (ch != ERR) {
-            if (ch == KEY_RESIZE) {
-                getmaxyx(stdscr, height, width);
-                wresize(vis_win, height - 1, width);
-                bkgd(' ' | COLOR_PAIR(0));
-                touchwin(stdscr);
-                refresh();
-            } else if (ch == 'q' || ch == 'Q') {
-                running = false;
-            } else if (ch == ' ') {
+    // Short-lived message shown in the status bar (config reload results)
+    std::string status_message;
+    Clock::time_point status_message_until = Clock::now();
+
+    // Frozen, every view shows the buffer `scrubBack` before the newest one
+    // at the moment of freezing; capture, history and publishing carry on.
+    bool frozen = false;
+    int64_t scrubBack = 0;            // Negative: newer than the freeze
+    std::vector<uint64_t> freezeEnd;  // Each history's end() when frozen
+    std::vector<ScrubState> scrubStates;
+    SourceAudio historyAudio;
+
+    // Resizes are debounced: while the user drags the window we keep the last
+    // frame on screen and only resize/rebuild once the size has settled.
+    bool resize_pending = false;
+    Clock::time_point resize_settle_time = Clock::now();
+
+    int waitFds[2] = { STDIN_FILENO, -1 };
+    int waitCount = 1;
+
+    explicit TerminalApp(const TerminalSetup& setup)
+        : setup(setup), source_count(static_cast<int>(setup.sourceAudio->size())), sourceAudio(*setup.sourceAudio),
+          activeConfig(setup.config), overlay(setup.options->overlay),
+          pacer(STDOUT_FILENO, setup.config->config->getTargetFps()), recorder(setup.options->record),
+          frameClock(setup.config->config->getCatchUpPolicy()), configWatcher(setup.configPath),
+          freezeEnd(source_count), scrubStates(source_count) {
+        rebuildModeNames();
+        if (setup.control) waitFds[waitCount++] = setup.control->pollFd();
+    }
+
+    // Returns once `running` is cleared, with the terminal given back
+    int run() {
+        setTerminalOwned(true);
+        initscr();
+        cbreak();
+        noecho();
+        curs_set(0);
+        nodelay(stdscr, TRUE);
+        keypad(stdscr, TRUE);
+
+        if (has_colors()) {
+            edgePairID = initColors(activeConfig->config->getColorPairs());
+        }
+        rebuildOverlayPairs();
+
+        bkgd(' ' | COLOR_PAIR(0));
+        refresh();
+
+        getmaxyx(stdscr, height, width);
+        vis_win = newwin(height - 1, width, 0, 0);
+        setVisualizerSourceCount(source_count);
+        configureVisualizers(activeConfig->config->getQualitySettings(), activeConfig->customVisualizers);
+        layoutSources();
+
+        if (!setup.configError.empty()) showStatusMessage("Config: " + setup.configError);
+        if (setup.options->record.startNow) startRecording();
+        configWatcher.start();
+
+        // --- Main Rendering Loop ---
+        while (running) {
+            takeUpdates();
+            readSources();
+
+            if (resize_pending) {
+                if (Clock::now() < resize_settle_time) {
+                    waitForNextFrame();
+                    continue;
+                }
+                applyResize();
+            }
+
+            // The terminal still has a backlog of old frames; drawing now only adds latency
+            if (pacer.shouldSkipFrame()) {
+                waitForNextFrame();
+                continue;
+            }
+
+            drawSources();
+            drawStatusBar();
+
+            // Single flush per frame; its duration tells us whether the terminal keeps up
+            wnoutrefresh(stdscr);
+            auto flush_start = Clock::now();
+            doupdate();
+            pacer.recordFlush(std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - flush_start));
+            // curscr is now exactly what the terminal shows
+            recorder.capture(curscr);
+            if (recorder.failed()) stopRecording();
+
+            waitForNextFrame();
+        }
+
+        // --- CLEANUP SEQUENCE ---
+        stopAudioCapture(*setup.audioThread);
+        recorder.stop();
+
+        // Destroy Ncurses
+        tiles.clear();
+        frameCache.clear();
+        delwin(vis_win);
+        delwin(stdscr);
+        endwin();
+        setTerminalOwned(false);
+        return 0;
+    }
+
+    // Every buffer read goes to the shown mode's measurements; frozen, the live ones are held as they were
+    void measure(int source, const ChannelBuffers& channels, const int16_t* left, const int16_t* right,
+                 uint32_t sampleRate, bool active) {
+        if (frozen) return;
+        selectVisualizerSource(source);
+        analyzeMode(currentModeIdx, channels, left, right, sampleRate, active);
+    }
+
+    void rebuildOverlayPairs() {
+        overlayPairIDs.assign(source_count, {});
+        if (colorPairIDs.empty()) return;
+        for (int i = 0; i < source_count; ++i) {
+            size_t pair = source_count > 1 ? i * (colorPairIDs.size() - 1) / (source_count - 1) : 0;
+            overlayPairIDs[i].push_back(colorPairIDs[pair]);
+        }
+    }
+
+    // Side by side sources get a tile each; a single source or an overlay uses the whole window
+    void layoutSources() {
+        tiles.clear();
+        if (source_count > 1 && !overlay) {
+            tiles.layout(vis_win, source_count);
+            resizeVisualizers(tiles.width, tiles.height);
+        } else {
+            int vis_height, vis_width;
+            getmaxyx(vis_win, vis_height, vis_width);
+            resizeVisualizers(vis_width, vis_height);
+        }
+    }
+
+    void rebuildModeNames() {
+        modeNames = modeNamesFor(activeConfig->customVisualizers);
+        total_modes = modeNames.size();
+    }
+
+    void showStatusMessage(const std::string& message) {
+        status_message = message;
+        status_message_until = Clock::now() + std::chrono::seconds(5);
+    }
+
+    void startRecording() {
+        if (recorder.recording()) return;
+        recorder.start();
+        showStatusMessage("Recording to " + recorder.path() + " (R stops)");
+    }
+
+    void stopRecording() {
+        if (!recorder.recording()) return;
+        recorder.stop();
+        showStatusMessage(recorder.failed() ? "Recording stopped: " + recorder.error() : "Recording saved to " + recorder.path());
+    }
+
+    // Swaps in a new config, rebuilding only what actually changed
+    void applyConfig(std::shared_ptr<const ConfigSnapshot> next) {
+        const ConfigParser& cfg = *next->config;
+        const ConfigParser& old = *activeConfig->config;
+        if (has_colors() && cfg.getColorPairs() != old.getColorPairs()) {
+            edgePairID = initColors(cfg.getColorPairs());
+            rebuildOverlayPairs();
+            recorder.colorsChanged();
+        }
+        decay__factor = cfg.getDecayFactor();
+        if (cfg.getTargetFps() != old.getTargetFps()) pacer.setTargetFps(cfg.getTargetFps());
+        frameClock.setPolicy(cfg.getCatchUpPolicy());
+
+        bool shapes_changed = !sameVisualizers(next->customVisualizers, activeConfig->customVisualizers);
+        std::string current_name = modeNames[currentModeIdx];
+        activeConfig = next;
+        configureVisualizers(cfg.getQualitySettings(), activeConfig->customVisualizers);
+        if (shapes_changed) {
+            rebuildModeNames();
+            // Stay on the same mode if it still exists
+            auto it = std::find(modeNames.begin(), modeNames.end(), current_name);
+            currentModeIdx = (it != modeNames.end()) ? static_cast<int>(it - modeNames.begin()) : 0;
+        }
+        frameCache.clear();  // Colors and shapes may have changed
+        showStatusMessage("Config reloaded");
+    }
+
+    // Config reloads, capture errors and mode changes, between frames
+    void takeUpdates() {
+        if (configWatcher.hasUpdate()) {
+            std::string error;
+            auto next = configWatcher.takeUpdate(error);
+            if (next) applyConfig(next);
+            else showStatusMessage("Config error, keeping previous: " + error);
+        }
+        std::string capture_message = takeCaptureError();
+        if (!capture_message.empty()) showStatusMessage(capture_message);
+        if (currentModeIdx != measuredMode && !frozen) {
+            for (int i = 0; i < source_count; ++i) {
+                selectVisualizerSource(i);
+                resetMeasurements();
+            }
+            measuredMode = currentModeIdx;
+        }
+    }
+
+    // --- Freeze and scrub ---
+    double buffersPerSecond() const {
+        return static_cast<double>(std::max<uint32_t>(1, global_sample_rate.load(std::memory_order_relaxed))) / BUFFER_FRAMES;
+    }
+
+    bool freeze() {
+        if (frozen) return true;
+        if (!setup.histories[0]->enabled()) {
+            showStatusMessage("No history to freeze (--history 0)");
+            return false;
+        }
+        for (int i = 0; i < source_count; ++i) freezeEnd[i] = setup.histories[i]->end();
+        scrubBack = 0;
+        scrubStates.assign(source_count, ScrubState());
+        holdVisualizerState();
+        frozen = true;
+        return true;
+    }
+
+    void resumeLive() {
+        if (!frozen) return;
+        frozen = false;
+        frameCache.clear();
+        releaseVisualizerState();
+    }
+
+    // Moves back (positive) or forward through the first source's history, which the others follow
+    void scrubBy(int64_t buffers) {
+        if (!freeze()) return;
+        const SampleHistory& history = *setup.histories[0];
+        const int64_t newest = static_cast<int64_t>(freezeEnd[0]) - static_cast<int64_t>(history.end());
+        const int64_t oldest = static_cast<int64_t>(freezeEnd[0]) - 1 - static_cast<int64_t>(history.begin());
+        scrubBack = std::max(newest, std::min(oldest, scrubBack + buffers));
+    }
+
+    void scrubSeconds(double seconds) {
+        scrubBy(static_cast<int64_t>(std::lround(seconds * buffersPerSecond())));
+    }
+
+    // "frozen -1.25s" or "live"
+    std::string freezeState() const {
+        if (!frozen) return std::string("live");
+        char state[32];
+        snprintf(state, sizeof(state), "frozen %+.2fs", -scrubBack / buffersPerSecond());
+        return std::string(state);
+    }
+
+    // Applies one key press; KEY_RESIZE is coalesced by drainInput()
+    void handleKey(int ch) {
+        if (ch == 'q' || ch == 'Q') {
+            running = false;
+        } else if (ch == '+' || ch == '=') {
+            pacer.setTargetFps(stepTargetFps(pacer.targetFps(), true));
+        } else if (ch == '-' || ch == '_') {
+            pacer.setTargetFps(stepTargetFps(pacer.targetFps(), false));
+        } else if (ch == 's' || ch == 'S') {
+            show_stats = !show_stats;
+        } else if ((ch == 'l' || ch == 'L') && source_count > 1) {
+            overlay = !overlay;
+            layoutSources();
+        } else if (ch == ' ') {
+            currentModeIdx = (currentModeIdx + 1) % total_modes;
+        } else if (ch == KEY_UP && currentModeIdx == VU_METER) {
+            toggleVuMeterMode(true);
+            frameCache.clear();
+        } else if (ch == KEY_DOWN && currentModeIdx == VU_METER) {
+            toggleVuMeterMode(false);
+            frameCache.clear();
+        } else if (ch == 'f' || ch == 'F') {
+            if (frozen) resumeLive();
+            else freeze();
+        } else if (ch == KEY_LEFT) {
+            scrubSeconds(0.1);
+        } else if (ch == KEY_RIGHT) {
+            scrubSeconds(-0.1);
+        } else if (ch == KEY_PPAGE) {
+            scrubSeconds(5.0);
+        } else if (ch == KEY_NPAGE) {
+            scrubSeconds(-5.0);
+        } else if (ch == KEY_HOME) {
+            scrubBy(std::numeric_limits<int64_t>::max() / 2);
+        } else if (ch == KEY_END) {
+            resumeLive();
+        } else if (ch == '>' && setup.replayer) {
+            setup.replayer->setSpeed(static_cast<ReplaySpeed>((static_cast<int>(setup.replayer->speed()) + 1) % 3));
+        } else if (ch == 'r' || ch == 'R') {
+            if (recorder.recording()) stopRecording();
+            else startRecording();
+        }
+    }
+
+    // Answers one control socket request
+    std::string handleCommand(const std::string& command, const std::string& argument) {
+        if (command == "mode") {
+            if (argument == "next") {
                 currentModeIdx = (currentModeIdx + 1) % total_modes;
-            } else if (ch == KEY_UP && currentModeIdx == VU_METER) {
-                 toggleVuMeterMode(true);
-            } else if (ch == KEY_DOWN && currentModeIdx == VU_METER) {
-                toggleVuMeterMode(false);
+            } else if (argument == "prev") {
+                currentModeIdx = (currentModeIdx + total_modes - 1) % total_modes;
+            } else if (!argument.empty()) {
+                int index = findMode(modeNames, argument);
+                if (index < 0) return "ERR unknown mode '" + argument + "'";
+                currentModeIdx = index;
+            }
+            return "OK " + modeNames[currentModeIdx];
+        }
+        if (command == "modes") {
+            std::string reply = "OK";
+            for (int i = 0; i < total_modes; ++i) reply += (i ? ";" : " ") + modeNames[i];
+            return reply;
+        }
+        if (command == "fps") {
+            int fps;
+            if (!argument.empty()) {
+                if (!parseIntOption(argument, MIN_TARGET_FPS, MAX_TARGET_FPS, fps)) {
+                    return "ERR fps must be " + std::to_string(MIN_TARGET_FPS) + "-" + std::to_string(MAX_TARGET_FPS);
+                }
+                pacer.setTargetFps(fps);
+            }
+            return "OK " + std::to_string(pacer.targetFps());
+        }
+        if (command == "decay") {
+            // Lasts until the config is next reloaded
+            if (!argument.empty()) {
+                char* end = nullptr;
+                float decay = std::strtof(argument.c_str(), &end);
+                if (*end != '\0' || !(decay > 0.0f && decay <= 1.0f)) return "ERR decay must be above 0 and at most 1";
+                decay__factor = decay;
+            }
+            return "OK " + std::to_string(decay__factor);
+        }
+        if (command == "vu" && (argument == "up" || argument == "down")) {
+            toggleVuMeterMode(argument == "up");
+            frameCache.clear();
+            return std::string("OK ") + getVuMeterModeName();
+        }
+        if (command == "stats") {
+            char reply[256];
+            snprintf(reply, sizeof(reply),
+                     "OK mode=%d fps=%.0f target=%d current=%d audio=%d missed=%llu jitter_mean_us=%.0f jitter_max_ms=%.2f flush_ms=%.2f queue=%d",
+                     currentModeIdx, last_fps, pacer.targetFps(), pacer.currentFps(), audio_stream_active ? 1 : 0,
+                     static_cast<unsigned long long>(frameClock.missedFrames()), frameClock.meanJitterUs(),
+                     frameClock.maxJitterUs() / 1000.0, pacer.averageFlushMs(), pacer.queuedBytes());
+            return reply;
+        }
+        if (command == "layout") {
+            if (argument == "tiles" || argument == "overlay") {
+                if ((argument == "overlay") != overlay) {
+                    overlay = !overlay;
+                    layoutSources();
+                }
+            } else if (!argument.empty()) {
+                return "ERR layout must be tiles or overlay";
+            }
+            return overlay ? "OK overlay" : "OK tiles";
+        }
+        if (command == "sources") {
+            std::string reply = "OK";
+            for (int i = 0; i < source_count; ++i) {
+                reply += (i ? ";" : " ") + setup.labels[i] + "=" + (sourceAudio[i].active ? "1" : "0");
+            }
+            return reply;
+        }
+        if (command == "freeze") {
+            if (argument == "on") {
+                if (!freeze()) return "ERR no history (--history 0)";
+            } else if (argument == "off") {
+                resumeLive();
+            } else if (!argument.empty()) {
+                return "ERR freeze must be on or off";
+            }
+            return "OK " + freezeState();
+        }
+        if (command == "seek") {
+            // Seconds before the moment of freezing; freezes first if need be
+            char* end = nullptr;
+            double seconds = std::strtod(argument.c_str(), &end);
+            if (argument.empty() || *end != '\0' || !std::isfinite(seconds)) return "ERR seek takes a number of seconds";
+            if (!freeze()) return "ERR no history (--history 0)";
+            scrubBack = 0;
+            scrubSeconds(seconds);
+            return "OK " + freezeState();
+        }
+        if (command == "record") {
+            if (argument == "on") startRecording();
+            else if (argument == "off") stopRecording();
+            else if (!argument.empty()) return "ERR record must be on or off";
+            if (!recorder.recording()) return "OK off";
+            char reply[512];
+            snprintf(reply, sizeof(reply), "OK recording %s bytes=%llu overhead_ms=%.3f dropped=%llu", recorder.path().c_str(),
+                     static_cast<unsigned long long>(recorder.bytesWritten()), recorder.overheadMs(),
+                     static_cast<unsigned long long>(recorder.droppedFrames()));
+            return reply;
+        }
+        if (command == "replay") {
+            AnalysisReplayer* replayer = setup.replayer;
+            if (!replayer) return "ERR not replaying (--replay)";
+            ReplaySpeed speed;
+            if (argument.compare(0, 5, "seek ") == 0) {
+                char* end = nullptr;
+                double seconds = std::strtod(argument.c_str() + 5, &end);
+                if (*end != '\0' || !std::isfinite(seconds)) return "ERR seek takes a number of seconds";
+                replayer->seek(seconds);
+            } else if (parseReplaySpeed(argument, speed)) {
+                replayer->setSpeed(speed);
+            } else if (!argument.empty()) {
+                return "ERR replay takes 1x, slow, max or seek SECONDS";
             }
+            char reply[96];
+            snprintf(reply, sizeof(reply), "OK %s %.3f/%.3f frames=%llu", replaySpeedName(replayer->speed()),
+                     replayer->position(), replayer->duration(), static_cast<unsigned long long>(replayer->frameCount()));
+            return reply;
         }
+        if (command == "quit") {
+            running = false;
+            return "OK";
+        }
+        if (command == "help") {
+            return "OK mode [name|index|next|prev]; modes; fps [n]; decay [x]; vu up|down; layout [tiles|overlay]; sources; "
+                   "freeze [on|off]; seek SECONDS; record [on|off]; replay [1x|slow|max|seek SECONDS]; stats; quit";
+        }
+        return "ERR unknown command '" + command + "'";
+    }
 
-        if (!running) break;
+    void applyResize() {
+        resize_pending = false;
+        getmaxyx(stdscr, height, width);
+        tiles.clear();  // Subwindows must not outlive the size they were cut from
+        wresize(vis_win, height - 1, width);
+        layoutSources();
+        bkgd(' ' | COLOR_PAIR(0));
+        touchwin(stdscr);
+        wnoutrefresh(stdscr);
+    }
 
-        werase(vis_win);
+    // Reads everything that is pending on stdin. Only called when poll() says
+    // there is input (or a signal may have queued a KEY_RESIZE).
+    void drainInput() {
+        int ch;
+        while ((ch = getch()) != ERR) {
+            if (ch == KEY_RESIZE) {
+                resize_pending = true;
+                resize_settle_time = Clock::now() + RESIZE_DEBOUNCE;
+            } else {
+                handleKey(ch);
+            }
+        }
+    }
 
-        bool has_new_data = audioBuffer.read(leftAudio, rightAudio);
+    // Sleeps until the next frame, handling input as soon as it arrives
+    void waitForNextFrame() {
+        frameClock.setPeriod(pacer.frameDuration());
+        frameClock.scheduleNextFrame();
+        while (running) {
+            int ready = frameClock.wait(waitFds, waitCount);
+            if (ready == FrameClock::FRAME_DUE) break;
+            if (ready == STDIN_SOURCE || ready == FrameClock::INTERRUPTED) drainInput();
+            if (ready == CONTROL_SOURCE) {
+                setup.control->service([this](const std::string& command, const std::string& argument) {
+                    return handleCommand(command, argument);
+                });
+            }
+        }
+    }
+
+    // Reads the first source through readAudio and drains every other one's ring
+    void readSources() {
+        setup.readAudio(sourceAudio[0].left, sourceAudio[0].right);
+        sourceAudio[0].active = audio_stream_active;
+        sourceAudio[0].sampleRate = global_sample_rate.load(std::memory_order_relaxed);
+        // Every further source only has its own ring to drain; no locks, no threads
+        for (int i = 1; i < source_count; ++i) {
+            CaptureSource& source = captureSources[i];
+            SourceAudio& audio = sourceAudio[i];
+            audio.active = source.active.load();
+            audio.sampleRate = source.sampleRate.load(std::memory_order_relaxed);
+            bool read = false;
+            uint64_t sequence = 0;
+            while (source.ring.read(audio.channels, &sequence) && audio.active) {
+                read = true;
+                downmixStereo(audio.channels, audio.left, audio.right);
+                measure(i, audio.channels, audio.left, audio.right, audio.sampleRate, true);
+            }
+            audio.historyIndex = read ? static_cast<int64_t>(sequence) : -1;
+            if (read) audio.time = bufferTime(sequence, audio.sampleRate);
+            if (!read) {
+                std::fill(audio.left, audio.left + BUFFER_FRAMES, 0);
+                std::fill(audio.right, audio.right + BUFFER_FRAMES, 0);
+                audio.channels.clear();
+            }
+        }
+        for (int i = 0; i < source_count; ++i) {
+            const SourceAudio& audio = sourceAudio[i];
+            if (!audio.active) measure(i, audio.channels, audio.left, audio.right, audio.sampleRate, false);
+        }
+    }
+
+    // Draws the current mode for one source
+    void drawSource(WINDOW* win, int w, int h, const SourceAudio& audio, const std::vector<int>& pairIDs) {
+        drawMode(currentModeIdx, win, w, h, audio, pairIDs, activeConfig->customVisualizers);
+    }
+
+    // Draws one source's frozen frame, from the cache or analyzed now
+    void drawFromHistory(int source, WINDOW* win, int w, int h, const std::vector<int>& pairIDs) {
+        SampleHistory& history = *setup.histories[source];
+        const uint64_t begin = history.begin(), end = history.end();
+        if (begin == end || w <= 0 || h <= 0) return;
+        int64_t wanted = static_cast<int64_t>(freezeEnd[source]) - 1 - scrubBack;
+        const uint64_t index = static_cast<uint64_t>(std::max<int64_t>(begin, std::min<int64_t>(end - 1, wanted)));
 
-        if (!audio_stream_active || !has_new_data) {
-            // Decay / Silence
-            std::fill(leftAudio, leftAudio + BUFFER_FRAMES, 0);
-            std::fill(rightAudio, rightAudio + BUFFER_FRAMES, 0);
+        WINDOW* frame = frameCache.find(source, index, currentModeIdx, w, h, &pairIDs);
+        if (!frame) {
+            frame = frameCache.insert(source, index, currentModeIdx, w, h, &pairIDs);
+            if (!frame) return;
+            ScrubState& scrub = scrubStates[source];
+            const uint64_t warmup = static_cast<uint64_t>(HISTORY_WARMUP_SECONDS * buffersPerSecond());
+            uint64_t first;
+            if (scrub.valid && scrub.mode == currentModeIdx && scrub.width == w && scrub.height == h &&
+                scrub.index < index && index - scrub.index <= warmup && scrub.index >= begin) {
+                first = scrub.index + 1;
+            } else {
+                resetVisualizerState();
+                first = index > begin + warmup ? index - warmup : begin;
+            }
+            for (uint64_t k = first; k <= index; ++k) {
+                historyAudio.active = history.read(k, historyAudio.channels, historyAudio.sampleRate, &historyAudio.time);
+                if (historyAudio.active) {
+                    downmixStereo(historyAudio.channels, historyAudio.left, historyAudio.right);
+                } else {
+                    std::fill(historyAudio.left, historyAudio.left + BUFFER_FRAMES, 0);
+                    std::fill(historyAudio.right, historyAudio.right + BUFFER_FRAMES, 0);
+                    historyAudio.channels.clear();
+                }
+                analyzeMode(currentModeIdx, historyAudio.channels, historyAudio.left, historyAudio.right,
+                            historyAudio.sampleRate, historyAudio.active);
+                if (k == index || history.wasDrawn(k)) {
+                    werase(frame);
+                    drawSource(frame, w, h, historyAudio, pairIDs);
+                }
+            }
+            scrub = ScrubState{true, index, currentModeIdx, w, h};
         }
+        copywin(frame, win, 0, 0, 0, 0, h - 1, w - 1, TRUE);
+    }
+
+    void drawView(int source, WINDOW* win, int w, int h, const std::vector<int>& pairIDs) {
+        if (frozen) drawFromHistory(source, win, w, h, pairIDs);
+        else drawSource(win, w, h, sourceAudio[source], pairIDs);
+    }
+
+    // Every view, as one source, an overlay or tiles, and the stats panel over them
+    void drawSources() {
+        werase(vis_win);
 
         int vis_height, vis_width;
         getmaxyx(vis_win, vis_height, vis_width);
 
-        if (currentModeIdx < NUM_BUILT_IN_MODES) {
-            switch(static_cast<BuiltInMode>(currentModeIdx)) {
-                case OSCILLOSCOPE: drawOscilloscope(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs, edgePairID); break;
-                case VU_METER: drawVuMeter(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs, audio_stream_active); break;
-                case BAR_GRAPH: drawBarGraph(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs, audio_stream_active); break;
-                case GALAXY: drawGalaxy(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs, audio_stream_active); break;
-                case ELLIPSE: drawEllipse(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs); break;
-                case ECLIPSE: drawEclipse(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs); break;
-                default: break;
+        // A saturated terminal gets a single color pair, which cuts the escape sequences per frame
+        const std::vector<int>& framePairIDs = pacer.reducedDetail() ? monoPairIDs : colorPairIDs;
+
+        if (source_count == 1) {
+            drawView(0, vis_win, vis_width, vis_height, framePairIDs);
+        } else if (overlay) {
+            for (int i = 0; i < source_count; ++i) {
+                selectVisualizerSource(i);
+                drawView(i, vis_win, vis_width, vis_height, overlayPairIDs[i]);
+            }
+            // Legend in the bottom-right corner, in each source's color
+            for (int i = 0; i < source_count && i < vis_height; ++i) {
+                const std::string& label = setup.labels[i];
+                int pair = overlayPairIDs[i].empty() ? 0 : overlayPairIDs[i].front();
+                wattron(vis_win, COLOR_PAIR(pair) | (sourceAudio[i].active ? A_BOLD : A_DIM));
+                mvwprintw(vis_win, vis_height - source_count + i, std::max(0, vis_width - static_cast<int>(label.size()) - 1),
+                          "%s", label.c_str());
+                wattroff(vis_win, COLOR_PAIR(pair) | (sourceAudio[i].active ? A_BOLD : A_DIM));
             }
         } else {
-            int custom_idx = currentModeIdx - NUM_BUILT_IN_MODES;
-            if (custom_idx < static_cast<int>(customVisualizers.size())) {
-                drawCustomShape(vis_win, vis_width, vis_height, leftAudio, rightAudio, colorPairIDs, customVisualizers[custom_idx]);
+            for (int i = 0; i < source_count; ++i) {
+                WINDOW* tile = tiles.windows[i];
+                if (!tile) continue;
+                selectVisualizerSource(i);
+                drawView(i, tile, tiles.width, tiles.height, framePairIDs);
+                const std::string& label = setup.labels[i];
+                wattron(tile, sourceAudio[i].active ? A_REVERSE : A_DIM);
+                mvwprintw(tile, 0, std::max(0, tiles.width - static_cast<int>(label.size()) - 1), "%s", label.c_str());
+                wattroff(tile, sourceAudio[i].active ? A_REVERSE : A_DIM);
+            }
+        }
+
+        // What was drawn live is what a frozen frame replays
+        if (!frozen) {
+            for (int i = 0; i < source_count; ++i) {
+                if (sourceAudio[i].historyIndex >= 0) setup.histories[i]->markDrawn(static_cast<uint64_t>(sourceAudio[i].historyIndex));
             }
         }
 
-        if (currentModeIdx == OSCILLOSCOPE || currentModeIdx == VU_METER || currentModeIdx == BAR_GRAPH) {
-            wattron(vis_win, A_BOLD);
-            mvwprintw(vis_win, 0, 2, "L");
-            mvwprintw(vis_win, vis_height / 2, 2, "R");
-            wattroff(vis_win, A_BOLD);
+        if (show_stats) {
+            drawStatsPanel(vis_win, vis_width, frameClock, pacer,
+                           setup.publisher ? &setup.publisher->stats() : nullptr,
+                           setup.receiver ? &setup.receiver->stats() : nullptr);
         }
 
-        wrefresh(vis_win);
+        wnoutrefresh(vis_win);
+    }
 
-        // UI Status Bar
-        static int frame_count = 0;
-        static auto last_time = std::chrono::steady_clock::now();
-        static float last_fps = 0.0f;
+    // UI Status Bar
+    void drawStatusBar() {
         frame_count++;
-        auto now = std::chrono::steady_clock::now();
+        auto now = Clock::now();
         if (std::chrono::duration_cast<std::chrono::seconds>(now - last_time).count() >= 1) {
             last_fps = frame_count;
             frame_count = 0;
@@ -479,45 +1866,322 @@ int main() {
         }
 
         std::string rate_str = std::to_string(global_sample_rate.load(std::memory_order_relaxed));
+        char connection[24];
+        if (source_count == 1) {
+            snprintf(connection, sizeof(connection), "%s", audio_stream_active ? "Connected" : "Disconnected");
+        } else {
+            int connected = 0;
+            for (const SourceAudio& audio : sourceAudio) connected += audio.active ? 1 : 0;
+            snprintf(connection, sizeof(connection), "%d/%d sources", connected, source_count);
+        }
         attron(A_REVERSE);
         mvprintw(height - 1, 0, "%*s", width, " ");
         const char* vuModeInfo = (currentModeIdx == VU_METER) ? getVuMeterModeName() : "N/A";
-        mvprintw(height - 1, 0, " Rate: %-5s | %-12s | %-12s | VU: %-3s | FPS: %.0f | SPACE: Cycle | Q: Quit",
-                 rate_str.c_str(),
-                 audio_stream_active ? "Connected" : "Disconnected",
-                 modeNames[currentModeIdx].c_str(), 
-                 vuModeInfo, 
-                 last_fps);
+        if (now < status_message_until) {
+            mvprintw(height - 1, 0, " %s", status_message.c_str());
+        } else {
+            char frozen_info[48] = "";
+            if (frozen) snprintf(frozen_info, sizeof(frozen_info), "FROZEN %+.2fs (End: live) | ", -scrubBack / buffersPerSecond());
+            // What recording costs this loop per frame; the disk is the writer thread's problem
+            char record_info[48] = "";
+            if (recorder.recording()) {
+                snprintf(record_info, sizeof(record_info), "REC %.1fMB +%.2fms%s | ", recorder.bytesWritten() / 1048576.0,
+                         recorder.overheadMs(), recorder.droppedFrames() ? " DROPS" : "");
+            }
+            char replay_info[48] = "";
+            if (setup.replayer) {
+                snprintf(replay_info, sizeof(replay_info), "REPLAY %.1f/%.1fs %s | ", setup.replayer->position(),
+                         setup.replayer->duration(), replaySpeedName(setup.replayer->speed()));
+            }
+            mvprintw(height - 1, 0, " Rate: %-5s | %-12s | %-12s | VU: %-3s | FPS: %.0f/%d%s | %s%s%sSPACE: Cycle | +/-: FPS | Q: Quit",
+                     rate_str.c_str(),
+                     connection,
+                     modeNames[currentModeIdx].c_str(),
+                     vuModeInfo,
+                     last_fps,
+                     pacer.currentFps(),
+                     pacer.reducedDetail() ? "*" : "",
+                     replay_info,
+                     record_info,
+                     frozen_info);
+        }
         attroff(A_REVERSE);
+    }
+};
 
-        refresh();
+int main(int argc, char* argv[]) {
+    CommandLine options;
+    if (!parseCommandLine(argc, argv, options)) return 1;
+    if (!options.batch.inputs.empty()) return runBatchAnalysis(options.batch);
+    if (!options.spectrogram.input.empty()) return runSpectrogramExport(options.spectrogram);
 
-        auto sleep_duration = next_frame_time - std::chrono::steady_clock::now();
-        if (sleep_duration.count() > 0) {
-            std::this_thread::sleep_for(sleep_duration);
+    std::unique_ptr<StreamPublisher> publisher;
+    std::unique_ptr<StreamReceiver> receiver;
+    std::unique_ptr<ShmPublisher> shmPublisher;
+    std::unique_ptr<ShmReader> shmReader;
+    std::string stream_error;
+    std::string shm_name;
+    for (const std::string& url : options.publishUrls) {
+        bool is_shm = parseShmUrl(url, shm_name);
+        if (is_shm ? shmPublisher != nullptr : publisher != nullptr) {
+            std::cerr << "Error: only one " << (is_shm ? "shm" : "network") << " --publish is supported." << std::endl;
+            return 1;
+        }
+        bool opened;
+        if (is_shm) {
+            shmPublisher = std::make_unique<ShmPublisher>();
+            opened = shmPublisher->open(shm_name, stream_error);
+        } else {
+            publisher = std::make_unique<StreamPublisher>();
+            opened = publisher->open(url, stream_error);
+        }
+        if (!opened) {
+            std::cerr << "Error: " << stream_error << std::endl;
+            return 1;
+        }
+    }
+    if (!options.remoteUrl.empty()) {
+        bool opened;
+        if (parseShmUrl(options.remoteUrl, shm_name)) {
+            shmReader = std::make_unique<ShmReader>();
+            opened = shmReader->open(shm_name, stream_error);
+        } else {
+            receiver = std::make_unique<StreamReceiver>();
+            opened = receiver->open(options.remoteUrl, stream_error);
+        }
+        if (!opened) {
+            std::cerr << "Error: " << stream_error << std::endl;
+            return 1;
+        }
+    }
+    std::unique_ptr<AnalysisReplayer> replayer;
+    if (!options.replayPath.empty()) {
+        replayer = std::make_unique<AnalysisReplayer>();
+        if (!replayer->open(options.replayPath, stream_error)) {
+            std::cerr << "Error: " << stream_error << std::endl;
+            return 1;
+        }
+        replayer->setSpeed(options.replaySpeed);
+    }
+    std::unique_ptr<AnalysisRecorder> analysisRecorder;
+    if (!options.analysisLogPath.empty()) {
+        analysisRecorder = std::make_unique<AnalysisRecorder>();
+        if (!analysisRecorder->open(options.analysisLogPath, stream_error)) {
+            std::cerr << "Error: " << stream_error << std::endl;
+            return 1;
         }
     }
+    // A replay stands in for a remote publisher
+    const bool remote = receiver || shmReader || replayer;
+    const std::string remoteLabel = replayer ? options.replayPath : options.remoteUrl;
 
-    // --- CLEANUP SEQUENCE ---
-    // 1. Force Audio Loop to Wake/Quit
-    {
-        std::lock_guard<std::mutex> lock(loop_mutex);
-        #ifdef USE_PIPEWIRE
-        if (global_pw_loop) pw_main_loop_quit(global_pw_loop);
-        #else
-        if (global_pa_loop) pa_mainloop_quit(global_pa_loop, 0);
-        #endif
+    std::unique_ptr<ControlServer> control;
+    if (!options.controlPath.empty()) {
+        control = std::make_unique<ControlServer>();
+        if (!control->open(options.controlPath, stream_error)) {
+            std::cerr << "Error: " << stream_error << std::endl;
+            return 1;
+        }
     }
 
-    // 2. Join Thread (Safe because loop was signaled)
-    if (audioThread.joinable()) {
-        audioThread.join();
+    const char* home_dir_cstr = std::getenv("HOME");
+    if (home_dir_cstr == nullptr) {
+        std::cerr << "Error: HOME environment variable not found." << std::endl;
+        return 1;
+    }
+    std::string full_path = std::string(home_dir_cstr) + "/.config/oscilloscope.conf";
+    std::string config_error;
+    std::shared_ptr<const ConfigSnapshot> activeConfig = ConfigWatcher::load(full_path, config_error);
+    decay__factor = activeConfig->config->getDecayFactor();
+    auto colorConfig = activeConfig->config->getColorPairs();
+
+    if (!options.cast.input.empty()) {
+        const std::vector<std::string> names = modeNamesFor(activeConfig->customVisualizers);
+        int mode = options.cast.mode.empty() ? 0 : findMode(names, options.cast.mode);
+        if (mode < 0) {
+            std::cerr << "Error: no mode '" << options.cast.mode << "'." << std::endl;
+            return 1;
+        }
+        auto setup = [&](int w, int h) {
+            edgePairID = initColors(colorConfig);
+            setVisualizerSourceCount(1);
+            configureVisualizers(activeConfig->config->getQualitySettings(), activeConfig->customVisualizers);
+            resizeVisualizers(w, h);
+        };
+        SourceAudio audio;
+        audio.active = true;
+        auto measure = [&](const ChannelBuffers& channels, const int16_t* left, const int16_t* right, uint32_t sampleRate) {
+            analyzeMode(mode, channels, left, right, sampleRate, true);
+        };
+        auto draw = [&](WINDOW* win, int w, int h, const ChannelBuffers& channels, const int16_t* left,
+                        const int16_t* right, uint32_t sampleRate, double time) {
+            audio.channels = channels;
+            std::copy(left, left + BUFFER_FRAMES, audio.left);
+            std::copy(right, right + BUFFER_FRAMES, audio.right);
+            audio.sampleRate = sampleRate;
+            audio.time = time;
+            drawMode(mode, win, w, h, audio, colorPairIDs, activeConfig->customVisualizers);
+        };
+        return runCastRender(options.cast, names[mode] + " - " + options.cast.input, setup, measure, draw);
+    }
+
+    if (options.sources.empty()) options.sources.push_back("default");
+    for (const std::string& spec : options.sources) {
+        captureSources.emplace_back();
+        CaptureSource& source = captureSources.back();
+        parseSourceSpec(spec, source.kind, source.target);
+        source.label = spec;
+        source.map = ChannelMap::standard(options.channels);
+    }
+    // A remote viewer shows the one stream it receives
+    const int source_count = remote ? 1 : static_cast<int>(captureSources.size());
+
+    // Only the terminal can freeze and scrub; the rings are mapped before any capture callback runs
+    SampleHistory remoteHistory;
+    auto historyOf = [&](int index) -> SampleHistory& {
+        return remote ? remoteHistory : captureSources[index].history;
+    };
+    if (!options.raw && !options.daemon) {
+        for (int i = 0; i < source_count; ++i) {
+            if (!historyOf(i).allocate(options.historySeconds, remote ? 2 : options.channels, stream_error)) {
+                std::cerr << "Error: " << stream_error << std::endl;
+                return 1;
+            }
+        }
     }
 
-    // 3. Destroy Ncurses
-    delwin(vis_win);
-    delwin(stdscr);
-    endwin();
+    // Start Audio Thread First; a remote viewer gets its audio from the stream instead
+    std::thread audioThread;
+    if (!remote) audioThread = std::thread(audioCaptureThread);
 
-    return 0;
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+    signal(SIGHUP, signal_handler);
+
+    std::vector<SourceAudio> sourceAudio(source_count);
+
+    // Fills one buffer per channel with the newest audio of the first source
+    // or the remote stream (zeros when there is none) and publishes its analysis.
+    // All of the first source's channels are left in sourceAudio[0].
+    AnalysisFrame streamFrame;
+    // Set once the terminal is up: measures each of the first source's buffers, as readAudio() drains its ring
+    std::function<void(const ChannelBuffers&, const int16_t*, const int16_t*)> measureFirstSource;
+    int16_t remoteInterleaved[BUFFER_FRAMES * 2];
+    std::chrono::steady_clock::time_point remoteStart;
+    bool remoteStarted = false;
+    auto readAudio = [&](int16_t* left, int16_t* right) {
+        bool has_new_data;
+        ChannelBuffers& channels = sourceAudio.front().channels;
+        uint64_t sequence = 0;
+        if (remote) {
+            if (replayer) has_new_data = replayer->receive(streamFrame);
+            else has_new_data = receiver ? receiver->receive(streamFrame) : shmReader->receive(streamFrame);
+            if (has_new_data) {
+                synthesizeAudio(streamFrame, left, right);
+                channels.setStereo(left, right);
+                global_sample_rate.store(streamFrame.sampleRate, std::memory_order_relaxed);
+                if (analysisRecorder) analysisRecorder->append(streamFrame);
+            }
+            if (replayer) audio_stream_active = replayer->active();
+            else audio_stream_active = receiver ? receiver->active() : shmReader->active();
+            if (has_new_data) {
+                // A replay is where the log is; a live stream carries no timestamps, so it is when its frames arrived
+                auto now = std::chrono::steady_clock::now();
+                if (!remoteStarted) remoteStart = now;
+                remoteStarted = true;
+                sourceAudio.front().time = replayer ? replayer->position()
+                                                    : std::chrono::duration<double>(now - remoteStart).count();
+            }
+            // Captured buffers go into the history on the capture thread; received ones only arrive here
+            if (has_new_data && audio_stream_active) {
+                for (int i = 0; i < BUFFER_FRAMES; ++i) {
+                    remoteInterleaved[2 * i] = left[i];
+                    remoteInterleaved[2 * i + 1] = right[i];
+                }
+                remoteHistory.append(remoteInterleaved, ChannelMap::standard(2), streamFrame.sampleRate,
+                                     sourceAudio.front().time);
+                sourceAudio.front().historyIndex = static_cast<int64_t>(remoteHistory.end()) - 1;
+            } else {
+                sourceAudio.front().historyIndex = -1;
+            }
+            if (has_new_data && audio_stream_active && measureFirstSource) measureFirstSource(channels, left, right);
+        } else {
+            CaptureSource& source = captureSources.front();
+            audio_stream_active = source.active.load();
+            global_sample_rate.store(source.sampleRate.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            // Capture runs ahead of any frame rate: everything pending is read, the terminal
+            // measures each buffer, and the newest is what gets drawn, published or encoded
+            has_new_data = false;
+            while (source.ring.read(channels, &sequence)) {
+                has_new_data = true;
+                downmixStereo(channels, left, right);
+                if (audio_stream_active && measureFirstSource) measureFirstSource(channels, left, right);
+            }
+            sourceAudio.front().historyIndex = has_new_data ? static_cast<int64_t>(sequence) : -1;
+            if (has_new_data) sourceAudio.front().time = bufferTime(sequence, global_sample_rate.load(std::memory_order_relaxed));
+        }
+
+        // Nothing new keeps the last buffer; only a silent source reads as zeros
+        if (!audio_stream_active) {
+            std::fill(left, left + BUFFER_FRAMES, 0);
+            std::fill(right, right + BUFFER_FRAMES, 0);
+            channels.clear();
+        }
+
+        // Published before any frame skipping, so viewers get every frame even when our terminal lags.
+        // A tick that found nothing new publishes nothing rather than a frame of silence.
+        if (!remote && (publisher || shmPublisher || analysisRecorder) && (has_new_data || !audio_stream_active)) {
+            analyzeAudio(left, right, global_sample_rate.load(std::memory_order_relaxed),
+                         audio_stream_active, streamFrame);
+            if (publisher) publisher->publish(streamFrame);
+            if (shmPublisher) shmPublisher->publish(streamFrame);
+            if (analysisRecorder) analysisRecorder->append(streamFrame);
+        }
+        return has_new_data;
+    };
+
+    // Raw output never initializes the terminal
+    if (options.raw) {
+        int rc = runRawOutput(options.rawOptions, readAudio, running);
+        stopAudioCapture(audioThread);
+        return rc;
+    }
+
+    // The daemon only captures and publishes; every viewer renders its own mode and size
+    if (options.daemon) {
+        int16_t left[BUFFER_FRAMES] = {0};
+        int16_t right[BUFFER_FRAMES] = {0};
+        FrameClock clock(CatchUpPolicy::SKIP);
+        clock.setPeriod(std::chrono::nanoseconds(1000000000LL / options.fps));
+        while (running) {
+            readAudio(left, right);
+            clock.scheduleNextFrame();
+            while (running && clock.wait(nullptr, 0) != FrameClock::FRAME_DUE) {}
+        }
+        stopAudioCapture(audioThread);
+        return 0;
+    }
+
+    // Everything else is the interactive terminal
+    TerminalSetup setup;
+    setup.options = &options;
+    setup.config = activeConfig;
+    setup.configPath = full_path;
+    setup.configError = config_error;
+    setup.sourceAudio = &sourceAudio;
+    for (int i = 0; i < source_count; ++i) {
+        setup.histories.push_back(&historyOf(i));
+        setup.labels.push_back(remote ? remoteLabel : captureSources[i].label);
+    }
+    setup.readAudio = readAudio;
+    setup.publisher = publisher.get();
+    setup.receiver = receiver.get();
+    setup.replayer = replayer.get();
+    setup.control = control.get();
+    setup.audioThread = &audioThread;
+    TerminalApp terminal(setup);
+    measureFirstSource = [&](const ChannelBuffers& channels, const int16_t* left, const int16_t* right) {
+        terminal.measure(0, channels, left, right, global_sample_rate.load(std::memory_order_relaxed), true);
+    };
+    return terminal.run();
 }
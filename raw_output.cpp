@@ -0,0 +1,178 @@
+#include "raw_output.h"
+#include "frame_clock.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+const float RISE_FACTOR = 0.6f;   // Same response as the bar graph mode
+const float HEIGHT_SCALE = 1.5f;
+const std::chrono::seconds REOPEN_DELAY(1);
+
+/**
+ * @brief Where the encoded frames go: stdout, a FIFO or a plain file.
+ */
+class RawTarget {
+public:
+    explicit RawTarget(const std::string& path) : path(path) {}
+    ~RawTarget() {
+        if (fd >= 0 && path != "-") close(fd);
+    }
+
+    // Opens the target; false only for errors worth giving up on.
+    bool open(std::string& error) {
+        if (path == "-") {
+            fd = STDOUT_FILENO;
+            return true;
+        }
+        struct stat st;
+        is_fifo = stat(path.c_str(), &st) == 0 && S_ISFIFO(st.st_mode);
+        if (is_fifo) {
+            reopen();
+            return true;
+        }
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0) {
+            error = "Cannot open raw output '" + path + "': " + std::strerror(errno);
+            return false;
+        }
+        return true;
+    }
+
+    // Writes one frame. Returns false once the output is gone for good.
+    bool write(const std::string& frame, bool& written) {
+        written = false;
+        if (fd < 0) return true;
+        // Frames are below PIPE_BUF, so a pipe takes each one whole or not at all
+        ssize_t n;
+        do {
+            n = ::write(fd, frame.data(), frame.size());
+        } while (n < 0 && errno == EINTR);
+        if (n >= 0) {
+            written = true;
+            return true;
+        }
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;  // Slow reader: drop this frame
+        if (!is_fifo) return false;
+        // The reader went away; wait for the next one
+        close(fd);
+        fd = -1;
+        next_open = std::chrono::steady_clock::now() + REOPEN_DELAY;
+        return true;
+    }
+
+    // Retries a FIFO that has no reader. True once per new reader, which has
+    // to get the current frame even if it did not change.
+    bool reconnected() {
+        if (fd < 0 && is_fifo && std::chrono::steady_clock::now() >= next_open) reopen();
+        bool result = just_opened;
+        just_opened = false;
+        return result;
+    }
+
+private:
+    std::string path;
+    int fd = -1;
+    bool is_fifo = false;
+    bool just_opened = false;
+    std::chrono::steady_clock::time_point next_open;
+
+    void reopen() {
+        // Without a reader this fails with ENXIO instead of blocking
+        fd = ::open(path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+        if (fd >= 0) just_opened = true;
+        else next_open = std::chrono::steady_clock::now() + REOPEN_DELAY;
+    }
+};
+
+void appendNumber(std::string& out, uint32_t value) {
+    char digits[12];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+} // namespace
+
+RawBarEncoder::RawBarEncoder(int bars, int bits, RawFormat format)
+: bits(bits), format(format), heights(bars, 0.0f) {
+    output.reserve(bars * 6 + 1);
+}
+
+/**
+ * @brief Computes the bar heights and encodes them.
+ */
+const std::string& RawBarEncoder::encode(const int16_t* leftData, const int16_t* rightData) {
+    const int bars = static_cast<int>(heights.size());
+    const uint32_t max_value = (1u << bits) - 1;
+    output.clear();
+    for (int bar = 0; bar < bars; ++bar) {
+        int start_idx = bar * BUFFER_FRAMES / bars;
+        int end_idx = (bar + 1) * BUFFER_FRAMES / bars;
+        float sum_sq = 0.0f;
+        for (int i = start_idx; i < end_idx; ++i) {
+            float left = leftData[i] / 32768.0f;
+            float right = rightData[i] / 32768.0f;
+            sum_sq += left * left + right * right;
+        }
+        int count = 2 * (end_idx - start_idx);
+        float rms = count > 0 ? std::sqrt(sum_sq / count) : 0.0f;
+
+        float& height = heights[bar];
+        if (rms > height) height += (rms - height) * RISE_FACTOR;
+        else height = std::max(0.0f, height - decay__factor);
+
+        uint32_t value = static_cast<uint32_t>(std::lround(std::min(1.0f, height * HEIGHT_SCALE) * max_value));
+        if (format == RawFormat::ASCII) {
+            appendNumber(output, value);
+            output.push_back(';');
+        } else {
+            output.push_back(static_cast<char>(value & 0xff));
+            if (bits == 16) output.push_back(static_cast<char>(value >> 8));
+        }
+    }
+    if (format == RawFormat::ASCII) output.push_back('\n');
+    return output;
+}
+
+int runRawOutput(const RawOutputOptions& options, const std::function<bool(int16_t*, int16_t*)>& readAudio,
+                 const std::atomic<bool>& running) {
+    // A vanished FIFO reader must show up as EPIPE, not kill us
+    signal(SIGPIPE, SIG_IGN);
+    RawTarget target(options.target);
+    std::string error;
+    if (!target.open(error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+
+    RawBarEncoder encoder(options.bars, options.bits, options.format);
+    std::string last_written;
+    int16_t leftAudio[BUFFER_FRAMES] = {0};
+    int16_t rightAudio[BUFFER_FRAMES] = {0};
+    FrameClock clock(CatchUpPolicy::SKIP);
+    clock.setPeriod(std::chrono::nanoseconds(1000000000LL / options.fps));
+
+    while (running) {
+        readAudio(leftAudio, rightAudio);
+        const std::string& frame = encoder.encode(leftAudio, rightAudio);
+        if (target.reconnected()) last_written.clear();
+        if (frame != last_written) {
+            bool written;
+            if (!target.write(frame, written)) return 0;  // stdout or file closed: we are done
+            if (written) last_written = frame;
+        }
+
+        clock.scheduleNextFrame();
+        while (running && clock.wait(nullptr, 0) != FrameClock::FRAME_DUE) {}
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+#ifndef RAW_OUTPUT_H
+#define RAW_OUTPUT_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "config_parser.h"
+
+enum class RawFormat {
+    ASCII,  // Decimal values, each followed by ';', one line per frame (as cava's raw output)
+    BINARY  // Little-endian u8 or u16 per bar, no delimiters
+};
+
+/**
+ * @brief Settings of the raw bar output, taken from the command line.
+ */
+struct RawOutputOptions {
+    std::string target = "-";  // "-" for stdout, otherwise a FIFO or file path
+    RawFormat format = RawFormat::ASCII;
+    int bars = DEFAULT_BAR_COUNT;
+    int bits = 16;             // 8 or 16: values run from 0 to 2^bits - 1
+    int fps = 60;
+};
+
+/**
+ * @brief Turns audio buffers into encoded bar values.
+ *
+ * Bars are computed like the bar graph mode (RMS of equal slices of the
+ * buffer, fast rise and `decay__factor` fall, scaled by 1.5), with both
+ * channels taken together. Values are encoded into a buffer that is reused
+ * from frame to frame.
+ */
+class RawBarEncoder {
+public:
+    RawBarEncoder(int bars, int bits, RawFormat format);
+
+    // Updates the bars from one buffer and returns their encoding.
+    const std::string& encode(const int16_t* leftData, const int16_t* rightData);
+
+private:
+    int bits;
+    RawFormat format;
+    std::vector<float> heights;
+    std::string output;
+};
+
+/**
+ * @brief Runs the raw output loop without ever touching the terminal.
+ *
+ * `readAudio` fills both buffers once per frame with the newest buffer
+ * captured, leaves them as they were when nothing new arrived, and zeros
+ * them when there is no audio. Each frame is written with a single write() and only when its
+ * bytes differ from the last frame written, so a silent or steady signal
+ * costs no syscalls at all. A FIFO is opened non-blocking: until a reader
+ * shows up, or while it is too slow, frames are dropped rather than
+ * stalling. Returns the process exit code.
+ */
+int runRawOutput(const RawOutputOptions& options, const std::function<bool(int16_t*, int16_t*)>& readAudio,
+                 const std::atomic<bool>& running);
+
+#endif // RAW_OUTPUT_H
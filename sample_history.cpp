@@ -0,0 +1,82 @@
+#include "sample_history.h"
+#include <sys/mman.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+SampleHistory::~SampleHistory() {
+    if (slots) munmap(slots, mapped_bytes);
+}
+
+bool SampleHistory::allocate(int seconds, int channels, std::string& error) {
+    if (seconds <= 0) return true;
+    max_channels = std::max(1, std::min(MAX_CHANNELS, channels));
+    // Slots stay cache-line aligned so neighbouring buffers never share a line
+    slot_bytes = (sizeof(SlotHeader) + sizeof(int16_t) * BUFFER_FRAMES * max_channels + 63) / 64 * 64;
+    capacity = (static_cast<uint64_t>(seconds) * SIZING_RATE + BUFFER_FRAMES - 1) / BUFFER_FRAMES;
+    mapped_bytes = slot_bytes * capacity;
+    // Not populated: pages are committed as the first lap of appends reaches them
+    void* mapping = mmap(nullptr, mapped_bytes, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED) {
+        error = "Cannot map " + std::to_string(mapped_bytes >> 20) + " MB of history: " + std::strerror(errno);
+        mapped_bytes = 0;
+        capacity = 0;
+        return false;
+    }
+    slots = static_cast<char*>(mapping);
+    drawn.assign(capacity, UINT64_MAX);
+    return true;
+}
+
+void SampleHistory::append(const int16_t* interleaved, const ChannelMap& map, uint32_t sampleRate, double time) {
+    if (!slots) return;
+    const uint64_t index = next_buffer.load(std::memory_order_relaxed);
+    // Readers check this after copying, so they see any slot we are about to reuse
+    writing.store(index, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    char* slot = slots + (index % capacity) * slot_bytes;
+    SlotHeader* header = reinterpret_cast<SlotHeader*>(slot);
+    header->map = map;
+    header->sampleRate = sampleRate;
+    header->time = time;
+    int16_t* samples = reinterpret_cast<int16_t*>(slot + sizeof(SlotHeader));
+    if (map.channels <= max_channels) {
+        std::memcpy(samples, interleaved, sizeof(int16_t) * BUFFER_FRAMES * map.channels);
+    } else {
+        header->map.channels = max_channels;
+        for (int i = 0; i < BUFFER_FRAMES; ++i) {
+            std::memcpy(samples + i * max_channels, interleaved + i * map.channels, sizeof(int16_t) * max_channels);
+        }
+    }
+    next_buffer.store(index + 1, std::memory_order_release);
+}
+
+uint64_t SampleHistory::begin() const {
+    uint64_t newest_end = end();
+    // The slot after the newest may already be being overwritten
+    return newest_end + 1 > capacity ? newest_end + 1 - capacity : 0;
+}
+
+bool SampleHistory::read(uint64_t index, ChannelBuffers& out, uint32_t& sampleRate, double* time) const {
+    if (!slots || index >= end() || index < begin()) return false;
+    const char* slot = slots + (index % capacity) * slot_bytes;
+    const SlotHeader* header = reinterpret_cast<const SlotHeader*>(slot);
+    out.map = header->map;
+    out.map.channels = std::max(1, std::min(max_channels, out.map.channels));
+    sampleRate = header->sampleRate;
+    if (time) *time = header->time;
+    deinterleave(reinterpret_cast<const int16_t*>(slot + sizeof(SlotHeader)), out);
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return writing.load(std::memory_order_relaxed) < index + capacity;
+}
+
+void SampleHistory::markDrawn(uint64_t index) {
+    if (slots) drawn[index % capacity] = index;
+}
+
+bool SampleHistory::wasDrawn(uint64_t index) const {
+    return slots && drawn[index % capacity] == index;
+}
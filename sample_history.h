@@ -0,0 +1,71 @@
+#ifndef SAMPLE_HISTORY_H
+#define SAMPLE_HISTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "channel_ring.h"
+
+/**
+ * @brief The last few seconds of one capture source, for freezing and scrubbing.
+ *
+ * A ring of every captured buffer (interleaved, with its channel map,
+ * sample rate and media time) in one anonymous mapping. Its pages are faulted in by the
+ * first lap of appends, one zeroed page every buffer or so, rather than
+ * all up front: a long history of many 7.1 sources runs to gigabytes.
+ * Buffers are numbered from 0 as they arrive. One thread appends and any
+ * thread reads: a read copies the buffer out and then checks that the
+ * writer has not started to reuse its slot, so a reader never needs a
+ * lock and never holds up the capture. The render thread also notes
+ * which buffers it drew, so a frozen frame is rebuilt the way it was
+ * drawn live.
+ */
+class SampleHistory {
+public:
+    // Sized for this rate; a faster source gets correspondingly fewer seconds
+    static const uint32_t SIZING_RATE = 48000;
+
+    SampleHistory() = default;
+    ~SampleHistory();
+    SampleHistory(const SampleHistory&) = delete;
+    SampleHistory& operator=(const SampleHistory&) = delete;
+
+    // Maps room for `seconds` of up to `channels` channels; 0 seconds leaves it disabled
+    bool allocate(int seconds, int channels, std::string& error);
+    bool enabled() const { return slots != nullptr; }
+
+    // Stores BUFFER_FRAMES interleaved frames that play at `time` seconds; channels beyond the allocated count are dropped
+    void append(const int16_t* interleaved, const ChannelMap& map, uint32_t sampleRate, double time);
+
+    // Number of buffers appended so far, i.e. one past the newest
+    uint64_t end() const { return next_buffer.load(std::memory_order_acquire); }
+    // The oldest buffer still held
+    uint64_t begin() const;
+
+    // Deinterleaves buffer `index`, and gives its time; false when it is not held (any more)
+    bool read(uint64_t index, ChannelBuffers& out, uint32_t& sampleRate, double* time = nullptr) const;
+
+    // Render thread only: buffer `index` was drawn, and whether a held buffer was
+    void markDrawn(uint64_t index);
+    bool wasDrawn(uint64_t index) const;
+
+private:
+    struct SlotHeader {
+        ChannelMap map;
+        uint32_t sampleRate;
+        double time;
+    };
+
+    char* slots = nullptr;
+    size_t mapped_bytes = 0;
+    size_t slot_bytes = 0;
+    uint64_t capacity = 0;
+    int max_channels = 0;
+    std::atomic<uint64_t> next_buffer{0};
+    std::atomic<uint64_t> writing{0};  // Index of the buffer being (or last) written
+    std::vector<uint64_t> drawn;        // Per slot, the index of the last buffer drawn from it
+};
+
+#endif // SAMPLE_HISTORY_H
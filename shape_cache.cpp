@@ -0,0 +1,276 @@
+#include "shape_cache.h"
+#include "mapped_file.h"
+#include <sys/stat.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <climits>
+#include <cstring>
+
+namespace {
+const char CACHE_MAGIC[8] = {'M', 'A', 'L', 'S', 'H', 'A', 'P', 'E'};
+const uint32_t CACHE_VERSION = 4;
+const char* CACHE_PREFIX = "shapes-";
+const char* CACHE_SUFFIX = ".bin";
+
+// Fixed-size file header. Every field is checked before the body is trusted.
+struct CacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t rayCount;        // DISTORT_RAY_COUNT the ray tables were built for
+    uint64_t contentHash;     // Hash of the config text the shapes came from
+    uint32_t visualizerCount;
+    uint32_t dependencyCount; // Imported files, each stored as path, size and mtime
+};
+
+// Size and modification time identify a dependency's version well enough
+bool statFile(const std::string& path, int64_t& size, int64_t& mtime_ns) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) return false;
+    size = st.st_size;
+    mtime_ns = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    return true;
+}
+
+void putU32(std::vector<char>& out, uint32_t value) {
+    const char* bytes = reinterpret_cast<const char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(value));
+}
+
+void putFloats(std::vector<char>& out, const float* values, size_t count) {
+    const char* bytes = reinterpret_cast<const char*>(values);
+    out.insert(out.end(), bytes, bytes + count * sizeof(float));
+}
+
+/**
+ * @brief Bounds-checked reader over the mapped cache file.
+ */
+struct Reader {
+    const char* pos;
+    const char* end;
+
+    bool read(void* dest, size_t bytes) {
+        if (static_cast<size_t>(end - pos) < bytes) return false;
+        memcpy(dest, pos, bytes);
+        pos += bytes;
+        return true;
+    }
+    bool readU32(uint32_t& value) { return read(&value, sizeof(value)); }
+    // Whether `count` items of at least `bytes` each can still be in the file;
+    // checked before anything is sized by a count, so a damaged file cannot ask for gigabytes
+    bool fits(uint64_t count, size_t bytes) const { return count <= static_cast<uint64_t>(end - pos) / bytes; }
+};
+
+// Smallest encoded sizes, for Reader::fits()
+const size_t MIN_DEPENDENCY_BYTES = sizeof(uint32_t) + 2 * sizeof(int64_t);
+const size_t MIN_VISUALIZER_BYTES = 7 * sizeof(uint32_t) + EXPR_SLOT_COUNT * sizeof(uint32_t);
+const size_t MIN_POLYGON_BYTES = sizeof(uint32_t);
+const size_t POINT_BYTES = 2 * sizeof(float);
+
+bool makeDirectories(const std::string& path) {
+    for (size_t pos = 1; pos != std::string::npos; ) {
+        pos = path.find('/', pos + 1);
+        std::string partial = path.substr(0, pos);
+        if (mkdir(partial.c_str(), 0755) < 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+}
+
+ShapeCache::ShapeCache() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (xdg && *xdg) directory = std::string(xdg) + "/mallard";
+    else if (home) directory = std::string(home) + "/.cache/mallard";
+}
+
+ShapeCache::ShapeCache(const std::string& directory)
+: directory(directory) {}
+
+uint64_t ShapeCache::hashContent(const char* data, size_t size) {
+    // 64-bit FNV-1a
+    uint64_t hash = 1469598103934665603ULL;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+std::string ShapeCache::prefixFor(const std::string& configPath) const {
+    // One config reached by different paths is still one config
+    char resolved[PATH_MAX];
+    std::string key = realpath(configPath.c_str(), resolved) ? resolved : configPath;
+    char name[64];
+    snprintf(name, sizeof(name), "%s%016llx-", CACHE_PREFIX,
+             static_cast<unsigned long long>(hashContent(key.data(), key.size())));
+    return name;
+}
+
+std::string ShapeCache::pathFor(const std::string& configPath, uint64_t contentHash) const {
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(contentHash));
+    return directory + "/" + prefixFor(configPath) + hash + CACHE_SUFFIX;
+}
+
+bool ShapeCache::lookup(const std::string& configPath, uint64_t contentHash, std::vector<CustomVisualizer>& out,
+                        std::vector<std::string>& dependencies) const {
+    if (directory.empty()) return false;
+    MappedFile file(pathFor(configPath, contentHash));
+    if (!file.ok || !file.data) return false;
+
+    Reader reader{file.data, file.data + file.size};
+    CacheHeader header;
+    if (!reader.read(&header, sizeof(header))) return false;
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION ||
+        header.rayCount != DISTORT_RAY_COUNT || header.contentHash != contentHash) {
+        return false; // Stale or foreign file: the caller parses the text instead
+    }
+
+    if (!reader.fits(header.dependencyCount, MIN_DEPENDENCY_BYTES)) return false;
+    std::vector<std::string> files(header.dependencyCount);
+    for (auto& path : files) {
+        uint32_t path_len;
+        int64_t size, mtime_ns, current_size, current_mtime_ns;
+        if (!reader.readU32(path_len) || static_cast<size_t>(reader.end - reader.pos) < path_len) return false;
+        path.assign(reader.pos, path_len);
+        reader.pos += path_len;
+        if (!reader.read(&size, sizeof(size)) || !reader.read(&mtime_ns, sizeof(mtime_ns))) return false;
+        if (!statFile(path, current_size, current_mtime_ns) || current_size != size || current_mtime_ns != mtime_ns) {
+            return false; // An imported file changed since the shapes were compiled
+        }
+    }
+
+    if (!reader.fits(header.visualizerCount, MIN_VISUALIZER_BYTES)) return false;
+    std::vector<CustomVisualizer> visualizers(header.visualizerCount);
+    for (auto& viz : visualizers) {
+        uint32_t name_len, type, polygon_count, ray_count;
+        if (!reader.readU32(name_len) || !reader.readU32(type) ||
+            !reader.readU32(polygon_count) || !reader.readU32(ray_count)) return false;
+        if (type > static_cast<uint32_t>(ShapeVisualizerType::EXPRESSION)) return false;
+        uint32_t num_points, smoothing_passes, points_per_side;
+        if (!reader.readU32(num_points) || !reader.readU32(smoothing_passes) || !reader.readU32(points_per_side)) return false;
+        if (ray_count != 0 && ray_count != num_points) return false;
+        // The same limits the text parser enforces
+        if (num_points < static_cast<uint32_t>(MIN_RADIAL_POINTS) || num_points > static_cast<uint32_t>(MAX_RADIAL_POINTS) ||
+            smoothing_passes > static_cast<uint32_t>(MAX_SMOOTHING_PASSES) ||
+            points_per_side < static_cast<uint32_t>(MIN_POINTS_PER_SIDE) ||
+            points_per_side > static_cast<uint32_t>(MAX_POINTS_PER_SIDE)) {
+            return false;
+        }
+        viz.numPoints = num_points;
+        viz.smoothingPasses = smoothing_passes;
+        viz.pointsPerVertexSide = points_per_side;
+        if (static_cast<size_t>(reader.end - reader.pos) < name_len) return false;
+        viz.name.assign(reader.pos, name_len);
+        reader.pos += name_len;
+        viz.type = static_cast<ShapeVisualizerType>(type);
+
+        if (!reader.fits(polygon_count, MIN_POLYGON_BYTES)) return false;
+        viz.polygons.resize(polygon_count);
+        for (auto& polygon : viz.polygons) {
+            uint32_t point_count;
+            if (!reader.readU32(point_count) || !reader.fits(point_count, POINT_BYTES)) return false;
+            polygon.resize(point_count);
+            for (auto& point : polygon) {
+                reader.read(&point.first, sizeof(float));
+                reader.read(&point.second, sizeof(float));
+            }
+        }
+        if (!reader.fits(ray_count, sizeof(float))) return false;
+        viz.rayDistances.resize(ray_count);
+        if (ray_count && !reader.read(viz.rayDistances.data(), ray_count * sizeof(float))) return false;
+        // Formulas are stored as text; prepareCustomVisualizer() compiles them
+        for (auto& formula : viz.expressions) {
+            uint32_t formula_len;
+            if (!reader.readU32(formula_len) || static_cast<size_t>(reader.end - reader.pos) < formula_len) return false;
+            formula.assign(reader.pos, formula_len);
+            reader.pos += formula_len;
+        }
+    }
+    out = std::move(visualizers);
+    dependencies = std::move(files);
+    return true;
+}
+
+bool ShapeCache::store(const std::string& configPath, uint64_t contentHash,
+                       const std::vector<CustomVisualizer>& visualizers,
+                       const std::vector<std::string>& dependencies) const {
+    if (directory.empty() || !makeDirectories(directory)) return false;
+
+    std::vector<char> out;
+    CacheHeader header = {};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.rayCount = DISTORT_RAY_COUNT;
+    header.contentHash = contentHash;
+    header.visualizerCount = visualizers.size();
+    header.dependencyCount = dependencies.size();
+    const char* header_bytes = reinterpret_cast<const char*>(&header);
+    out.insert(out.end(), header_bytes, header_bytes + sizeof(header));
+
+    for (const auto& path : dependencies) {
+        int64_t size, mtime_ns;
+        if (!statFile(path, size, mtime_ns)) return false;
+        putU32(out, path.size());
+        out.insert(out.end(), path.begin(), path.end());
+        const char* stamp = reinterpret_cast<const char*>(&size);
+        out.insert(out.end(), stamp, stamp + sizeof(size));
+        stamp = reinterpret_cast<const char*>(&mtime_ns);
+        out.insert(out.end(), stamp, stamp + sizeof(mtime_ns));
+    }
+
+    for (const auto& viz : visualizers) {
+        putU32(out, viz.name.size());
+        putU32(out, static_cast<uint32_t>(viz.type));
+        putU32(out, viz.polygons.size());
+        putU32(out, viz.rayDistances.size());
+        putU32(out, viz.numPoints);
+        putU32(out, viz.smoothingPasses);
+        putU32(out, viz.pointsPerVertexSide);
+        out.insert(out.end(), viz.name.begin(), viz.name.end());
+        for (const auto& polygon : viz.polygons) {
+            putU32(out, polygon.size());
+            for (const auto& point : polygon) {
+                putFloats(out, &point.first, 1);
+                putFloats(out, &point.second, 1);
+            }
+        }
+        putFloats(out, viz.rayDistances.data(), viz.rayDistances.size());
+        for (const auto& formula : viz.expressions) {
+            putU32(out, formula.size());
+            out.insert(out.end(), formula.begin(), formula.end());
+        }
+    }
+
+    // Write to a temporary name first so readers never see a partial file
+    std::string path = pathFor(configPath, contentHash);
+    std::string tmp_path = path + ".tmp";
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(out.data(), 1, out.size(), file) == out.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) < 0) {
+        unlink(tmp_path.c_str());
+        return false;
+    }
+
+    // Older versions of this config's shapes are not needed again. Other configs'
+    // are left alone: another instance may be running with one of them.
+    std::string keep = path.substr(directory.size() + 1);
+    std::string prefix = prefixFor(configPath);
+    if (DIR* dir = opendir(directory.c_str())) {
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name != keep && name.rfind(prefix, 0) == 0 &&
+                name.size() > strlen(CACHE_SUFFIX) &&
+                name.compare(name.size() - strlen(CACHE_SUFFIX), std::string::npos, CACHE_SUFFIX) == 0) {
+                unlink((directory + "/" + name).c_str());
+            }
+        }
+        closedir(dir);
+    }
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef SHAPE_CACHE_H
+#define SHAPE_CACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config_parser.h"
+
+/**
+ * @brief On-disk cache of compiled custom visualizers.
+ *
+ * Large configs spend most of their load time converting `point = x,y` lines
+ * and casting DISTORT rays. After a successful load the prepared shapes
+ * (flattened, simplified polygons plus ray tables) are written to a versioned
+ * binary file named after the config's path and content hash. The next start
+ * maps that file and skips both steps; any mismatch, or a file that is
+ * damaged, falls back to text parsing.
+ *
+ * Files the shapes were imported from (SVGs) are recorded with their size and
+ * modification time, so editing one invalidates the cache even though the
+ * config text is unchanged.
+ */
+class ShapeCache {
+public:
+    // Uses $XDG_CACHE_HOME/mallard, or ~/.cache/mallard if that is unset.
+    ShapeCache();
+    explicit ShapeCache(const std::string& directory);
+
+    // Fills `out` with the shapes compiled from the config at `configPath` with this
+    // content hash, and `dependencies` with the files they were imported from.
+    bool lookup(const std::string& configPath, uint64_t contentHash, std::vector<CustomVisualizer>& out,
+                std::vector<std::string>& dependencies) const;
+
+    // Writes the prepared shapes and removes the cache files of earlier versions of
+    // the same config; other configs' files stay.
+    bool store(const std::string& configPath, uint64_t contentHash, const std::vector<CustomVisualizer>& visualizers,
+               const std::vector<std::string>& dependencies) const;
+
+    static uint64_t hashContent(const char* data, size_t size);
+
+private:
+    std::string directory;
+    std::string prefixFor(const std::string& configPath) const;
+    std::string pathFor(const std::string& configPath, uint64_t contentHash) const;
+};
+
+#endif // SHAPE_CACHE_H
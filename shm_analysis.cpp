@@ -0,0 +1,195 @@
+#include "shm_analysis.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <ctime>
+
+static_assert(ANALYSIS_BANDS == MALLARD_SHM_BANDS, "mallard_shm.h band count is out of date");
+static_assert(WAVEFORM_POINTS == MALLARD_SHM_WAVEFORM_POINTS, "mallard_shm.h waveform size is out of date");
+
+namespace {
+
+const std::chrono::seconds REATTACH_DELAY(1);
+const uint64_t STALE_NS = 1000000000;
+
+uint64_t monotonicNs() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+bool producerAlive(uint32_t pid) {
+    return pid != 0 && (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM);
+}
+
+} // namespace
+
+bool parseShmUrl(const std::string& url, std::string& name) {
+    const std::string scheme = "shm://";
+    if (url.compare(0, scheme.size(), scheme) != 0) return false;
+    std::string rest = url.substr(scheme.size());
+    name = rest.empty() ? MALLARD_SHM_DEFAULT_NAME : "/" + rest;
+    return true;
+}
+
+// --- Publisher ---
+
+ShmPublisher::~ShmPublisher() {
+    if (!shm) return;
+    // Leave a final silent frame so readers stop drawing the last one we published
+    AnalysisFrame silence;
+    publish(silence);
+    __atomic_store_n(&shm->producer_pid, 0u, __ATOMIC_RELEASE);
+    munmap(shm, sizeof(mallard_shm));
+}
+
+bool ShmPublisher::open(const std::string& name, std::string& error) {
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        error = "Cannot open shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    bool sized = fstat(fd, &st) == 0 &&
+                 (st.st_size >= static_cast<off_t>(sizeof(mallard_shm)) || ftruncate(fd, sizeof(mallard_shm)) == 0);
+    void* mapping = sized ? mmap(nullptr, sizeof(mallard_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "Cannot map shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    mallard_shm* region = static_cast<mallard_shm*>(mapping);
+
+    if (region->magic == MALLARD_SHM_MAGIC && region->producer_pid != static_cast<uint32_t>(getpid()) &&
+        producerAlive(region->producer_pid)) {
+        error = "Shared memory " + name + " is already published by process " + std::to_string(region->producer_pid);
+        munmap(mapping, sizeof(mallard_shm));
+        return false;
+    }
+
+    // Readers may still hold the region from an earlier producer: keep the
+    // seqlock counter moving forward and mark the frame as being written
+    // while the header is rewritten.
+    uint32_t sequence = region->magic == MALLARD_SHM_MAGIC ? (region->sequence | 1u) : 1u;
+    __atomic_store_n(&region->sequence, sequence, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    region->version = MALLARD_SHM_VERSION;
+    region->header_size = offsetof(mallard_shm, frame);
+    region->frame_size = sizeof(mallard_shm_frame);
+    region->bands = MALLARD_SHM_BANDS;
+    region->waveform_points = MALLARD_SHM_WAVEFORM_POINTS;
+    region->producer_pid = static_cast<uint32_t>(getpid());
+    frame_number = region->magic == MALLARD_SHM_MAGIC ? region->frame.frame_number : 0;
+    std::memset(&region->frame, 0, sizeof(region->frame));
+    region->frame.frame_number = frame_number;
+    region->magic = MALLARD_SHM_MAGIC;
+    __atomic_store_n(&region->sequence, sequence + 1, __ATOMIC_RELEASE);
+    shm = region;
+    return true;
+}
+
+/**
+ * @brief Writes one frame under the seqlock.
+ */
+void ShmPublisher::publish(const AnalysisFrame& frame) {
+    if (!shm) return;
+    uint32_t sequence = __atomic_load_n(&shm->sequence, __ATOMIC_RELAXED);
+    __atomic_store_n(&shm->sequence, sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    mallard_shm_frame& out = shm->frame;
+    out.frame_number = ++frame_number;
+    out.timestamp_ns = monotonicNs();
+    out.sample_rate = frame.sampleRate;
+    out.audio_active = frame.audioActive ? 1 : 0;
+    std::memcpy(out.rms, frame.rms, sizeof(out.rms));
+    std::memcpy(out.peak, frame.peak, sizeof(out.peak));
+    std::memcpy(out.bands, frame.bands, sizeof(out.bands));
+    std::memcpy(out.waveform, frame.waveform, sizeof(out.waveform));
+
+    __atomic_store_n(&shm->sequence, sequence + 2, __ATOMIC_RELEASE);
+}
+
+// --- Reader ---
+
+ShmReader::~ShmReader() {
+    if (shm) munmap(const_cast<mallard_shm*>(shm), sizeof(mallard_shm));
+}
+
+bool ShmReader::open(const std::string& regionName, std::string& error) {
+    name = regionName;
+    std::string attach_error;
+    // A missing region is fine, the producer may start later; a wrong one is not
+    if (!attach(attach_error) && errno != ENOENT) {
+        error = attach_error;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Maps the region and checks that its layout is one we can read.
+ */
+bool ShmReader::attach(std::string& error) {
+    next_attempt = std::chrono::steady_clock::now() + REATTACH_DELAY;
+    int fd = shm_open(name.c_str(), O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        error = "Cannot open shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(mallard_shm))) {
+        close(fd);
+        errno = EINVAL;
+        error = "Shared memory " + name + " is too small to be an analysis region";
+        return false;
+    }
+    void* mapping = mmap(nullptr, sizeof(mallard_shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = "Cannot map shared memory " + name + ": " + std::strerror(errno);
+        return false;
+    }
+    const mallard_shm* region = static_cast<const mallard_shm*>(mapping);
+    if (region->magic != MALLARD_SHM_MAGIC || region->version < MALLARD_SHM_VERSION ||
+        region->header_size != offsetof(mallard_shm, frame) || region->frame_size < sizeof(mallard_shm_frame) ||
+        region->bands != MALLARD_SHM_BANDS || region->waveform_points != MALLARD_SHM_WAVEFORM_POINTS) {
+        munmap(mapping, sizeof(mallard_shm));
+        errno = EINVAL;
+        error = "Shared memory " + name + " has an unknown layout";
+        return false;
+    }
+    shm = region;
+    return true;
+}
+
+bool ShmReader::receive(AnalysisFrame& frame) {
+    if (!shm) {
+        std::string error;
+        if (std::chrono::steady_clock::now() < next_attempt || !attach(error)) return false;
+    }
+    mallard_shm_frame copy;
+    if (!mallard_shm_read(shm, &copy) || (have_frame && copy.frame_number == last_frame_number)) return false;
+    latest = copy;
+    last_frame_number = copy.frame_number;
+    have_frame = true;
+
+    frame.sampleRate = copy.sample_rate;
+    frame.audioActive = copy.audio_active != 0;
+    std::memcpy(frame.rms, copy.rms, sizeof(frame.rms));
+    std::memcpy(frame.peak, copy.peak, sizeof(frame.peak));
+    std::memcpy(frame.bands, copy.bands, sizeof(frame.bands));
+    std::memcpy(frame.waveform, copy.waveform, sizeof(frame.waveform));
+    return true;
+}
+
+bool ShmReader::active() const {
+    return shm && have_frame && latest.audio_active &&
+           __atomic_load_n(&shm->producer_pid, __ATOMIC_RELAXED) != 0 &&
+           monotonicNs() - latest.timestamp_ns < STALE_NS;
+}
@@ -0,0 +1,68 @@
+#ifndef SHM_ANALYSIS_H
+#define SHM_ANALYSIS_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include "analysis_frame.h"
+#include "mallard_shm.h"
+
+// "shm://name" selects the region /name; "shm://" the default one. Returns false for other schemes.
+bool parseShmUrl(const std::string& url, std::string& name);
+
+/**
+ * @brief Publishes every analysis frame into a POSIX shared-memory region.
+ *
+ * The layout is struct mallard_shm from mallard_shm.h, guarded by a seqlock:
+ * publishing is two counter stores around a plain copy, and readers never
+ * touch the region, so the cost does not depend on how many are polling.
+ */
+class ShmPublisher {
+public:
+    ShmPublisher() = default;
+    ~ShmPublisher();
+    ShmPublisher(const ShmPublisher&) = delete;
+    ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+    // Creates or takes over the region. Fails if another live process is publishing to it.
+    bool open(const std::string& name, std::string& error);
+    void publish(const AnalysisFrame& frame);
+
+private:
+    mallard_shm* shm = nullptr;
+    uint64_t frame_number = 0;
+};
+
+/**
+ * @brief Reads the published analysis, for running the visualizer as a pure consumer.
+ *
+ * Maps the region read-only. If no producer has created it yet, mapping is
+ * retried once a second.
+ */
+class ShmReader {
+public:
+    ShmReader() = default;
+    ~ShmReader();
+    ShmReader(const ShmReader&) = delete;
+    ShmReader& operator=(const ShmReader&) = delete;
+
+    bool open(const std::string& name, std::string& error);
+
+    // Returns true if `frame` was replaced by a newer frame.
+    bool receive(AnalysisFrame& frame);
+
+    // The producer is running, published within the last second, and has audio.
+    bool active() const;
+
+private:
+    std::string name;
+    const mallard_shm* shm = nullptr;
+    std::chrono::steady_clock::time_point next_attempt;
+    uint64_t last_frame_number = 0;
+    bool have_frame = false;
+    mallard_shm_frame latest{};
+
+    bool attach(std::string& error);
+};
+
+#endif // SHM_ANALYSIS_H
@@ -0,0 +1,173 @@
+#include "spectrogram.h"
+#include "channel_ring.h"
+#include "spectrum.h"
+#include "wav_file.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+const uint64_t TILE_ROWS = 256;
+// How far a thread may get ahead of the writer, in tiles per thread
+const uint64_t TILES_AHEAD_PER_JOB = 2;
+
+// Heat map from silence to full scale: black, navy, purple, orange, yellow, white
+const uint8_t PALETTE[][3] = {{0, 0, 0}, {0, 0, 128}, {128, 0, 160}, {230, 60, 30}, {255, 200, 0}, {255, 255, 255}};
+const int PALETTE_STOPS = sizeof(PALETTE) / sizeof(PALETTE[0]);
+
+void paletteColor(float t, uint8_t* rgb) {
+    float position = t * (PALETTE_STOPS - 1);
+    int stop = std::min(PALETTE_STOPS - 2, static_cast<int>(position));
+    float blend = position - stop;
+    for (int i = 0; i < 3; ++i) {
+        rgb[i] = static_cast<uint8_t>(std::lround(PALETTE[stop][i] + (PALETTE[stop + 1][i] - PALETTE[stop][i]) * blend));
+    }
+}
+
+/**
+ * @brief Computes rows of the image; one per worker thread, so its buffers are reused tile after tile.
+ */
+class TileRenderer {
+public:
+    TileRenderer(const WavFile& wav, const SpectrogramOptions& options)
+        : wav(wav), options(options), plan(FftPlan::forSize(options.fftSize)), power(plan.bins()) {}
+
+    // Fills `out` with the pixels of rows [first, last)
+    void render(uint64_t first, uint64_t last, std::vector<uint8_t>& out) {
+        const size_t width = options.fftSize / 2;
+        const size_t pixel_bytes = options.color ? 3 : 1;
+        // The rows of a tile overlap, so their samples are read once for all of them
+        readMono(first * options.hop, (last - first - 1) * options.hop + options.fftSize);
+        out.resize((last - first) * width * pixel_bytes);
+        uint8_t* pixel = out.data();
+        const float range = -options.floorDb;
+        for (uint64_t row = first; row < last; ++row) {
+            plan.powerSpectrum(&samples[(row - first) * options.hop], power.data(), scratch);
+            for (size_t bin = 0; bin < width; ++bin) {
+                float db = 10.0f * std::log10(power[bin] + 1e-20f);
+                float t = std::max(0.0f, std::min(1.0f, (db - options.floorDb) / range));
+                if (options.color) paletteColor(t, pixel);
+                else *pixel = static_cast<uint8_t>(std::lround(t * 255.0f));
+                pixel += pixel_bytes;
+            }
+        }
+    }
+
+private:
+    const WavFile& wav;
+    const SpectrogramOptions& options;
+    const FftPlan& plan;
+    std::vector<float> samples;
+    std::vector<float> power;
+    std::vector<std::complex<float>> scratch;
+    ChannelBuffers channels;
+    int16_t left[BUFFER_FRAMES];
+    int16_t right[BUFFER_FRAMES];
+
+    // The mono mix of frames [start, start + count), silent past the end
+    void readMono(uint64_t start, size_t count) {
+        samples.resize(count);
+        const uint64_t end = start + count;
+        for (uint64_t buffer = start / BUFFER_FRAMES; buffer * BUFFER_FRAMES < end; ++buffer) {
+            wav.readBuffer(buffer, channels);
+            downmixStereo(channels, left, right);
+            const uint64_t base = buffer * BUFFER_FRAMES;
+            const uint64_t from = std::max(start, base), to = std::min(end, base + BUFFER_FRAMES);
+            for (uint64_t i = from; i < to; ++i) {
+                samples[i - start] = (static_cast<float>(left[i - base]) + static_cast<float>(right[i - base])) / 65536.0f;
+            }
+        }
+    }
+};
+
+} // namespace
+
+int runSpectrogramExport(const SpectrogramOptions& options) {
+    auto start = std::chrono::steady_clock::now();
+    WavFile wav;
+    std::string error;
+    if (!wav.open(options.input, error)) {
+        std::cerr << "Error: " << error << std::endl;
+        return 1;
+    }
+    const std::string output = options.output.empty() ? options.input + (options.color ? ".ppm" : ".pgm") : options.output;
+    const uint64_t rows = std::max<uint64_t>(1, (wav.frames() + options.hop - 1) / options.hop);
+    const int width = options.fftSize / 2;
+    const uint64_t tiles = (rows + TILE_ROWS - 1) / TILE_ROWS;
+    int jobs = options.jobs > 0 ? options.jobs : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    jobs = static_cast<int>(std::min<uint64_t>(jobs, tiles));
+    const uint64_t ahead = TILES_AHEAD_PER_JOB * jobs;
+
+    FILE* out = std::fopen(output.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Error: cannot write " << output << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    // Netpbm binary gray (P5) or color (P6); the height is known before any row is
+    char header[64];
+    int header_bytes = snprintf(header, sizeof(header), "%s\n%d %llu\n255\n", options.color ? "P6" : "P5", width,
+                                static_cast<unsigned long long>(rows));
+    bool failed = std::fwrite(header, 1, header_bytes, out) != static_cast<size_t>(header_bytes);
+
+    std::mutex mutex;  // Guards everything below
+    std::condition_variable written;
+    uint64_t next_write = 0;
+    std::map<uint64_t, std::vector<uint8_t>> finished;  // Tiles done before the ones ahead of them
+    std::vector<std::vector<uint8_t>> spare;            // Written tiles' buffers, for reuse
+    std::atomic<uint64_t> next_tile{0};
+    auto worker = [&]() {
+        TileRenderer renderer(wav, options);
+        std::vector<uint8_t> pixels;
+        for (uint64_t tile = next_tile++; tile < tiles; tile = next_tile++) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                written.wait(lock, [&]() { return failed || tile < next_write + ahead; });
+                if (failed) return;
+            }
+            renderer.render(tile * TILE_ROWS, std::min(rows, (tile + 1) * TILE_ROWS), pixels);
+            std::lock_guard<std::mutex> lock(mutex);
+            finished.emplace(tile, std::move(pixels));
+            for (auto it = finished.find(next_write); it != finished.end() && !failed; it = finished.find(next_write)) {
+                failed = std::fwrite(it->second.data(), 1, it->second.size(), out) != it->second.size();
+                spare.push_back(std::move(it->second));
+                finished.erase(it);
+                ++next_write;
+            }
+            pixels.clear();
+            if (!spare.empty()) {
+                pixels = std::move(spare.back());
+                spare.pop_back();
+            }
+            written.notify_all();
+        }
+    };
+    std::vector<std::thread> workers;
+    for (int i = 1; i < jobs; ++i) workers.emplace_back(worker);
+    worker();
+    for (std::thread& thread : workers) thread.join();
+
+    if (std::fclose(out) != 0) failed = true;
+    if (failed) {
+        std::cerr << "Error: cannot write " << output << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    const double seconds = static_cast<double>(wav.frames()) / wav.sampleRate();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    char summary[192];
+    snprintf(summary, sizeof(summary), "Wrote a %dx%llu spectrogram of %.1f s of audio in %.2f s (%.0fx real time, %d thread%s)",
+             width, static_cast<unsigned long long>(rows), seconds, elapsed, elapsed > 0.0 ? seconds / elapsed : 0.0,
+             jobs, jobs == 1 ? "" : "s");
+    std::cerr << summary << std::endl;
+    return 0;
+}
@@ -0,0 +1,34 @@
+#ifndef SPECTROGRAM_H
+#define SPECTROGRAM_H
+
+#include <string>
+
+/**
+ * @brief Settings of the spectrogram export, taken from the command line.
+ */
+struct SpectrogramOptions {
+    std::string input;      // --spectrogram: the WAVE file to render
+    std::string output;     // --image-out: empty for "<input>.pgm" (or .ppm)
+    bool color = false;     // --palette color: a PPM heat map instead of a PGM in gray
+    int fftSize = 2048;     // --fft: samples per row, a power of two
+    int hop = 512;          // --hop: samples between rows
+    float floorDb = -100.0f;  // --floor: the level drawn black; 0 dBFS is white
+    int jobs = 0;           // Worker threads; 0 for one per core
+};
+
+/**
+ * @brief Renders a WAVE file into a spectrogram image, without any image library.
+ *
+ * Time runs down the image, one row per hop, and frequency across it, one
+ * column per FFT bin from DC on the left to just below Nyquist on the right.
+ * That way rows are written in file order as they are computed. Every row
+ * is the Hann-windowed power spectrum of the mono mix, from the shared FFT
+ * plan. The rows are cut into tiles that worker threads compute side by
+ * side, each thread reusing its own buffers. Tiles are written out in order
+ * as they finish, and no thread runs more than a few tiles ahead of the
+ * writer, so memory stays the same however long the input is.
+ * Returns the exit code.
+ */
+int runSpectrogramExport(const SpectrogramOptions& options);
+
+#endif // SPECTROGRAM_H
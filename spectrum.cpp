@@ -0,0 +1,92 @@
+#include "spectrum.h"
+#include <cmath>
+#include <deque>
+#include <mutex>
+
+const FftPlan& FftPlan::forSize(int size) {
+    // A deque keeps earlier plans in place when a new size is added
+    static std::deque<FftPlan> plans;
+    static std::mutex plans_mutex;
+    std::lock_guard<std::mutex> lock(plans_mutex);
+    for (const auto& plan : plans) {
+        if (plan.size() == size) return plan;
+    }
+    plans.emplace_back(size);
+    return plans.back();
+}
+
+FftPlan::FftPlan(int size) : n(size) {
+    const double PI = 3.14159265358979323846;
+    const int half = n / 2;
+    int bits = 0;
+    while ((1 << bits) < half) ++bits;
+    bitReverse.resize(half);
+    for (int i = 0; i < half; ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) reversed |= ((i >> b) & 1) << (bits - 1 - b);
+        bitReverse[i] = reversed;
+    }
+    twiddles.resize(half / 2);
+    for (int k = 0; k < half / 2; ++k) {
+        double angle = -2.0 * PI * k / half;
+        twiddles[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+    }
+    splitTwiddles.resize(half + 1);
+    for (int k = 0; k <= half; ++k) {
+        double angle = -2.0 * PI * k / n;
+        splitTwiddles[k] = {static_cast<float>(std::cos(angle)), static_cast<float>(std::sin(angle))};
+    }
+    hann.resize(n);
+    double window_sum = 0.0;
+    for (int i = 0; i < n; ++i) {
+        hann[i] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * PI * i / n));
+        window_sum += hann[i];
+    }
+    // A sine of amplitude A peaks at A * sum(window) / 2
+    powerScale = static_cast<float>(4.0 / (window_sum * window_sum));
+}
+
+/**
+ * @brief Real FFT through a complex FFT of half the size.
+ *
+ * Even samples go in the real parts and odd samples in the imaginary parts;
+ * the two interleaved spectra are then separated and combined.
+ */
+void FftPlan::forward(const float* input, std::complex<float>* out, std::vector<std::complex<float>>& scratch) const {
+    const int half = n / 2;
+    if (static_cast<int>(scratch.size()) < half) scratch.resize(half);
+    std::complex<float>* z = scratch.data();
+    for (int i = 0; i < half; ++i) {
+        z[bitReverse[i]] = {input[2 * i] * hann[2 * i], input[2 * i + 1] * hann[2 * i + 1]};
+    }
+
+    // Iterative radix-2 butterflies
+    for (int length = 2; length <= half; length <<= 1) {
+        const int span = length / 2;
+        const int step = half / length;
+        for (int start = 0; start < half; start += length) {
+            for (int j = 0; j < span; ++j) {
+                std::complex<float> u = z[start + j];
+                std::complex<float> v = z[start + j + span] * twiddles[j * step];
+                z[start + j] = u + v;
+                z[start + j + span] = u - v;
+            }
+        }
+    }
+
+    for (int k = 0; k <= half; ++k) {
+        std::complex<float> a = z[k % half];
+        std::complex<float> b = std::conj(z[(half - k) % half]);
+        std::complex<float> even = 0.5f * (a + b);
+        std::complex<float> odd = std::complex<float>(0.0f, -0.5f) * (a - b);
+        out[k] = even + splitTwiddles[k] * odd;
+    }
+}
+
+void FftPlan::powerSpectrum(const float* input, float* power, std::vector<std::complex<float>>& scratch) const {
+    // The bins go after the half-size transform in the same scratch buffer
+    if (static_cast<int>(scratch.size()) < n / 2 + bins()) scratch.resize(n / 2 + bins());
+    std::complex<float>* spectrum = scratch.data() + n / 2;
+    forward(input, spectrum, scratch);
+    for (int k = 0; k < bins(); ++k) power[k] = std::norm(spectrum[k]) * powerScale;
+}
@@ -0,0 +1,44 @@
+#ifndef SPECTRUM_H
+#define SPECTRUM_H
+
+#include <complex>
+#include <vector>
+
+/**
+ * @brief Precomputed tables for one real FFT size.
+ *
+ * Holds the bit-reversal permutation and twiddles of the half-size complex
+ * transform, the twiddles that split its result into the real spectrum,
+ * and a Hann window. Plans are built once per size and shared (see
+ * forSize()); transforming only reads them, so threads can share a plan
+ * as long as each brings its own scratch buffer.
+ */
+class FftPlan {
+public:
+    // The shared plan for `size`, a power of two of at least 4; built on first use
+    static const FftPlan& forSize(int size);
+
+    explicit FftPlan(int size);
+
+    int size() const { return n; }
+    int bins() const { return n / 2 + 1; }
+    const std::vector<float>& window() const { return hann; }
+
+    // Spectrum of `size` real samples, windowed with the Hann window:
+    // writes bins() values. `scratch` grows to size / 2 on first use.
+    void forward(const float* input, std::complex<float>* out, std::vector<std::complex<float>>& scratch) const;
+
+    // |X|^2 of every bin, scaled so a full-scale sine reads about 1;
+    // `scratch` grows to size / 2 + bins() on first use
+    void powerSpectrum(const float* input, float* power, std::vector<std::complex<float>>& scratch) const;
+
+private:
+    int n;
+    std::vector<int> bitReverse;                  // Of the size / 2 complex transform
+    std::vector<std::complex<float>> twiddles;    // exp(-2 pi i k / (size / 2)), k < size / 4
+    std::vector<std::complex<float>> splitTwiddles;  // exp(-2 pi i k / size), k <= size / 2
+    std::vector<float> hann;
+    float powerScale;
+};
+
+#endif // SPECTRUM_H
@@ -0,0 +1,148 @@
+#include "stereo_field.h"
+#include "spectrum.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const float BAND_CENTERS[STEREO_BANDS] = {31.5f, 63.0f, 125.0f, 250.0f, 500.0f, 1000.0f, 2000.0f, 4000.0f, 8000.0f, 16000.0f};
+const char* const BAND_LABELS[STEREO_BANDS] = {"31", "63", "125", "250", "500", "1k", "2k", "4k", "8k", "16k"};
+
+float toDb(double meanSquare) {
+    return meanSquare > 0.0 ? 10.0f * static_cast<float>(std::log10(meanSquare)) : -INFINITY;
+}
+
+float sideShare(double mid, double side) {
+    return mid + side > 0.0 ? static_cast<float>(side / (mid + side)) : 0.0f;
+}
+
+} // namespace
+
+StereoFieldAnalyzer::StereoFieldAnalyzer(float windowSeconds, int historyLength)
+: window_seconds(windowSeconds),
+  mid_samples(FFT_SIZE, 0.0f), side_samples(FFT_SIZE, 0.0f),
+  power(FFT_SIZE / 2 + 1, 0.0f),
+  correlation_history(historyLength, 0.0f), width_history(historyLength, 0.0f) {}
+
+const char* StereoFieldAnalyzer::bandLabel(int band) {
+    return BAND_LABELS[band];
+}
+
+/**
+ * @brief Maps the bands to FFT bins and sizes the window for a sample rate.
+ */
+void StereoFieldAnalyzer::configure(uint32_t sampleRate) {
+    sample_rate = sampleRate;
+    const float bin_hz = static_cast<float>(sampleRate) / FFT_SIZE;
+    const int last_bin = FFT_SIZE / 2;
+    for (int band = 0; band < STEREO_BANDS; ++band) {
+        // Octave bands: from half an octave below the centre to half an octave above
+        int first = static_cast<int>(std::ceil(BAND_CENTERS[band] / std::sqrt(2.0f) / bin_hz));
+        int last = static_cast<int>(std::ceil(BAND_CENTERS[band] * std::sqrt(2.0f) / bin_hz));
+        band_first[band] = std::max(1, std::min(first, last_bin));
+        band_last[band] = std::max(band_first[band], std::min(last, last_bin));
+        current.bandPresent[band] = band_last[band] > band_first[band];
+    }
+    int window_hops = std::max(1, static_cast<int>(std::lround(window_seconds * sampleRate / BUFFER_FRAMES)));
+    hops.assign(window_hops, HopSums());
+    reset();
+}
+
+void StereoFieldAnalyzer::reset() {
+    std::fill(mid_samples.begin(), mid_samples.end(), 0.0f);
+    std::fill(side_samples.begin(), side_samples.end(), 0.0f);
+    std::fill(hops.begin(), hops.end(), HopSums());
+    totals = HopSums();
+    next_hop = 0;
+    filled_hops = 0;
+    std::fill(correlation_history.begin(), correlation_history.end(), 0.0f);
+    std::fill(width_history.begin(), width_history.end(), 0.0f);
+    next_history = 0;
+    history_filled = 0;
+    bool present[STEREO_BANDS];
+    std::copy(current.bandPresent, current.bandPresent + STEREO_BANDS, present);
+    current = StereoFieldReading();
+    std::copy(present, present + STEREO_BANDS, current.bandPresent);
+}
+
+void StereoFieldAnalyzer::addHop(const int16_t* left, const int16_t* right, uint32_t sampleRate) {
+    if (sampleRate == 0) return;
+    if (sampleRate != sample_rate) configure(sampleRate);
+
+    // Slide the FFT input along by one hop while summing the new samples
+    HopSums hop;
+    std::copy(mid_samples.begin() + BUFFER_FRAMES, mid_samples.end(), mid_samples.begin());
+    std::copy(side_samples.begin() + BUFFER_FRAMES, side_samples.end(), side_samples.begin());
+    float* mid_tail = mid_samples.data() + FFT_SIZE - BUFFER_FRAMES;
+    float* side_tail = side_samples.data() + FFT_SIZE - BUFFER_FRAMES;
+    for (int i = 0; i < BUFFER_FRAMES; ++i) {
+        float l = left[i] / 32768.0f;
+        float r = right[i] / 32768.0f;
+        float m = 0.5f * (l + r);
+        float s = 0.5f * (l - r);
+        mid_tail[i] = m;
+        side_tail[i] = s;
+        hop.lr += l * r;
+        hop.ll += l * l;
+        hop.rr += r * r;
+        hop.mm += m * m;
+        hop.ss += s * s;
+    }
+
+    const FftPlan& plan = FftPlan::forSize(FFT_SIZE);
+    plan.powerSpectrum(mid_samples.data(), power.data(), scratch);
+    for (int band = 0; band < STEREO_BANDS; ++band) {
+        for (int k = band_first[band]; k < band_last[band]; ++k) hop.bandMid[band] += power[k];
+    }
+    plan.powerSpectrum(side_samples.data(), power.data(), scratch);
+    for (int band = 0; band < STEREO_BANDS; ++band) {
+        for (int k = band_first[band]; k < band_last[band]; ++k) hop.bandSide[band] += power[k];
+    }
+
+    // Add the new hop to the window totals and drop the one it replaces
+    HopSums& oldest = hops[next_hop];
+    totals.lr += hop.lr - oldest.lr;
+    totals.ll += hop.ll - oldest.ll;
+    totals.rr += hop.rr - oldest.rr;
+    totals.mm += hop.mm - oldest.mm;
+    totals.ss += hop.ss - oldest.ss;
+    for (int band = 0; band < STEREO_BANDS; ++band) {
+        totals.bandMid[band] += hop.bandMid[band] - oldest.bandMid[band];
+        totals.bandSide[band] += hop.bandSide[band] - oldest.bandSide[band];
+    }
+    oldest = hop;
+    next_hop = (next_hop + 1) % static_cast<int>(hops.size());
+    filled_hops = std::min(filled_hops + 1, static_cast<int>(hops.size()));
+
+    updateReading();
+    correlation_history[next_history] = current.correlation;
+    width_history[next_history] = current.width;
+    next_history = (next_history + 1) % static_cast<int>(correlation_history.size());
+    history_filled = std::min(history_filled + 1, static_cast<int>(correlation_history.size()));
+}
+
+void StereoFieldAnalyzer::updateReading() {
+    // Subtracting can leave a silent window a rounding error below zero
+    const double samples = static_cast<double>(filled_hops) * BUFFER_FRAMES;
+    const double ll = std::max(0.0, totals.ll), rr = std::max(0.0, totals.rr);
+    const double mm = std::max(0.0, totals.mm), ss = std::max(0.0, totals.ss);
+    current.midDb = toDb(mm / samples);
+    current.sideDb = toDb(ss / samples);
+    current.correlation = ll > 1e-12 && rr > 1e-12
+        ? std::max(-1.0f, std::min(1.0f, static_cast<float>(totals.lr / std::sqrt(ll * rr))))
+        : 0.0f;
+    current.width = sideShare(mm, ss);
+    for (int band = 0; band < STEREO_BANDS; ++band) {
+        current.bandWidth[band] = sideShare(std::max(0.0, totals.bandMid[band]), std::max(0.0, totals.bandSide[band]));
+    }
+}
+
+float StereoFieldAnalyzer::correlationAt(int age) const {
+    int size = static_cast<int>(correlation_history.size());
+    return correlation_history[(next_history - 1 - age + 2 * size) % size];
+}
+
+float StereoFieldAnalyzer::widthAt(int age) const {
+    int size = static_cast<int>(width_history.size());
+    return width_history[(next_history - 1 - age + 2 * size) % size];
+}
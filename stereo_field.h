@@ -0,0 +1,86 @@
+#ifndef STEREO_FIELD_H
+#define STEREO_FIELD_H
+
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+#include "config_parser.h"
+
+const int STEREO_BANDS = 10;  // Octaves centred on 31.5 Hz to 16 kHz
+
+/**
+ * @brief The stereo field over the analysis window.
+ *
+ * Width is the side signal's share of the energy: 0 for mono, 0.5 for
+ * uncorrelated channels, 1 for channels in opposite phase.
+ */
+struct StereoFieldReading {
+    float midDb = -INFINITY;    // RMS of (L + R) / 2, dBFS
+    float sideDb = -INFINITY;   // RMS of (L - R) / 2, dBFS
+    float correlation = 0.0f;   // -1 to 1, 0 when either channel is silent
+    float width = 0.0f;
+    float bandWidth[STEREO_BANDS] = {};
+    bool bandPresent[STEREO_BANDS] = {};  // False above the Nyquist frequency
+};
+
+/**
+ * @brief Mid/side levels, correlation and per-band width of a stereo signal.
+ *
+ * Fed one hop (BUFFER_FRAMES samples per channel) at a time. Every hop
+ * contributes its sums of products and its mid and side band energies,
+ * taken from a Hann-windowed FFT of the latest FFT_SIZE samples; the
+ * window totals are kept by adding the new hop and subtracting the one
+ * that falls out, so a hop costs the same however long the window is.
+ * Correlation and width of every hop are also kept for plotting over time.
+ */
+class StereoFieldAnalyzer {
+public:
+    static const int FFT_SIZE = 2048;
+
+    explicit StereoFieldAnalyzer(float windowSeconds = 0.3f, int historyLength = 512);
+
+    void addHop(const int16_t* left, const int16_t* right, uint32_t sampleRate);
+    void reset();
+
+    const StereoFieldReading& reading() const { return current; }
+
+    // Per-hop values, age 0 being the latest hop; age < historySize()
+    int historySize() const { return history_filled; }
+    float correlationAt(int age) const;
+    float widthAt(int age) const;
+
+    static const char* bandLabel(int band);
+
+private:
+    struct HopSums {
+        double lr = 0.0, ll = 0.0, rr = 0.0, mm = 0.0, ss = 0.0;
+        double bandMid[STEREO_BANDS] = {};
+        double bandSide[STEREO_BANDS] = {};
+    };
+
+    float window_seconds;
+    uint32_t sample_rate = 0;
+    int band_first[STEREO_BANDS] = {};  // FFT bins of each band, [first, last)
+    int band_last[STEREO_BANDS] = {};
+
+    std::vector<float> mid_samples, side_samples;  // The latest FFT_SIZE samples, oldest first
+    std::vector<float> power;
+    std::vector<std::complex<float>> scratch;
+
+    std::vector<HopSums> hops;  // Ring of the hops in the window
+    int next_hop = 0;
+    int filled_hops = 0;
+    HopSums totals;
+
+    std::vector<float> correlation_history, width_history;
+    int next_history = 0;
+    int history_filled = 0;
+
+    StereoFieldReading current;
+
+    void configure(uint32_t sampleRate);
+    void updateReading();
+};
+
+#endif // STEREO_FIELD_H
@@ -0,0 +1,388 @@
+#include "svg_path.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace {
+// Maximum distance between a curve and its flattened polyline, in shape units
+const double FLATTEN_TOLERANCE = 0.25;
+const int MAX_SUBDIVISION_DEPTH = 16;
+const double PI = 3.14159265358979323846;
+
+struct Point {
+    double x, y;
+};
+
+Point operator+(Point a, Point b) { return {a.x + b.x, a.y + b.y}; }
+Point operator-(Point a, Point b) { return {a.x - b.x, a.y - b.y}; }
+Point operator*(Point a, double s) { return {a.x * s, a.y * s}; }
+Point midpoint(Point a, Point b) { return {(a.x + b.x) * 0.5, (a.y + b.y) * 0.5}; }
+
+// Lines and cubics only; quadratics and arcs are converted on the way in
+struct Segment {
+    bool cubic;
+    Point c1, c2, end;
+};
+
+struct Subpath {
+    Point start;
+    std::vector<Segment> segments;
+};
+
+/**
+ * @brief Tokenizer for SVG path data.
+ *
+ * Handles the compact forms the grammar allows, such as "1.5.5" (two
+ * numbers), "1-2" (two numbers) and arc flags written without separators.
+ */
+struct PathReader {
+    std::string_view text;
+    size_t pos = 0;
+
+    void skipSeparators() {
+        while (pos < text.size() && (std::isspace(static_cast<unsigned char>(text[pos])) || text[pos] == ',')) pos++;
+    }
+    bool atEnd() {
+        skipSeparators();
+        return pos >= text.size();
+    }
+    bool number(double& out) {
+        skipSeparators();
+        size_t start = pos;
+        if (pos < text.size() && text[pos] == '+') start = ++pos;
+        auto result = std::from_chars(text.data() + start, text.data() + text.size(), out);
+        if (result.ec != std::errc()) return false;
+        pos = result.ptr - text.data();
+        return true;
+    }
+    bool flag(bool& out) {
+        skipSeparators();
+        if (pos >= text.size() || (text[pos] != '0' && text[pos] != '1')) return false;
+        out = text[pos++] == '1';
+        return true;
+    }
+    bool point(Point& out) { return number(out.x) && number(out.y); }
+};
+
+// Appends the cubic approximation of an SVG elliptical arc (SVG 1.1, appendix F.6)
+void appendArc(std::vector<Segment>& segments, Point from, double rx, double ry, double rotation_deg,
+               bool large_arc, bool sweep, Point to) {
+    rx = std::fabs(rx);
+    ry = std::fabs(ry);
+    if (rx == 0.0 || ry == 0.0) {
+        segments.push_back({false, {}, {}, to});
+        return;
+    }
+    if (from.x == to.x && from.y == to.y) return;
+
+    const double phi = rotation_deg * PI / 180.0;
+    const double cos_phi = std::cos(phi), sin_phi = std::sin(phi);
+    const double dx2 = (from.x - to.x) / 2.0, dy2 = (from.y - to.y) / 2.0;
+    const double x1p = cos_phi * dx2 + sin_phi * dy2;
+    const double y1p = -sin_phi * dx2 + cos_phi * dy2;
+
+    // Radii too small to span the endpoints are scaled up
+    double lambda = (x1p * x1p) / (rx * rx) + (y1p * y1p) / (ry * ry);
+    if (lambda > 1.0) {
+        rx *= std::sqrt(lambda);
+        ry *= std::sqrt(lambda);
+    }
+    double numerator = rx * rx * ry * ry - rx * rx * y1p * y1p - ry * ry * x1p * x1p;
+    double denominator = rx * rx * y1p * y1p + ry * ry * x1p * x1p;
+    double coef = std::sqrt(std::max(0.0, numerator / denominator)) * (large_arc == sweep ? -1.0 : 1.0);
+    const double cxp = coef * rx * y1p / ry;
+    const double cyp = -coef * ry * x1p / rx;
+    const double cx = cos_phi * cxp - sin_phi * cyp + (from.x + to.x) / 2.0;
+    const double cy = sin_phi * cxp + cos_phi * cyp + (from.y + to.y) / 2.0;
+
+    const double theta1 = std::atan2((y1p - cyp) / ry, (x1p - cxp) / rx);
+    double delta = std::atan2((-y1p - cyp) / ry, (-x1p - cxp) / rx) - theta1;
+    if (!sweep && delta > 0) delta -= 2.0 * PI;
+    else if (sweep && delta < 0) delta += 2.0 * PI;
+
+    // One cubic per quarter turn or less keeps the approximation error tiny
+    const int pieces = std::max(1, static_cast<int>(std::ceil(std::fabs(delta) / (PI / 2.0) - 1e-9)));
+    const double step = delta / pieces;
+    const double handle = 4.0 / 3.0 * std::tan(step / 4.0);
+    auto map = [&](double ux, double uy) {
+        return Point{cx + rx * cos_phi * ux - ry * sin_phi * uy,
+                     cy + rx * sin_phi * ux + ry * cos_phi * uy};
+    };
+    for (int i = 0; i < pieces; ++i) {
+        double a1 = theta1 + step * i;
+        double a2 = a1 + step;
+        Point c1 = map(std::cos(a1) - handle * std::sin(a1), std::sin(a1) + handle * std::cos(a1));
+        Point c2 = map(std::cos(a2) + handle * std::sin(a2), std::sin(a2) - handle * std::cos(a2));
+        Point end = (i == pieces - 1) ? to : map(std::cos(a2), std::sin(a2));
+        segments.push_back({true, c1, c2, end});
+    }
+}
+
+bool parsePath(std::string_view data, std::vector<Subpath>& subpaths, std::string& error) {
+    PathReader reader{data};
+    Point current{0, 0};
+    Point last_cubic_ctrl{0, 0};   // For S/s reflection
+    Point last_quad_ctrl{0, 0};    // For T/t reflection
+    char command = 0;
+    char previous = 0;
+    bool need_subpath = true;      // Drawing after a closepath starts a new subpath
+
+    auto fail = [&](const std::string& message) {
+        error = message + " at offset " + std::to_string(reader.pos);
+        return false;
+    };
+
+    while (!reader.atEnd()) {
+        char c = data[reader.pos];
+        if (std::isalpha(static_cast<unsigned char>(c))) {
+            if (!std::strchr("MmLlHhVvCcSsQqTtAaZz", c)) return fail(std::string("unknown path command '") + c + "'");
+            command = c;
+            reader.pos++;
+        } else if (command == 0 || command == 'Z' || command == 'z') {
+            return fail("expected a path command");
+        }
+        // Coordinates after a moveto continue as implicit linetos
+        else if (command == 'M') command = 'L';
+        else if (command == 'm') command = 'l';
+
+        const bool relative = std::islower(static_cast<unsigned char>(command));
+        const Point origin = relative ? current : Point{0, 0};
+        const char upper = static_cast<char>(std::toupper(static_cast<unsigned char>(command)));
+
+        if (upper != 'M' && upper != 'Z' && need_subpath) {
+            subpaths.push_back({current, {}});
+            need_subpath = false;
+        }
+
+        switch (upper) {
+        case 'M': {
+            Point p;
+            if (!reader.point(p)) return fail("expected coordinates");
+            current = origin + p;
+            subpaths.push_back({current, {}});
+            need_subpath = false;
+            break;
+        }
+        case 'Z':
+            if (!subpaths.empty()) current = subpaths.back().start;
+            need_subpath = true;
+            break;
+        case 'L': {
+            Point p;
+            if (!reader.point(p)) return fail("expected coordinates");
+            current = origin + p;
+            subpaths.back().segments.push_back({false, {}, {}, current});
+            break;
+        }
+        case 'H': {
+            double x;
+            if (!reader.number(x)) return fail("expected a coordinate");
+            current.x = relative ? current.x + x : x;
+            subpaths.back().segments.push_back({false, {}, {}, current});
+            break;
+        }
+        case 'V': {
+            double y;
+            if (!reader.number(y)) return fail("expected a coordinate");
+            current.y = relative ? current.y + y : y;
+            subpaths.back().segments.push_back({false, {}, {}, current});
+            break;
+        }
+        case 'C':
+        case 'S': {
+            Point c1, c2, end;
+            if (upper == 'C') {
+                if (!reader.point(c1)) return fail("expected coordinates");
+                c1 = origin + c1;
+            } else {
+                bool follows_cubic = std::strchr("CcSs", previous) != nullptr;
+                c1 = follows_cubic ? current * 2.0 - last_cubic_ctrl : current;
+            }
+            if (!reader.point(c2) || !reader.point(end)) return fail("expected coordinates");
+            c2 = origin + c2;
+            end = origin + end;
+            subpaths.back().segments.push_back({true, c1, c2, end});
+            last_cubic_ctrl = c2;
+            current = end;
+            break;
+        }
+        case 'Q':
+        case 'T': {
+            Point q, end;
+            if (upper == 'Q') {
+                if (!reader.point(q)) return fail("expected coordinates");
+                q = origin + q;
+            } else {
+                bool follows_quad = std::strchr("QqTt", previous) != nullptr;
+                q = follows_quad ? current * 2.0 - last_quad_ctrl : current;
+            }
+            if (!reader.point(end)) return fail("expected coordinates");
+            end = origin + end;
+            // Degree elevation: a quadratic is exactly a cubic with these controls
+            Point c1 = current + (q - current) * (2.0 / 3.0);
+            Point c2 = end + (q - end) * (2.0 / 3.0);
+            subpaths.back().segments.push_back({true, c1, c2, end});
+            last_quad_ctrl = q;
+            current = end;
+            break;
+        }
+        case 'A': {
+            double rx, ry, rotation;
+            bool large_arc, sweep;
+            Point end;
+            if (!reader.number(rx) || !reader.number(ry) || !reader.number(rotation)) return fail("expected arc radii and rotation");
+            if (!reader.flag(large_arc) || !reader.flag(sweep)) return fail("expected arc flags");
+            if (!reader.point(end)) return fail("expected coordinates");
+            end = origin + end;
+            appendArc(subpaths.back().segments, current, rx, ry, rotation, large_arc, sweep, end);
+            current = end;
+            break;
+        }
+        }
+        previous = command;
+    }
+    return true;
+}
+
+// Recursively splits a cubic until it is within `tolerance` of its chord
+void flattenCubic(Point p0, Point c1, Point c2, Point p3, double tolerance, int depth,
+                  std::vector<std::pair<float, float>>& out) {
+    Point chord = p3 - p0;
+    double length = std::sqrt(chord.x * chord.x + chord.y * chord.y);
+    auto distance = [&](Point p) {
+        Point d = p - p0;
+        if (length < 1e-12) return std::sqrt(d.x * d.x + d.y * d.y);
+        return std::fabs(d.x * chord.y - d.y * chord.x) / length;
+    };
+    if (depth >= MAX_SUBDIVISION_DEPTH || std::max(distance(c1), distance(c2)) <= tolerance) {
+        out.push_back({static_cast<float>(p3.x), static_cast<float>(p3.y)});
+        return;
+    }
+    // de Casteljau split at t = 0.5
+    Point p01 = midpoint(p0, c1), p12 = midpoint(c1, c2), p23 = midpoint(c2, p3);
+    Point p012 = midpoint(p01, p12), p123 = midpoint(p12, p23);
+    Point mid = midpoint(p012, p123);
+    flattenCubic(p0, p01, p012, mid, tolerance, depth + 1, out);
+    flattenCubic(mid, p123, p23, p3, tolerance, depth + 1, out);
+}
+
+// Flattens and normalizes all subpaths of one import into `out`
+bool finishImport(const std::vector<Subpath>& subpaths, ShapePolygons& out, std::string& error) {
+    // The control points bound the curves, so the scale is known before flattening
+    double min_x = INFINITY, min_y = INFINITY, max_x = -INFINITY, max_y = -INFINITY;
+    auto extend = [&](Point p) {
+        min_x = std::min(min_x, p.x); max_x = std::max(max_x, p.x);
+        min_y = std::min(min_y, p.y); max_y = std::max(max_y, p.y);
+    };
+    for (const auto& subpath : subpaths) {
+        extend(subpath.start);
+        for (const auto& segment : subpath.segments) {
+            if (segment.cubic) { extend(segment.c1); extend(segment.c2); }
+            extend(segment.end);
+        }
+    }
+    double extent = std::max(max_x - min_x, max_y - min_y);
+    if (subpaths.empty() || !(extent > 0.0)) {
+        error = "path has no area";
+        return false;
+    }
+    const double tolerance = FLATTEN_TOLERANCE * extent / 200.0;
+
+    ShapePolygons flattened;
+    for (const auto& subpath : subpaths) {
+        std::vector<std::pair<float, float>> polygon;
+        polygon.push_back({static_cast<float>(subpath.start.x), static_cast<float>(subpath.start.y)});
+        Point current = subpath.start;
+        for (const auto& segment : subpath.segments) {
+            if (segment.cubic) flattenCubic(current, segment.c1, segment.c2, segment.end, tolerance, 0, polygon);
+            else polygon.push_back({static_cast<float>(segment.end.x), static_cast<float>(segment.end.y)});
+            current = segment.end;
+        }
+        // Polygons are implicitly closed; drop an explicit closing vertex
+        if (polygon.size() > 1 && polygon.back() == polygon.front()) polygon.pop_back();
+        if (polygon.size() >= 2) flattened.push_back(std::move(polygon));
+    }
+    if (flattened.empty()) {
+        error = "path has no area";
+        return false;
+    }
+
+    // Re-measure on the flattened points so the shape fills the space exactly
+    float fmin_x = INFINITY, fmin_y = INFINITY, fmax_x = -INFINITY, fmax_y = -INFINITY;
+    for (const auto& polygon : flattened) {
+        for (const auto& p : polygon) {
+            fmin_x = std::min(fmin_x, p.first); fmax_x = std::max(fmax_x, p.first);
+            fmin_y = std::min(fmin_y, p.second); fmax_y = std::max(fmax_y, p.second);
+        }
+    }
+    const float center_x = (fmin_x + fmax_x) / 2.0f;
+    const float center_y = (fmin_y + fmax_y) / 2.0f;
+    const float scale = 200.0f / std::max(fmax_x - fmin_x, fmax_y - fmin_y);
+    for (auto& polygon : flattened) {
+        for (auto& p : polygon) {
+            p.first = (p.first - center_x) * scale;
+            p.second = (p.second - center_y) * scale;
+        }
+        out.push_back(std::move(polygon));
+    }
+    return true;
+}
+
+// Finds the value of the `d` attribute inside one tag, if present
+bool findPathData(std::string_view tag, std::string_view& data) {
+    for (size_t pos = tag.find("d="); pos != std::string_view::npos; pos = tag.find("d=", pos + 1)) {
+        // Must be a whole attribute name, not the tail of e.g. "id="
+        if (pos == 0 || !std::isspace(static_cast<unsigned char>(tag[pos - 1]))) continue;
+        size_t quote_pos = pos + 2;
+        if (quote_pos >= tag.size() || (tag[quote_pos] != '"' && tag[quote_pos] != '\'')) continue;
+        size_t close = tag.find(tag[quote_pos], quote_pos + 1);
+        if (close == std::string_view::npos) return false;
+        data = tag.substr(quote_pos + 1, close - quote_pos - 1);
+        return true;
+    }
+    return false;
+}
+}
+
+bool importSvgPath(std::string_view pathData, ShapePolygons& out, std::string& error) {
+    std::vector<Subpath> subpaths;
+    if (!parsePath(pathData, subpaths, error)) return false;
+    return finishImport(subpaths, out, error);
+}
+
+bool importSvgFile(const std::string& filename, ShapePolygons& out, std::string& error) {
+    FileContents file(filename);
+    if (!file.ok) {
+        error = "cannot open " + filename;
+        return false;
+    }
+    std::string_view text(file.data ? file.data : "", file.size);
+
+    std::vector<Subpath> subpaths;
+    int path_count = 0;
+    for (size_t pos = text.find("<path"); pos != std::string_view::npos; pos = text.find("<path", pos + 1)) {
+        size_t tag_end = text.find('>', pos);
+        if (tag_end == std::string_view::npos) break;
+        std::string_view tag = text.substr(pos + 5, tag_end - pos - 5);
+        std::string_view data;
+        if (!findPathData(tag, data)) continue;
+        std::string path_error;
+        if (!parsePath(data, subpaths, path_error)) {
+            error = filename + ": path " + std::to_string(path_count + 1) + ": " + path_error;
+            return false;
+        }
+        path_count++;
+    }
+    if (path_count == 0) {
+        error = filename + ": no <path d=\"...\"> elements found";
+        return false;
+    }
+    if (!finishImport(subpaths, out, error)) {
+        error = filename + ": " + error;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,29 @@
+#ifndef SVG_PATH_H
+#define SVG_PATH_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+using ShapePolygons = std::vector<std::vector<std::pair<float, float>>>;
+
+/**
+ * @brief Imports SVG path data as custom visualizer polygons.
+ *
+ * Every subpath becomes one polygon. Curves (C/S/Q/T) and elliptical arcs (A)
+ * are flattened to line segments by adaptive subdivision, so gentle curves
+ * get few points and tight ones get many. The result is centered and scaled
+ * so its larger extent spans -100..100, the space the shape drawing code
+ * works in. Each import is normalized on its own and appended to `out`.
+ *
+ * Only path geometry is read: transforms, strokes and fills are ignored.
+ */
+
+// Imports one path `d` attribute. On failure `error` says what went wrong.
+bool importSvgPath(std::string_view pathData, ShapePolygons& out, std::string& error);
+
+// Imports every <path d="..."> element in an SVG file, as one shape.
+bool importSvgFile(const std::string& filename, ShapePolygons& out, std::string& error);
+
+#endif // SVG_PATH_H
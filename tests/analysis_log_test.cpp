@@ -0,0 +1,92 @@
+// Tests for analysis logs: what the recorder writes, the replayer reads back,
+// including logs whose header is longer than the one this version writes.
+#include "analysis_log.h"
+#include "tests/check.h"
+#include <unistd.h>
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+namespace {
+
+const int FRAMES = ANALYSIS_LOG_INDEX_INTERVAL + 44;  // A full group and a partial one
+
+std::string tempPath(const char* name) {
+    return "/tmp/analysis_log_test-" + std::to_string(getpid()) + "-" + name;
+}
+
+std::vector<uint8_t> readFile(const std::string& path) {
+    std::vector<uint8_t> bytes;
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) return bytes;
+    uint8_t chunk[4096];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), file)) > 0) bytes.insert(bytes.end(), chunk, chunk + n);
+    std::fclose(file);
+    return bytes;
+}
+
+void writeFile(const std::string& path, const std::vector<uint8_t>& bytes) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    std::fclose(file);
+}
+
+// Replays a whole log one frame per call; every frame's left level must be its number
+void checkReplay(const std::string& path) {
+    AnalysisReplayer replayer;
+    std::string error;
+    CHECK(replayer.open(path, error));
+    CHECK(replayer.frameCount() == FRAMES);
+    replayer.setSpeed(ReplaySpeed::MAX);
+    AnalysisFrame frame;
+    int matching = 0;
+    for (int n = 0; n < FRAMES; ++n) {
+        if (replayer.receive(frame) && std::lround(frame.rms[0] * 1000.0f) == n) ++matching;
+    }
+    CHECK(matching == FRAMES);
+}
+
+void testRoundTrip() {
+    const std::string path = tempPath("plain.mlal");
+    {
+        AnalysisRecorder recorder;
+        std::string error;
+        CHECK(recorder.open(path, error));
+        for (int n = 0; n < FRAMES; ++n) {
+            AnalysisFrame frame;
+            frame.sampleRate = 48000;
+            frame.audioActive = true;
+            frame.rms[0] = n / 1000.0f;
+            recorder.append(frame);
+        }
+    }
+    checkReplay(path);
+
+    // A later writer's longer header: the body starts where the header says, not at 32
+    std::vector<uint8_t> bytes = readFile(path);
+    const size_t extra = 16;
+    bytes.insert(bytes.begin() + 32, extra, 0xEE);
+    bytes[6] = 32 + extra;
+    const std::string longer = tempPath("longer.mlal");
+    writeFile(longer, bytes);
+    checkReplay(longer);
+
+    // A header claiming more than the file holds
+    bytes.resize(40);
+    bytes[6] = 64;
+    writeFile(longer, bytes);
+    AnalysisReplayer replayer;
+    std::string error;
+    CHECK(!replayer.open(longer, error));
+
+    std::remove(path.c_str());
+    std::remove(longer.c_str());
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    return checkResult("analysis_log_test");
+}
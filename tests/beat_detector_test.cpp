@@ -0,0 +1,61 @@
+// Tests for the beat detector: the same audio must give the same beats
+// whatever the hop rate, live at a frame's pace or offline at a buffer's.
+#include "analysis_frame.h"
+#include "tests/check.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// Onset times of a click every half second, each ringing out over 150 ms, fed `rate` hops a second
+std::vector<double> onsetTimes(double rate) {
+    BeatDetector beats;
+    std::vector<double> onsets;
+    const int hops = static_cast<int>(6.0 * rate);
+    for (int hop = 0; hop < hops; ++hop) {
+        double t = hop / rate;
+        double since_click = std::fmod(t, 0.5);
+        float level = since_click < 0.15 ? static_cast<float>(0.4 * std::exp(-since_click * 30.0)) : 0.0f;
+        if (beats.update(level, static_cast<float>(1.0 / rate))) onsets.push_back(t);
+    }
+    return onsets;
+}
+
+void testOneBeatPerClick() {
+    // 44.1 and 96 kHz buffers, and a 60 fps frame
+    for (double rate : {44100.0 / BUFFER_FRAMES, 96000.0 / BUFFER_FRAMES, 60.0}) {
+        std::vector<double> onsets = onsetTimes(rate);
+        CHECK(onsets.size() == 12);
+        for (size_t i = 0; i < onsets.size(); ++i) CHECK(std::fabs(onsets[i] - 0.5 * i) < 1.5 / rate);
+    }
+}
+
+void testBeatDecaysWithTime() {
+    // Half a second later the beat has decayed as far, however many hops it took
+    for (double rate : {60.0, 172.0, 375.0}) {
+        BeatDetector beats;
+        CHECK(beats.update(0.5f, static_cast<float>(1.0 / rate)));
+        for (int hop = 0; hop < static_cast<int>(std::lround(0.5 * rate)); ++hop) beats.update(0.0f, static_cast<float>(1.0 / rate));
+        CHECK(std::fabs(beats.beat - std::exp(-0.5f / BeatDetector::BEAT_SECONDS)) < 0.01f);
+    }
+}
+
+void testBeatLevel() {
+    int16_t left[BUFFER_FRAMES], right[BUFFER_FRAMES];
+    for (int i = 0; i < BUFFER_FRAMES; ++i) {
+        left[i] = 16384;
+        right[i] = -16384;
+    }
+    CHECK(beatLevel(left, right) == 0.0f);  // Opposite phase cancels in the mono mix
+    for (int i = 0; i < BUFFER_FRAMES; ++i) right[i] = 16384;
+    CHECK(std::fabs(beatLevel(left, right) - 0.5f) < 0.001f);
+}
+
+} // namespace
+
+int main() {
+    testOneBeatPerClick();
+    testBeatDecaysWithTime();
+    testBeatLevel();
+    return checkResult("beat_detector_test");
+}
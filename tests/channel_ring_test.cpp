@@ -0,0 +1,92 @@
+// Tests for the capture ring: a reader that falls behind finds the newest
+// buffers in order, never an empty ring or a buffer torn by the writer.
+#include "channel_ring.h"
+#include "tests/check.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A stereo buffer whose every sample is `value`
+std::vector<int16_t> filledBuffer(int16_t value) {
+    return std::vector<int16_t>(BUFFER_FRAMES * 2, value);
+}
+
+void testInOrder() {
+    ChannelRing ring;
+    ChannelBuffers out;
+    uint64_t sequence = 99;
+    CHECK(!ring.read(out, &sequence));
+    for (int i = 0; i < 3; ++i) ring.write(filledBuffer(i).data(), ChannelMap::standard(2));
+    for (int i = 0; i < 3; ++i) {
+        CHECK(ring.read(out, &sequence));
+        CHECK(sequence == static_cast<uint64_t>(i));
+        CHECK(out.data[0][0] == i && out.data[1][BUFFER_FRAMES - 1] == i);
+    }
+    CHECK(!ring.read(out, &sequence));
+}
+
+// Once made a lapped ring look empty: the writer moved its head onto the tail
+void testOverflowKeepsNewest() {
+    ChannelRing ring;
+    const int WRITTEN = ChannelRing::BUFFER_COUNT * 2 + 3;
+    for (int i = 0; i < WRITTEN; ++i) ring.write(filledBuffer(i).data(), ChannelMap::standard(2));
+    ChannelBuffers out;
+    uint64_t sequence = 0;
+    for (int i = WRITTEN - ChannelRing::BUFFER_COUNT; i < WRITTEN; ++i) {
+        CHECK(ring.read(out, &sequence));
+        CHECK(sequence == static_cast<uint64_t>(i));
+        CHECK(out.data[0][0] == i);
+    }
+    CHECK(!ring.read(out, &sequence));
+
+    // Filling it exactly is not an overflow either
+    for (int i = 0; i < ChannelRing::BUFFER_COUNT; ++i) ring.write(filledBuffer(i).data(), ChannelMap::standard(2));
+    int count = 0;
+    while (ring.read(out, &sequence)) ++count;
+    CHECK(count == ChannelRing::BUFFER_COUNT);
+}
+
+// A writer far faster than its reader: every buffer read is whole, and they only ever get newer
+void testConcurrentOverflow() {
+    ChannelRing ring;
+    const int WRITTEN = 200000;
+    std::atomic<bool> done{false};
+    std::thread writer([&]() {
+        for (int i = 0; i < WRITTEN; ++i) ring.write(filledBuffer(static_cast<int16_t>(i)).data(), ChannelMap::standard(2));
+        done = true;
+    });
+    ChannelBuffers out;
+    uint64_t sequence = 0;
+    int64_t last = -1;
+    int torn = 0, backwards = 0, reads = 0;
+    for (;;) {
+        const bool finished = done;  // Read before the ring, so the last buffer is not missed
+        if (!ring.read(out, &sequence)) {
+            if (finished) break;
+            continue;
+        }
+        ++reads;
+        const int16_t expected = static_cast<int16_t>(sequence);
+        for (int c = 0; c < 2; ++c) {
+            for (int i = 0; i < BUFFER_FRAMES; ++i) torn += out.data[c][i] != expected;
+        }
+        backwards += static_cast<int64_t>(sequence) <= last;
+        last = static_cast<int64_t>(sequence);
+    }
+    writer.join();
+    CHECK(reads > 0);
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+    CHECK(last == WRITTEN - 1);
+}
+
+} // namespace
+
+int main() {
+    testInOrder();
+    testOverflowKeepsNewest();
+    testConcurrentOverflow();
+    return checkResult("channel_ring_test");
+}
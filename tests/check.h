@@ -0,0 +1,32 @@
+#ifndef TESTS_CHECK_H
+#define TESTS_CHECK_H
+
+// The tests' one assertion. A failed check is reported and counted, and the
+// test carries on, so a single run shows every check that fails.
+#include <iostream>
+
+namespace {
+
+int failures = 0;
+
+// The exit code of a test program, after a line saying how it went
+int checkResult(const char* test) {
+    if (failures) {
+        std::cerr << test << ": " << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << test << ": ok" << std::endl;
+    return 0;
+}
+
+} // namespace
+
+#define CHECK(condition)                                                               \
+    do {                                                                               \
+        if (!(condition)) {                                                            \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " << #condition << std::endl; \
+            ++failures;                                                                \
+        }                                                                              \
+    } while (0)
+
+#endif // TESTS_CHECK_H
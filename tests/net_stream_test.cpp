@@ -0,0 +1,185 @@
+// Tests for the analysis stream: the decoder's sequence handling, and whole
+// publisher-to-viewer runs over loopback UDP, TCP and Unix sockets.
+#include "net_stream.h"
+#include "tests/check.h"
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// A frame whose left level tells which one it is
+AnalysisFrame makeFrame(int n) {
+    AnalysisFrame frame;
+    frame.sampleRate = 48000;
+    frame.audioActive = true;
+    frame.rms[0] = (n % 1000) / 1000.0f;
+    frame.rms[1] = 0.5f;
+    frame.peak[0] = frame.peak[1] = 0.75f;
+    for (int band = 0; band < ANALYSIS_BANDS; ++band) frame.bands[0][band] = frame.bands[1][band] = band / 32.0f;
+    for (int i = 0; i < WAVEFORM_POINTS; ++i) frame.waveform[0][i] = frame.waveform[1][i] = std::sin(i * 0.1f + n);
+    return frame;
+}
+
+int frameNumber(const AnalysisFrame& frame) {
+    return static_cast<int>(std::lround(frame.rms[0] * 1000.0f));
+}
+
+struct Packet {
+    uint8_t bytes[STREAM_MAX_PACKET_BYTES];
+    size_t length;
+};
+
+std::vector<Packet> encodeFrames(StreamEncoder& encoder, int first, int count) {
+    std::vector<Packet> packets(count);
+    for (int i = 0; i < count; ++i) {
+        QuantizedFrame quantized;
+        quantizeFrame(makeFrame(first + i), quantized);
+        packets[i].length = encoder.encode(quantized, packets[i].bytes);
+    }
+    return packets;
+}
+
+bool decodeNumber(StreamDecoder& decoder, const Packet& packet, int& number) {
+    QuantizedFrame quantized;
+    if (!decoder.decode(packet.bytes, packet.length, quantized)) return false;
+    AnalysisFrame frame;
+    dequantizeFrame(quantized, frame);
+    number = frameNumber(frame);
+    return true;
+}
+
+void testLateAndLost() {
+    StreamEncoder encoder(StreamEncoder::LAST_KEYFRAME);
+    std::vector<Packet> packets = encodeFrames(encoder, 1, 4);
+    StreamDecoder decoder;
+    int number = 0;
+    CHECK(decodeNumber(decoder, packets[0], number) && number == 1);
+    CHECK(decodeNumber(decoder, packets[2], number) && number == 3);
+    CHECK(!decodeNumber(decoder, packets[1], number));
+    CHECK(decodeNumber(decoder, packets[3], number) && number == 4);
+    CHECK(decoder.stats().late == 1);
+    CHECK(decoder.stats().lost == 1);
+}
+
+// A packet that cannot be decoded must not make the frames before it late
+void testUndecodableKeepsWindow() {
+    StreamEncoder encoder(StreamEncoder::LAST_KEYFRAME);
+    std::vector<Packet> packets = encodeFrames(encoder, 1, 3);
+    StreamDecoder decoder;
+    int number = 0;
+    CHECK(decodeNumber(decoder, packets[0], number));
+    Packet broken = packets[2];
+    broken.bytes[4] = 9;   // Sequence 9...
+    broken.bytes[8] = 7;   // ...against a base nobody sent
+    CHECK(!decodeNumber(decoder, broken, number));
+    CHECK(decoder.stats().undecodable == 1);
+    CHECK(decodeNumber(decoder, packets[1], number) && number == 2);
+    CHECK(decodeNumber(decoder, packets[2], number) && number == 3);
+    CHECK(decoder.stats().late == 0);
+}
+
+void testPublisherRestart() {
+    StreamDecoder decoder;
+    int number = 0;
+    StreamEncoder first(StreamEncoder::LAST_KEYFRAME);
+    for (const Packet& packet : encodeFrames(first, 1, 200)) CHECK(decodeNumber(decoder, packet, number));
+    CHECK(number == 200);
+
+    // Counting from 0 again, far behind: the restart is noticed at once
+    StreamEncoder second(StreamEncoder::LAST_KEYFRAME);
+    std::vector<Packet> packets = encodeFrames(second, 500, 3);
+    CHECK(decodeNumber(decoder, packets[0], number) && number == 500);
+    CHECK(decodeNumber(decoder, packets[1], number) && number == 501);
+    CHECK(decodeNumber(decoder, packets[2], number) && number == 502);
+
+    // Close behind, as after a publisher that only ran briefly: only after a silence
+    StreamEncoder third(StreamEncoder::LAST_KEYFRAME);
+    packets = encodeFrames(third, 700, 2);
+    CHECK(!decodeNumber(decoder, packets[0], number));
+    std::this_thread::sleep_for(STREAM_TIMEOUT + std::chrono::milliseconds(100));
+    CHECK(decodeNumber(decoder, packets[0], number) && number == 700);
+    CHECK(decodeNumber(decoder, packets[1], number) && number == 701);
+}
+
+// A port nothing listens on right now
+std::string freePort(int type) {
+    int fd = socket(AF_INET, type, 0);
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t length = sizeof(address);
+    bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    close(fd);
+    return std::to_string(ntohs(address.sin_port));
+}
+
+// Publishes frame after frame until the viewer shows one numbered at least `wanted`
+bool streamUntil(StreamPublisher& publisher, StreamReceiver& receiver, int first, int wanted) {
+    AnalysisFrame received;
+    for (int n = first; n < first + 200; ++n) {
+        publisher.publish(makeFrame(n));
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        while (receiver.receive(received)) {
+            if (frameNumber(received) >= wanted) return receiver.active();
+        }
+    }
+    return false;
+}
+
+void testLoopback(const std::string& url) {
+    std::string error;
+    auto publisher = std::make_unique<StreamPublisher>();
+    CHECK(publisher->open(url, error));
+    StreamReceiver receiver;
+    CHECK(receiver.open(url, error));
+    CHECK(streamUntil(*publisher, receiver, 1, 100));
+    CHECK(receiver.stats().packets > 0);
+    CHECK(receiver.stats().undecodable == 0);
+
+    // The publisher goes away and comes back with its sequence started over
+    publisher.reset();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    publisher = std::make_unique<StreamPublisher>();
+    CHECK(publisher->open(url, error));
+    if (!streamUntil(*publisher, receiver, 500, 500)) {
+        // Byte streams reconnect once a second
+        std::this_thread::sleep_for(std::chrono::milliseconds(1100));
+        CHECK(streamUntil(*publisher, receiver, 600, 600));
+    }
+}
+
+void testOpenErrors() {
+    std::string error;
+    StreamPublisher publisher;
+    CHECK(!publisher.open("udp://:9", error));
+    CHECK(!publisher.open("carrier-pigeon://home", error));
+    // The port is taken: open fails and leaves nothing behind to publish to
+    StreamPublisher first;
+    const std::string url = "tcp://127.0.0.1:" + freePort(SOCK_STREAM);
+    CHECK(first.open(url, error));
+    StreamPublisher second;
+    CHECK(!second.open(url, error));
+    second.publish(makeFrame(1));
+    CHECK(second.stats().packets == 0);
+}
+
+} // namespace
+
+int main() {
+    testLateAndLost();
+    testUndecodableKeepsWindow();
+    testPublisherRestart();
+    testLoopback("udp://127.0.0.1:" + freePort(SOCK_DGRAM));
+    testLoopback("tcp://127.0.0.1:" + freePort(SOCK_STREAM));
+    testLoopback("unix:///tmp/net_stream_test-" + std::to_string(getpid()) + ".sock");
+    testOpenErrors();
+    return checkResult("net_stream_test");
+}
@@ -0,0 +1,154 @@
+// Regression tests for the WAVE parser: it reads untrusted files for --analyze,
+// --render and --spectrogram, so malformed headers must be refused, not trusted.
+#include "wav_file.h"
+#include "tests/check.h"
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+void putU16(std::vector<uint8_t>& out, uint16_t value) {
+    out.push_back(value & 0xFF);
+    out.push_back(value >> 8);
+}
+
+void putU32(std::vector<uint8_t>& out, uint32_t value) {
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+}
+
+void putTag(std::vector<uint8_t>& out, const char* tag) {
+    out.insert(out.end(), tag, tag + 4);
+}
+
+// A RIFF WAVE file of a fmt chunk (plain, or extensible with `mask`) and a data chunk
+std::vector<uint8_t> makeWave(uint16_t channels, uint16_t bits, const std::vector<uint8_t>& samples,
+                              bool extensible = false, uint32_t mask = 0) {
+    std::vector<uint8_t> format;
+    const uint16_t block = static_cast<uint16_t>(channels * ((bits + 7) / 8));
+    putU16(format, extensible ? 0xFFFE : 1);
+    putU16(format, channels);
+    putU32(format, 48000);
+    putU32(format, 48000u * block);
+    putU16(format, block);
+    putU16(format, bits);
+    if (extensible) {
+        putU16(format, 22);
+        putU16(format, bits);
+        putU32(format, mask);
+        putU16(format, 1);  // KSDATAFORMAT_SUBTYPE_PCM, the rest of the GUID
+        for (int i = 0; i < 14; ++i) format.push_back(0);
+    }
+    std::vector<uint8_t> out;
+    putTag(out, "RIFF");
+    putU32(out, static_cast<uint32_t>(4 + 8 + format.size() + 8 + samples.size()));
+    putTag(out, "WAVE");
+    putTag(out, "fmt ");
+    putU32(out, static_cast<uint32_t>(format.size()));
+    out.insert(out.end(), format.begin(), format.end());
+    putTag(out, "data");
+    putU32(out, static_cast<uint32_t>(samples.size()));
+    out.insert(out.end(), samples.begin(), samples.end());
+    return out;
+}
+
+// Writes `bytes` to a temporary file and opens it
+bool openWave(const std::vector<uint8_t>& bytes, WavFile& wav, std::string& error) {
+    char path[] = "/tmp/wav_file_test.XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) return false;
+    bool written = write(fd, bytes.data(), bytes.size()) == static_cast<ssize_t>(bytes.size());
+    close(fd);
+    bool opened = written && wav.open(path, error);
+    unlink(path);  // The mapping outlives the name
+    return opened;
+}
+
+void testStereo16() {
+    std::vector<uint8_t> samples;
+    for (int i = 0; i < 300; ++i) {
+        putU16(samples, static_cast<uint16_t>(i));
+        putU16(samples, static_cast<uint16_t>(-i));
+    }
+    WavFile wav;
+    std::string error;
+    CHECK(openWave(makeWave(2, 16, samples), wav, error));
+    CHECK(wav.sampleRate() == 48000);
+    CHECK(wav.frames() == 300);
+    CHECK(wav.buffers() == 2);
+    ChannelBuffers buffers;
+    wav.readBuffer(1, buffers);
+    CHECK(buffers.map.channels == 2);
+    CHECK(buffers.data[0][0] == BUFFER_FRAMES);
+    CHECK(buffers.data[1][0] == -BUFFER_FRAMES);
+    CHECK(buffers.data[0][300 - BUFFER_FRAMES] == 0);  // Padded with silence
+}
+
+void testSigned24() {
+    std::vector<uint8_t> samples = {0x00, 0x34, 0x12, 0x00, 0xCC, 0xED};
+    WavFile wav;
+    std::string error;
+    CHECK(openWave(makeWave(1, 24, samples), wav, error));
+    ChannelBuffers buffers;
+    wav.readBuffer(0, buffers);
+    CHECK(buffers.data[0][0] == 0x1234);
+    CHECK(buffers.data[0][1] == -0x1234);
+}
+
+void testExtensibleMask() {
+    std::vector<uint8_t> samples(6 * 2 * 4, 0);
+    WavFile wav;
+    std::string error;
+    // FL FR FC LFE SL SR
+    CHECK(openWave(makeWave(6, 16, samples, true, 0x60F), wav, error));
+    CHECK(wav.channelMap().channels == 6);
+    CHECK(wav.channelMap().position[3] == ChannelPosition::LFE);
+    CHECK(wav.channelMap().position[4] == ChannelPosition::SIDE_LEFT);
+    CHECK(wav.channelMap().position[5] == ChannelPosition::SIDE_RIGHT);
+}
+
+// Once overflowed the channel map on the stack: the mask was expanded before the count was checked
+void testTooManyChannels() {
+    std::vector<uint8_t> samples(20 * 2 * 4, 0);
+    WavFile wav;
+    std::string error;
+    CHECK(!openWave(makeWave(20, 16, samples, true, 0xFFFFF), wav, error));
+    CHECK(error.find("20 channels") != std::string::npos);
+    CHECK(!openWave(makeWave(20, 16, samples), wav, error));
+    CHECK(!openWave(makeWave(0, 16, samples), wav, error));
+}
+
+void testMalformed() {
+    WavFile wav;
+    std::string error;
+    std::vector<uint8_t> good = makeWave(2, 16, std::vector<uint8_t>(64, 0));
+    // Cut inside the fmt chunk: no data chunk is left
+    CHECK(!openWave(std::vector<uint8_t>(good.begin(), good.begin() + 30), wav, error));
+    // Not RIFF at all
+    std::vector<uint8_t> other = good;
+    std::memcpy(other.data(), "RIFX", 4);
+    CHECK(!openWave(other, wav, error));
+    // A block size too small for its channels
+    std::vector<uint8_t> narrow = good;
+    narrow[32] = 1;
+    narrow[33] = 0;
+    CHECK(!openWave(narrow, wav, error));
+    // A data chunk claiming more than the file holds is read up to the end
+    std::vector<uint8_t> streamed = good;
+    streamed[40] = 0xFF;
+    streamed[41] = 0xFF;
+    CHECK(openWave(streamed, wav, error));
+    CHECK(wav.frames() == 16);
+}
+
+} // namespace
+
+int main() {
+    testStereo16();
+    testSigned24();
+    testExtensibleMask();
+    testTooManyChannels();
+    testMalformed();
+    return checkResult("wav_file_test");
+}
@@ -6,8 +6,13 @@
 #include <chrono>
 #include <algorithm>
 #include <random>
+#include <deque>
 #include "config_parser.h"
 #include "visualizer.h"
+#include "expression.h"
+#include "stereo_field.h"
+#include "loudness.h"
+#include "analysis_frame.h"
 
 // VU Meter modes
 enum VuMeterMode {
@@ -16,6 +21,9 @@ enum VuMeterMode {
 };
 VuMeterMode vuMeterMode = VU_RMS; // Default to RMS
 
+const int BAR_SPACING = 1;      // Space between bars
+const float SIMPLIFY_TOLERANCE = 0.05f; // Shape units (outlines span about +/-100)
+
 /**
  * @brief Selects a color pair ID from the gradient list based on amplitude.
  * @param amplitude_percent A normalized amplitude value (0.0f to 1.0f).
@@ -80,6 +88,502 @@ float getIntersectionDist(float ray_x, float ray_y, float p1x, float p1y, float
     return -1.0f;
 }
 
+/**
+ * @brief Unit-circle cos/sin values for `count` evenly spaced angles.
+ *
+ * The radial modes sample the same angles every frame, so the table is
+ * built once per point count instead of calling cosf/sinf per point.
+ */
+struct TrigTable {
+    std::vector<float> cos;
+    std::vector<float> sin;
+};
+
+const TrigTable& getTrigTable(int count) {
+    // A deque keeps earlier tables in place when a new point count is added
+    static std::deque<TrigTable> tables;
+    for (const auto& table : tables) {
+        if (static_cast<int>(table.cos.size()) == count) return table;
+    }
+    const float PI = 3.1415926535f;
+    TrigTable table;
+    table.cos.resize(count);
+    table.sin.resize(count);
+    for (int i = 0; i < count; ++i) {
+        float angle = 2.0f * PI * i / count;
+        table.cos[i] = std::cos(angle);
+        table.sin[i] = std::sin(angle);
+    }
+    tables.push_back(std::move(table));
+    return tables.back();
+}
+
+/**
+ * @brief Screen-space layout of the built-in modes for one window size.
+ *
+ * Everything here depends only on the window dimensions, so it is rebuilt
+ * once per resize (see resizeVisualizers) instead of every frame. Vectors
+ * are refilled in place, so shrinking or re-growing a window reuses their
+ * capacity.
+ */
+struct Geometry {
+    int width = -1;
+    int height = -1;
+    std::vector<int> scopeSample;   // Oscilloscope: first sample index per column
+    std::vector<float> scopeBlend;  // Oscilloscope: interpolation weight per column
+    std::vector<int> barX;          // Bar graph: left edge of each bar
+    std::vector<int> barWidth;      // Bar graph: width of each bar
+    std::vector<float> ellipseX;    // Ellipse: full-radius offset per sample
+    std::vector<float> ellipseY;
+    std::vector<float> eclipseX;    // Eclipse: max-radius offset per point (aspect corrected)
+    std::vector<float> eclipseY;
+};
+Geometry geometry;
+
+// Struct for a single particle in the 'Galaxy' visualizer
+struct Particle {
+    float x, y;     // Position
+    float vx, vy;   // Velocity
+    float life;     // Time remaining
+    float initial_amplitude; // Amplitude at spawn (for color)
+};
+
+/**
+ * @brief Per-mode state whose size follows the quality settings.
+ *
+ * Sized by configureVisualizers() when a config is loaded, so drawing never
+ * allocates. The custom shape buffers are reserved for the largest shape,
+ * so switching between shapes only changes their length.
+ */
+struct ModeState {
+    QualitySettings quality;
+    std::vector<float> eclipseAmplitudes;  // Decaying peaks per eclipse point
+    std::vector<float> eclipseScratch;
+    std::vector<float> barPeakLeft, barPeakRight;   // Decaying peak per bar
+    std::vector<float> barColorLeft, barColorRight; // Smoothed color amplitude per bar
+    std::vector<Particle> particles;
+    std::vector<float> distortAmplitudes;  // Decaying peaks per DISTORT ray
+    std::vector<float> distortScratch;
+    std::vector<float> expandAmplitudes;   // Decaying peaks per EXPAND perimeter point
+
+    // EXPRESSION: per-point inputs and outputs of the compiled formulas (SoA)
+    std::vector<float> exprAngle, exprIndex, exprBand, exprScratch;
+    std::vector<float> exprX, exprY, exprColor;
+    BeatDetector beats;
+
+    // VU meter: displayed level (with decay) and smoothed color amplitude per channel
+    float vuLevelLeft = 0.0f, vuLevelRight = 0.0f;
+    float vuColorLeft = 0.0f, vuColorRight = 0.0f;
+
+    // Channel meter: loudness of every channel and its decaying sample peak on the meter's 0-1 scale
+    LoudnessMeter loudness;
+    float peakHold[MAX_CHANNELS] = {0};
+    StereoFieldAnalyzer stereoField;
+};
+
+// One state per capture source; a deque so selecting never invalidates the others
+std::deque<ModeState> modeStates(1);
+ModeState* modeState = &modeStates.front();
+// The live states while history is being drawn, and a configured state with nothing in it yet
+std::deque<ModeState> heldStates;
+ModeState blankState;
+
+void rebuildGeometry(int width, int height) {
+    geometry.width = width;
+    geometry.height = height;
+
+    // Oscilloscope column -> sample mapping, with linear interpolation
+    geometry.scopeSample.resize(std::max(0, width));
+    geometry.scopeBlend.resize(std::max(0, width));
+    for (int x = 0; x < width; x++) {
+        float sample_pos = (width > 1) ? static_cast<float>(x) / (width - 1) * (BUFFER_FRAMES - 1) : 0.0f;
+        geometry.scopeSample[x] = static_cast<int>(sample_pos);
+        geometry.scopeBlend[x] = sample_pos - geometry.scopeSample[x];
+    }
+
+    // Bar widths, distributing remainder pixels
+    const int bar_count = modeState->quality.barCount;
+    int total_bar_width = std::max(0, width - (BAR_SPACING * (bar_count - 1)));
+    int base_bar_width = total_bar_width / bar_count;
+    int remainder = total_bar_width % bar_count;
+    geometry.barX.resize(bar_count);
+    geometry.barWidth.resize(bar_count);
+    int current_x = 0;
+    for (int bar = 0; bar < bar_count; bar++) {
+        int bar_width = base_bar_width + (bar < remainder ? 1 : 0);
+        geometry.barX[bar] = current_x;
+        geometry.barWidth[bar] = std::max(0, std::min(bar_width, width - current_x)); // Don't draw off-screen
+        current_x += bar_width + BAR_SPACING;
+    }
+
+    const TrigTable& ellipseTrig = getTrigTable(BUFFER_FRAMES);
+    float max_x_radius = (width / 2.0f) - 1;
+    float max_y_radius = (height / 2.0f) - 1;
+    geometry.ellipseX.resize(BUFFER_FRAMES);
+    geometry.ellipseY.resize(BUFFER_FRAMES);
+    for (int i = 0; i < BUFFER_FRAMES; ++i) {
+        geometry.ellipseX[i] = max_x_radius * ellipseTrig.cos[i];
+        geometry.ellipseY[i] = max_y_radius * ellipseTrig.sin[i] * 0.7f; // Y-axis squashed for aspect ratio
+    }
+
+    const int eclipse_points = modeState->quality.eclipsePoints;
+    const TrigTable& eclipseTrig = getTrigTable(eclipse_points);
+    float max_radius = std::min(width / 3.0f, height / 2.0f);
+    geometry.eclipseX.resize(eclipse_points);
+    geometry.eclipseY.resize(eclipse_points);
+    for (int i = 0; i < eclipse_points; ++i) {
+        geometry.eclipseX[i] = eclipseTrig.cos[i] * max_radius;
+        geometry.eclipseY[i] = eclipseTrig.sin[i] * max_radius * 0.6f; // Aspect ratio
+    }
+}
+
+/**
+ * @brief Returns the layout for this window size, rebuilding it only if the size changed.
+ */
+const Geometry& getGeometry(int width, int height) {
+    if (geometry.width != width || geometry.height != height) rebuildGeometry(width, height);
+    return geometry;
+}
+
+/**
+ * @brief Rebuilds all size-dependent caches for a new window size.
+ *
+ * Called once when a resize has settled, so the first frame at the new size
+ * does not pay for the rebuild.
+ */
+void resizeVisualizers(int width, int height) {
+    rebuildGeometry(width, height);
+}
+
+/**
+ * @brief Sizes one source's mode state for the given quality settings.
+ */
+void configureModeState(ModeState& state, const QualitySettings& quality, const std::vector<CustomVisualizer>& customVisualizers) {
+    state.quality = quality;
+    state.eclipseAmplitudes.resize(quality.eclipsePoints, 0.0f);
+    state.eclipseScratch.resize(quality.eclipsePoints);
+    state.barPeakLeft.resize(quality.barCount, 0.0f);
+    state.barPeakRight.resize(quality.barCount, 0.0f);
+    state.barColorLeft.resize(quality.barCount, 0.0f);
+    state.barColorRight.resize(quality.barCount, 0.0f);
+    state.particles.reserve(quality.galaxyMaxParticles);
+    if (state.particles.size() > static_cast<size_t>(quality.galaxyMaxParticles)) {
+        state.particles.resize(quality.galaxyMaxParticles);
+    }
+
+    size_t max_rays = 0, max_perimeter = 0, max_expression_points = 0;
+    for (const auto& viz : customVisualizers) {
+        if (viz.type == ShapeVisualizerType::DISTORT) {
+            max_rays = std::max(max_rays, static_cast<size_t>(viz.numPoints));
+            getTrigTable(viz.numPoints); // Built now rather than on the first frame
+        } else if (viz.type == ShapeVisualizerType::EXPRESSION) {
+            max_expression_points = std::max(max_expression_points, static_cast<size_t>(viz.numPoints));
+            getTrigTable(viz.numPoints);
+        } else {
+            max_perimeter = std::max(max_perimeter, viz.perimeter.size());
+        }
+    }
+    state.distortAmplitudes.reserve(max_rays);
+    state.distortScratch.reserve(max_rays);
+    state.expandAmplitudes.reserve(max_perimeter);
+    for (auto* buffer : {&state.exprAngle, &state.exprIndex, &state.exprBand, &state.exprScratch,
+                         &state.exprX, &state.exprY, &state.exprColor}) {
+        buffer->reserve(max_expression_points);
+    }
+}
+
+/**
+ * @brief Applies the quality settings of a newly loaded config.
+ *
+ * Resizes every mode's preallocated state once, here, rather than checking
+ * sizes each frame. Existing values are kept where the size is unchanged,
+ * so a reload does not make the display jump.
+ */
+void configureVisualizers(const QualitySettings& quality, const std::vector<CustomVisualizer>& customVisualizers) {
+    for (ModeState& state : modeStates) configureModeState(state, quality, customVisualizers);
+    for (ModeState& state : heldStates) configureModeState(state, quality, customVisualizers);
+    configureModeState(blankState, quality, customVisualizers);
+
+    // The bar and eclipse layouts depend on the counts as well as the size
+    if (geometry.width >= 0) rebuildGeometry(geometry.width, geometry.height);
+}
+
+/**
+ * @brief Gives every capture source its own decay, peak and particle state.
+ *
+ * Call once before configureVisualizers(). All sources are drawn at the
+ * same size, so they share one Geometry.
+ */
+void setVisualizerSourceCount(int count) {
+    modeStates.resize(std::max(1, count));
+    modeState = &modeStates.front();
+}
+
+void selectVisualizerSource(int index) {
+    modeState = &modeStates[index];
+}
+
+/**
+ * @brief Sets every source's live state aside while frames from the history are drawn.
+ *
+ * The history is drawn with the same state, started over from blank by
+ * resetVisualizerState(); releasing puts the live state back, so decays
+ * and windows carry on as if the display had never been frozen.
+ */
+void holdVisualizerState() {
+    if (heldStates.empty()) heldStates = modeStates;
+}
+
+void releaseVisualizerState() {
+    if (heldStates.empty()) return;
+    for (size_t i = 0; i < modeStates.size(); ++i) modeStates[i] = heldStates[i];
+    heldStates.clear();
+}
+
+void resetVisualizerState() {
+    *modeState = blankState;
+}
+
+/**
+ * @brief Starts the selected source's running measurements over, as when another mode takes over.
+ *
+ * They are only fed while their mode is shown; carrying on later from the
+ * old window would filter across the gap.
+ */
+void resetMeasurements() {
+    modeState->loudness.reset();
+    std::fill(modeState->peakHold, modeState->peakHold + MAX_CHANNELS, 0.0f);
+    modeState->stereoField.reset();
+    modeState->beats = BeatDetector();
+}
+
+/**
+ * @brief Adds one buffer of the selected source to the expression shapes' beat detector.
+ *
+ * Called for every captured buffer, as the offline analysis does, so an
+ * onset between two drawn frames still makes a beat.
+ */
+void trackBeats(const int16_t* leftData, const int16_t* rightData, uint32_t sampleRate, bool audio_active) {
+    if (!audio_active || sampleRate == 0) {
+        modeState->beats = BeatDetector();
+        return;
+    }
+    modeState->beats.update(beatLevel(leftData, rightData), static_cast<float>(BUFFER_FRAMES) / sampleRate);
+}
+
+/**
+ * @brief Smooths a circular amplitude array in place.
+ *
+ * Each pass is a weighted average: 25% prev, 50% current, 25% next.
+ * `scratch` must be the same size as `values`; it is reused between frames
+ * so smoothing never allocates.
+ */
+void smoothCircular(std::vector<float>& values, std::vector<float>& scratch, int passes) {
+    const int n = static_cast<int>(values.size());
+    if (n < 3) return;
+    for (int pass = 0; pass < passes; ++pass) {
+        scratch[0] = values[n - 1] * 0.25f + values[0] * 0.5f + values[1] * 0.25f;
+        for (int i = 1; i < n - 1; ++i) {
+            scratch[i] = values[i - 1] * 0.25f + values[i] * 0.5f + values[i + 1] * 0.25f;
+        }
+        scratch[n - 1] = values[n - 2] * 0.25f + values[n - 1] * 0.5f + values[0] * 0.25f;
+        values.swap(scratch); // Swap buffers for next pass
+    }
+}
+
+/**
+ * @brief Douglas-Peucker simplification of a closed polygon.
+ *
+ * Drops vertices that lie within `tolerance` of the line through their
+ * neighbours. Dense imported outlines lose most of their points this way
+ * without visibly changing the shape.
+ */
+static void simplifyPolygon(std::vector<std::pair<float, float>>& polygon, float tolerance) {
+    const size_t n = polygon.size();
+    if (n <= 4) return;
+    std::vector<char> keep(n, 0);
+    keep[0] = keep[n / 2] = 1;
+    std::vector<std::pair<size_t, size_t>> stack = {{0, n / 2}, {n / 2, n}};
+    while (!stack.empty()) {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+        const auto& a = polygon[first];
+        const auto& b = polygon[last % n];
+        float dx = b.first - a.first, dy = b.second - a.second;
+        float len = std::sqrt(dx * dx + dy * dy);
+        float max_dist = 0.0f;
+        size_t max_index = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            float px = polygon[i].first - a.first, py = polygon[i].second - a.second;
+            float dist = (len > 0.0f) ? std::fabs(px * dy - py * dx) / len : std::sqrt(px * px + py * py);
+            if (dist > max_dist) { max_dist = dist; max_index = i; }
+        }
+        if (max_dist > tolerance) {
+            keep[max_index] = 1;
+            stack.push_back({first, max_index});
+            stack.push_back({max_index, last});
+        }
+    }
+    size_t out = 0;
+    for (size_t i = 0; i < n; ++i) {
+        if (keep[i]) polygon[out++] = polygon[i];
+    }
+    polygon.resize(out);
+}
+
+/**
+ * @brief Draws a config-defined expression visualizer.
+ *
+ * Band energies are measured the same way as for DISTORT; the compiled
+ * formulas then place and color every point in one batched pass. Their
+ * `time` is the audio's, so a file or a frozen frame draws the same way
+ * however fast it is rendered.
+ */
+static void drawExpressionShape(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData,
+                                const std::vector<int>& colorPairIDs, const CustomVisualizer& visualizer, double time) {
+    if (!visualizer.program) return;
+    ModeState& st = *modeState;
+    const int num_points = visualizer.numPoints;
+    // Capacity was reserved by configureVisualizers(); this only runs when switching shapes
+    if (static_cast<int>(st.exprBand.size()) != num_points) {
+        const float PI = 3.1415926535f;
+        st.exprBand.assign(num_points, 0.0f);
+        st.exprScratch.resize(num_points);
+        st.exprAngle.resize(num_points);
+        st.exprIndex.resize(num_points);
+        st.exprX.resize(num_points);
+        st.exprY.resize(num_points);
+        st.exprColor.resize(num_points);
+        for (int i = 0; i < num_points; ++i) {
+            st.exprAngle[i] = 2.0f * PI * i / num_points;
+            st.exprIndex[i] = static_cast<float>(i);
+        }
+    }
+
+    // Band energy per point, with the usual fast rise and slow decay
+    const float rise_factor = 0.5f;
+    float total_sq = 0.0f;
+    for (int i = 0; i < num_points; ++i) {
+        size_t start_idx = i * BUFFER_FRAMES / num_points;
+        size_t end_idx = (i + 1) * BUFFER_FRAMES / num_points;
+        float sum_sq = 0;
+        int count = 0;
+        for (size_t j = start_idx; j < end_idx; ++j) {
+            float mono_sample = (static_cast<float>(leftData[j]) + static_cast<float>(rightData[j])) / 2.0f;
+            sum_sq += mono_sample * mono_sample;
+            count++;
+        }
+        total_sq += sum_sq;
+        float current_rms = (count > 0) ? sqrtf(sum_sq / count) / 32767.0f : 0.0f;
+        if (current_rms > st.exprBand[i]) st.exprBand[i] += (current_rms - st.exprBand[i]) * rise_factor;
+        else st.exprBand[i] = std::max(0.0f, st.exprBand[i] - decay__factor);
+    }
+    smoothCircular(st.exprBand, st.exprScratch, visualizer.smoothingPasses);
+
+    float level = std::min(1.0f, sqrtf(total_sq / BUFFER_FRAMES) / 32767.0f);
+
+    const TrigTable& trig = getTrigTable(num_points);
+    ExpressionInputs inputs;
+    inputs.angle = st.exprAngle.data();
+    inputs.cosAngle = trig.cos.data();
+    inputs.sinAngle = trig.sin.data();
+    inputs.band = st.exprBand.data();
+    inputs.index = st.exprIndex.data();
+    inputs.time = static_cast<float>(time);
+    inputs.beat = st.beats.beat;
+    inputs.level = level;
+    visualizer.program->run(inputs, num_points, st.exprX.data(), st.exprY.data(), st.exprColor.data());
+
+    // Formulas work in the same +/-100 space as the polygon shapes
+    float scale = std::min(width, height) / 200.0f;
+    int centerX = width / 2;
+    int centerY = height / 2;
+    for (int i = 0; i < num_points; ++i) {
+        float x = st.exprX[i] * scale;
+        float y = st.exprY[i] * scale * 0.6f; // Aspect ratio correction
+        if (!std::isfinite(x) || !std::isfinite(y)) continue;
+        // Compare as floats first so huge values cannot overflow the int conversion
+        if (std::fabs(x) > width || std::fabs(y) > height) continue;
+        int screen_x = centerX + static_cast<int>(x);
+        int screen_y = centerY + static_cast<int>(y);
+        if (screen_x >= 0 && screen_x < width && screen_y >= 0 && screen_y < height) {
+            float amplitude = std::isfinite(st.exprColor[i]) ? st.exprColor[i] : 0.0f;
+            mvwaddch(win, screen_y, screen_x, '.' | COLOR_PAIR(selectColorByAmplitude(amplitude, colorPairIDs)));
+        }
+    }
+}
+
+/**
+ * @brief Precomputes the DISTORT ray table for a custom visualizer.
+ *
+ * The polygons never change after loading, so the distance from the center to
+ * the nearest edge along each ray is cast once here instead of every frame.
+ * Shapes loaded from the ShapeCache already carry their ray table and skip
+ * the casting.
+ */
+void prepareCustomVisualizer(CustomVisualizer& visualizer) {
+    // EXPRESSION: formulas restored from the shape cache still need compiling
+    if (visualizer.type == ShapeVisualizerType::EXPRESSION) {
+        if (!visualizer.program) {
+            auto program = std::make_shared<ExpressionProgram>();
+            std::string error;
+            int slot;
+            size_t offset;
+            if (program->compile(visualizer.expressions.data(), error, slot, offset)) visualizer.program = program;
+        }
+        return;
+    }
+
+    // EXPAND: subdivide every side of every polygon once, in shape space
+    visualizer.perimeter.clear();
+    if (visualizer.type == ShapeVisualizerType::EXPAND) {
+        for (const auto& polygon : visualizer.polygons) {
+            if (polygon.size() < 2) continue;
+            for (size_t side = 0; side < polygon.size(); ++side) {
+                auto p1 = polygon[side]; // Start vertex of the side
+                auto p2 = polygon[(side + 1) % polygon.size()]; // End vertex
+                for (int i = 0; i < visualizer.pointsPerVertexSide; ++i) {
+                    // 't' is the position between p1 and p2 (0.0 to 1.0)
+                    float t = static_cast<float>(i) / visualizer.pointsPerVertexSide;
+                    visualizer.perimeter.push_back({p1.first + t * (p2.first - p1.first),
+                                                    p1.second + t * (p2.second - p1.second)});
+                }
+            }
+        }
+    }
+
+    const int ray_count = visualizer.numPoints;
+    if (visualizer.rayDistances.size() == static_cast<size_t>(ray_count)) return;
+    visualizer.rayDistances.assign(ray_count, -1.0f);
+    if (visualizer.type != ShapeVisualizerType::DISTORT) return;
+    // Angles are computed directly rather than through getTrigTable(), so
+    // this can run on the config reload thread while frames are drawn.
+    const float PI = 3.1415926535f;
+    for (int i = 0; i < ray_count; ++i) {
+        float angle = 2.0f * PI * i / ray_count;
+        float ray_x = std::cos(angle);
+        float ray_y = std::sin(angle);
+        float min_dist = -1.0f;
+        // Check this ray against every line segment in every polygon
+        for (const auto& polygon : visualizer.polygons) {
+            for (size_t v = 0; v < polygon.size(); ++v) {
+                auto p1 = polygon[v];
+                auto p2 = polygon[(v + 1) % polygon.size()];
+                float dist = getIntersectionDist(ray_x, ray_y, p1.first, p1.second, p2.first, p2.second);
+                // If we found an intersection, see if it's the closest one yet
+                if (dist > 0 && (min_dist < 0 || dist < min_dist)) {
+                    min_dist = dist;
+                }
+            }
+        }
+        visualizer.rayDistances[i] = min_dist;
+    }
+
+    // DISTORT only draws along the rays, so its outline can be thinned for
+    // the cache; EXPAND spaces its points per vertex and keeps every one
+    for (auto& polygon : visualizer.polygons) simplifyPolygon(polygon, SIMPLIFY_TOLERANCE);
+}
+
 /**
  * @brief Draws a custom shape defined in the config file.
  *
@@ -90,20 +594,33 @@ float getIntersectionDist(float ray_x, float ray_y, float p1x, float p1y, float
  * divided by frequency, and the amplitude of each frequency band
  * "pushes" that part of the shape outwards.
  */
-void drawCustomShape(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs, const CustomVisualizer& visualizer) {
+void drawCustomShape(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs, const CustomVisualizer& visualizer, double time) {
     int centerX = width / 2;
     int centerY = height / 2;
 
+    if (visualizer.type == ShapeVisualizerType::EXPRESSION) {
+        drawExpressionShape(win, width, height, leftData, rightData, colorPairIDs, visualizer, time);
+        return;
+    }
+
     // --- START OF MODIFICATION for 'distort' ---
     if (visualizer.type == ShapeVisualizerType::DISTORT) {
         if (visualizer.polygons.empty()) return;
 
         // 1. Use frequency bins and decay, just like 'eclipse'
-        const int num_points = 128; // Number of rays/frequency bins
-        static std::vector<float> pointAmplitudes(num_points, 0.0f); // Decaying peaks
+        const int num_points = visualizer.numPoints; // Number of rays/frequency bins
+        std::vector<float>& pointAmplitudes = modeState->distortAmplitudes; // Decaying peaks
+        std::vector<float>& tempAmplitudes = modeState->distortScratch;
+        // Capacity was reserved by configureVisualizers(); this only changes the length
+        if (static_cast<int>(pointAmplitudes.size()) != num_points) {
+            pointAmplitudes.assign(num_points, 0.0f);
+            tempAmplitudes.resize(num_points);
+        }
         const float rise_factor = 0.5f;
-        const float PI = 3.1415926535f;
         float scale = std::min(width, height) / 200.0f; // Base scaling factor
+        const std::vector<float>& rayDistances = visualizer.rayDistances;
+        if (static_cast<int>(rayDistances.size()) != num_points) return; // Not prepared by prepareCustomVisualizer()
+        const TrigTable& rays = getTrigTable(num_points);
 
         // Calculate RMS for each frequency bin and apply decay
         for (int i = 0; i < num_points; ++i) {
@@ -122,60 +639,28 @@ void drawCustomShape(WINDOW *win, int width, int height, const int16_t* leftData
         }
 
         // 2. Apply smoothing passes for a "wavy" effect
-        const int smoothing_passes = 2;
-        std::vector<float> tempAmplitudes(num_points);
-        std::vector<float>* readBuffer = &pointAmplitudes;
-        std::vector<float>* writeBuffer = &tempAmplitudes;
-        for (int pass = 0; pass < smoothing_passes; ++pass) {
-            for (int i = 0; i < num_points; ++i) {
-                int prev_idx = (i == 0) ? num_points - 1 : i - 1;
-                int next_idx = (i == num_points - 1) ? 0 : i + 1;
-                // Weighted average: 25% prev, 50% current, 25% next
-                (*writeBuffer)[i] = ((*readBuffer)[prev_idx] * 0.25f) + ((*readBuffer)[i] * 0.5f) + ((*readBuffer)[next_idx] * 0.25f);
-            }
-            std::swap(readBuffer, writeBuffer); // Swap buffers for next pass
-        }
-        if (readBuffer != &pointAmplitudes) pointAmplitudes = *readBuffer; // Ensure pointAmplitudes has final data
+        smoothCircular(pointAmplitudes, tempAmplitudes, visualizer.smoothingPasses);
 
-        // 3. Render the shape using ray-casting
+        // 3. Render the shape from the precomputed ray/edge distances
         for (int i = 0; i < num_points; ++i) {
             float amplitude = pointAmplitudes[i]; // Get the smoothed amplitude for this angle
-            float angle = 2.0f * PI * i / num_points;
-            
-            float ray_x = std::cos(angle);
-            float ray_y = std::sin(angle);
-            float min_dist = -1.0f; // Shortest distance to any polygon edge
-
-            // Check this ray against every line segment in every polygon
-            for (const auto& polygon : visualizer.polygons) {
-                for (size_t v = 0; v < polygon.size(); ++v) {
-                    auto p1 = polygon[v];
-                    auto p2 = polygon[(v + 1) % polygon.size()];
-                    float dist = getIntersectionDist(ray_x, ray_y, p1.first, p1.second, p2.first, p2.second);
-                    // If we found an intersection, see if it's the closest one yet
-                    if (dist > 0 && (min_dist < 0 || dist < min_dist)) {
-                        min_dist = dist;
-                    }
-                }
-            }
+            float min_dist = rayDistances[i]; // Shortest distance to any polygon edge
 
-            // If we found an intersection (min_dist > 0)
+            // If the ray hit the shape (min_dist > 0)
             if (min_dist > 0) {
                 // *** THIS IS THE FIX for the collapsing shape ***
                 // We use (1.0f + ...), so when amplitude is 0, it draws the base shape (1.0f).
                 // It expands outwards with audio (1.0f + amplitude * 1.5f)
                 float final_dist = scale * min_dist * (1.0f + amplitude * 1.5f);
                 
-                float x = final_dist * ray_x;
-                float y = final_dist * ray_y;
+                float x = final_dist * rays.cos[i];
+                float y = final_dist * rays.sin[i];
                 
                 int colorPairID = selectColorByAmplitude(amplitude, colorPairIDs);
                 int screen_x = centerX + static_cast<int>(x);
                 int screen_y = centerY + static_cast<int>(y * 0.6f); // Aspect ratio correction
                 if (screen_x >= 0 && screen_x < width && screen_y >= 0 && screen_y < height) {
-                    wattron(win, COLOR_PAIR(colorPairID));
-                    mvwaddch(win, screen_y, screen_x, '.');
-                    wattroff(win, COLOR_PAIR(colorPairID));
+                    mvwaddch(win, screen_y, screen_x, '.' | COLOR_PAIR(colorPairID));
                 }
             }
         }
@@ -188,10 +673,9 @@ void drawCustomShape(WINDOW *win, int width, int height, const int16_t* leftData
         for (const auto& poly : visualizer.polygons) total_vertices += poly.size();
         if (total_vertices < 2) return;
 
-        // Subdivide the perimeter to get more points for frequencies
-        const size_t points_per_vertex_side = 40;
-        const size_t total_points = total_vertices * points_per_vertex_side;
-        static std::vector<float> pointAmplitudes; // Holds the decaying amplitude for each point
+        // The perimeter was subdivided once by prepareCustomVisualizer()
+        const size_t total_points = total_vertices * visualizer.pointsPerVertexSide;
+        std::vector<float>& pointAmplitudes = modeState->expandAmplitudes; // Holds the decaying amplitude for each point
         if(pointAmplitudes.size() != total_points) pointAmplitudes.resize(total_points, 0.0f);
 
         const float rise_factor = 0.5f; // How fast the points react to new peaks
@@ -217,56 +701,29 @@ void drawCustomShape(WINDOW *win, int width, int height, const int16_t* leftData
         }
 
         float scale = std::min(width, height) / 250.0f; // Base scaling factor
-        size_t amplitude_idx_offset = 0;
-        
-        // Iterate through all polygons and their sides
-        for (const auto& polygon : visualizer.polygons) {
-            if (polygon.size() < 2) continue;
-            for (size_t side = 0; side < polygon.size(); ++side) {
-                auto p1 = polygon[side]; // Start vertex of the side
-                auto p2 = polygon[(side + 1) % polygon.size()]; // End vertex
+        const auto& perimeter = visualizer.perimeter;
+        const size_t drawn_points = std::min(total_points, perimeter.size());
 
-                // Draw all the points along this side
-                for (size_t i = 0; i < points_per_vertex_side; ++i) {
-                    // 't' is the position between p1 and p2 (0.0 to 1.0)
-                    float t = static_cast<float>(i) / points_per_vertex_side;
-                    // Find the base (un-expanded) point via linear interpolation
-                    float base_x = p1.first + t * (p2.first - p1.first);
-                    float base_y = p1.second + t * (p2.second - p1.second);
-                    
-                    // Get the amplitude for this specific point
-                    size_t amplitude_index = amplitude_idx_offset + side * points_per_vertex_side + i;
-                    if(amplitude_index >= total_points) continue;
-                    float amplitude = pointAmplitudes[amplitude_index];
-                    
-                    // Scale the base point outwards by its amplitude
-                    // (1.0f + ...) ensures it defaults to 1.0f size when amplitude is 0.
-                    float x = base_x * scale * (1.0f + amplitude * 0.5f);
-                    float y = base_y * scale * (1.0f + amplitude * 0.5f);
-                    
-                    int colorPairID = selectColorByAmplitude(amplitude, colorPairIDs);
-                    int screen_x = centerX + static_cast<int>(x);
-                    int screen_y = centerY + static_cast<int>(y * 0.6f); // Aspect ratio correction
-                    if (screen_x >= 0 && screen_x < width && screen_y >= 0 && screen_y < height) {
-                        wattron(win, COLOR_PAIR(colorPairID));
-                        mvwaddch(win, screen_y, screen_x, '.');
-                        wattroff(win, COLOR_PAIR(colorPairID));
-                    }
-                }
+        // Draw all the points along the perimeter
+        for (size_t i = 0; i < drawn_points; ++i) {
+            float amplitude = pointAmplitudes[i];
+            
+            // Scale the base point outwards by its amplitude
+            // (1.0f + ...) ensures it defaults to 1.0f size when amplitude is 0.
+            float expand = scale * (1.0f + amplitude * 0.5f);
+            float x = perimeter[i].first * expand;
+            float y = perimeter[i].second * expand;
+            
+            int colorPairID = selectColorByAmplitude(amplitude, colorPairIDs);
+            int screen_x = centerX + static_cast<int>(x);
+            int screen_y = centerY + static_cast<int>(y * 0.6f); // Aspect ratio correction
+            if (screen_x >= 0 && screen_x < width && screen_y >= 0 && screen_y < height) {
+                mvwaddch(win, screen_y, screen_x, '.' | COLOR_PAIR(colorPairID));
             }
-            amplitude_idx_offset += polygon.size() * points_per_vertex_side;
         }
     }
 }
 
-// Struct for a single particle in the 'Galaxy' visualizer
-struct Particle {
-    float x, y;     // Position
-    float vx, vy;   // Velocity
-    float life;     // Time remaining
-    float initial_amplitude; // Amplitude at spawn (for color)
-};
-
 /**
  * @brief Draws a particle fountain effect.
  *
@@ -274,14 +731,14 @@ struct Particle {
  * Particles fly upwards and outwards, affected by "gravity", and fade over time.
  */
 void drawGalaxy(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs, bool audio_active) {
-    static std::vector<Particle> particles;
+    std::vector<Particle>& particles = modeState->particles; // Reserved by configureVisualizers()
     // Random number generators for particle properties
     static std::mt19937 generator(std::chrono::system_clock::now().time_since_epoch().count());
     static std::uniform_real_distribution<float> dis_angle(0.0f, 2.0f * 3.1415926535f);
     static std::uniform_real_distribution<float> dis_velocity(0.5f, 1.5f);
     static std::uniform_real_distribution<float> dis_life(0.5f, 1.5f);
 
-    const int max_particles = 1000;
+    const size_t max_particles = modeState->quality.galaxyMaxParticles;
     const float particle_spawn_rate_factor = 0.05f;
     const float particle_life_decay_rate = 0.03f;
     const float base_spawn_y = height * 0.9f;
@@ -313,8 +770,8 @@ void drawGalaxy(WINDOW *win, int width, int height, const int16_t* leftData, con
         }
     }
 
-    // Update and draw all existing particles
-    std::vector<Particle> active_particles;
+    // Update and draw all existing particles, compacting the live ones in place
+    size_t alive = 0;
     for (auto& p : particles) {
         // Basic physics update
         p.x += p.vx;
@@ -324,17 +781,15 @@ void drawGalaxy(WINDOW *win, int width, int height, const int16_t* leftData, con
 
         // If particle is still alive and on-screen, draw it
         if (p.life > 0.0f && p.x >= 0 && p.x < width && p.y >= 0 && p.y < height) {
-            active_particles.push_back(p);
+            particles[alive++] = p;
             // Color fades as the particle dies
             float display_amplitude = p.initial_amplitude * (p.life / dis_life.b());
             int colorPairID = selectColorByAmplitude(display_amplitude, colorPairIDs);
-            wattron(win, COLOR_PAIR(colorPairID));
-            mvwaddch(win, static_cast<int>(p.y), static_cast<int>(p.x), ACS_DIAMOND);
-            wattroff(win, COLOR_PAIR(colorPairID));
+            mvwaddch(win, static_cast<int>(p.y), static_cast<int>(p.x), ACS_DIAMOND | COLOR_PAIR(colorPairID));
         }
     }
-    // Replace the old particle list with the new list of active particles
-    particles = active_particles;
+    // Drop the dead particles; capacity is kept so spawning never reallocates
+    particles.resize(alive);
 }
 
 /**
@@ -346,15 +801,15 @@ void drawGalaxy(WINDOW *win, int width, int height, const int16_t* leftData, con
 void drawOscilloscope(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs, int edgePairID) {
     int channelHeight = height / 2;
     int rightChannelOffset = channelHeight;
+    const Geometry& geo = getGeometry(width, height);
 
     // Iterate over every column (x-pixel) in the window
     for (int x = 0; x < width; x++) {
         // Find the corresponding sample in the audio buffer.
         // This includes linear interpolation for a smoother look.
-        float sample_pos = static_cast<float>(x) / (width - 1) * (BUFFER_FRAMES - 1);
-        int sample_idx1 = static_cast<int>(sample_pos);
+        int sample_idx1 = geo.scopeSample[x];
         int sample_idx2 = std::min(sample_idx1 + 1, BUFFER_FRAMES - 1);
-        float blend = sample_pos - sample_idx1;
+        float blend = geo.scopeBlend[x];
 
         // Interpolate to find the exact sample value for this 'x' position
         int16_t left_sample = static_cast<int16_t>(leftData[sample_idx1] * (1.0f - blend) + leftData[sample_idx2] * blend);
@@ -374,15 +829,11 @@ void drawOscilloscope(WINDOW *win, int width, int height, const int16_t* leftDat
         
         // Draw the left channel point
         int pairID_l = selectColorByAmplitude(left_amplitude, colorPairIDs);
-        wattron(win, COLOR_PAIR(pairID_l));
-        mvwaddch(win, y_left, x, ACS_VLINE);
-        wattroff(win, COLOR_PAIR(pairID_l));
+        mvwaddch(win, y_left, x, ACS_VLINE | COLOR_PAIR(pairID_l));
 
         // Draw the right channel point (offset by channelHeight)
         int pairID_r = selectColorByAmplitude(right_amplitude, colorPairIDs);
-        wattron(win, COLOR_PAIR(pairID_r));
-        mvwaddch(win, y_right + rightChannelOffset, x, ACS_VLINE);
-        wattroff(win, COLOR_PAIR(pairID_r));
+        mvwaddch(win, y_right + rightChannelOffset, x, ACS_VLINE | COLOR_PAIR(pairID_r));
     }
 }
 
@@ -394,8 +845,10 @@ void drawOscilloscope(WINDOW *win, int width, int height, const int16_t* leftDat
  */
 void drawVuMeter(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs, bool audio_active) {
     // 'Level' is the displayed level (with decay), 'ColorDecay' is for smooth color fading
-    static float leftLevel = 0.0f, rightLevel = 0.0f;
-    static float leftColorDecay = 0.0f, rightColorDecay = 0.0f;
+    float& leftLevel = modeState->vuLevelLeft;
+    float& rightLevel = modeState->vuLevelRight;
+    float& leftColorDecay = modeState->vuColorLeft;
+    float& rightColorDecay = modeState->vuColorRight;
     const float color_decay_rate = 0.025f;
 
     // Reset levels if audio disconnects
@@ -447,24 +900,16 @@ void drawVuMeter(WINDOW *win, int width, int height, const int16_t* leftData, co
 
     // Draw the left channel bar (top)
     if (left_bar_width > 0) {
-        wattron(win, COLOR_PAIR(leftPairID));
         for (int y = 0; y < channelHeight; y++) {
-            for (int x = 0; x < left_bar_width; x++) {
-                mvwaddch(win, y, x, ACS_BLOCK);
-            }
+            mvwhline(win, y, 0, ACS_BLOCK | COLOR_PAIR(leftPairID), left_bar_width);
         }
-        wattroff(win, COLOR_PAIR(leftPairID));
     }
 
     // Draw the right channel bar (bottom, aligned to the right)
     if (right_bar_width > 0) {
-        wattron(win, COLOR_PAIR(rightPairID));
         for (int y = 0; y < channelHeight; y++) {
-            for (int x = width - right_bar_width; x < width; x++) {
-                mvwaddch(win, y + channelHeight, x, ACS_BLOCK);
-            }
+            mvwhline(win, y + channelHeight, width - right_bar_width, ACS_BLOCK | COLOR_PAIR(rightPairID), right_bar_width);
         }
-        wattroff(win, COLOR_PAIR(rightPairID));
     }
 }
 
@@ -476,12 +921,13 @@ void drawVuMeter(WINDOW *win, int width, int height, const int16_t* leftData, co
  * (bars go down), Right channel is on bottom (bars go up).
  */
 void drawBarGraph(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs, bool audio_active) {
-    const int num_bars = 32; // How many frequency bins
-    const int spacing = 1;   // Space between bars
+    const int num_bars = modeState->quality.barCount; // How many frequency bins
     // 'peakHeights' holds the decaying peak for each bar
-    static std::vector<float> leftPeakHeights(num_bars, 0.0f), rightPeakHeights(num_bars, 0.0f);
+    std::vector<float>& leftPeakHeights = modeState->barPeakLeft;
+    std::vector<float>& rightPeakHeights = modeState->barPeakRight;
     // 'colorDecay' is for smooth color fading for each bar
-    static std::vector<float> leftColorDecay(num_bars, 0.0f), rightColorDecay(num_bars, 0.0f);
+    std::vector<float>& leftColorDecay = modeState->barColorLeft;
+    std::vector<float>& rightColorDecay = modeState->barColorRight;
     const float color_decay_rate = 0.025f;
 
     // Reset peaks if audio disconnects
@@ -492,15 +938,12 @@ void drawBarGraph(WINDOW *win, int width, int height, const int16_t* leftData, c
         std::fill(rightColorDecay.begin(), rightColorDecay.end(), 0.0f);
     }
 
-    // Calculate bar width, distributing remainder pixels
-    int total_bar_width = std::max(0, width - (spacing * (num_bars - 1)));
-    int base_bar_width = total_bar_width / num_bars;
-    int remainder = total_bar_width % num_bars;
+    // Bar positions and widths only change on resize
+    const Geometry& geo = getGeometry(width, height);
     int channelHeight = height / 2;
 
     // Lambda function to process and draw one channel (L or R)
     auto process_channel = [&](const int16_t* data, std::vector<float>& peakHeights, std::vector<float>& colorDecay, int y_offset, bool is_top_channel) {
-        int current_x = 0;
         for (int bar = 0; bar < num_bars; bar++) {
             // Find the slice of the audio buffer for this frequency bin
             int start_idx = bar * BUFFER_FRAMES / num_bars;
@@ -524,22 +967,17 @@ void drawBarGraph(WINDOW *win, int width, int height, const int16_t* leftData, c
             int pairID = getFadedColorPairID(peakHeights[bar], colorDecay[bar], colorPairIDs, color_decay_rate);
             // Scale bar height, with a multiplier to make quiet sounds visible
             int bar_height = std::min(channelHeight, static_cast<int>(peakHeights[bar] * channelHeight * 1.5f));
-            int bar_width = base_bar_width + (bar < remainder ? 1 : 0); // Add remainder
+            int bar_width = geo.barWidth[bar];
+            int current_x = geo.barX[bar];
 
             // Draw the bar
-            if (bar_height > 0 && bar_width > 0 && current_x < width) {
-                bar_width = std::min(bar_width, width - current_x); // Don't draw off-screen
-                wattron(win, COLOR_PAIR(pairID));
+            if (bar_height > 0 && bar_width > 0) {
+                // Top channel grows up from the middle, bottom channel grows down from it
+                int y_start = is_top_channel ? y_offset + channelHeight - bar_height : y_offset;
                 for (int col = 0; col < bar_width; col++) {
-                    for (int y = 0; y < bar_height; y++) {
-                        // Top channel draws from top-down, bottom channel draws from bottom-up
-                        int y_pos = is_top_channel ? y_offset + channelHeight - 1 - y : y_offset + y;
-                        mvwaddch(win, y_pos, current_x + col, ACS_BLOCK);
-                    }
+                    mvwvline(win, y_start, current_x + col, ACS_BLOCK | COLOR_PAIR(pairID), bar_height);
                 }
-                wattroff(win, COLOR_PAIR(pairID));
             }
-            current_x += bar_width + (bar < num_bars - 1 ? spacing : 0);
         }
     };
 
@@ -558,30 +996,24 @@ void drawBarGraph(WINDOW *win, int width, int height, const int16_t* leftData, c
 void drawEllipse(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs) {
     int centerX = width / 2;
     int centerY = height / 2;
-    const float PI = 3.1415926535f;
-    float max_x_radius = (width / 2.0f) - 1;
-    float max_y_radius = (height / 2.0f) - 1;
+    const Geometry& geo = getGeometry(width, height);
 
     // Iterate through each sample in the buffer
     for (int i = 0; i < BUFFER_FRAMES; ++i) {
         float mono_sample = (static_cast<float>(leftData[i]) + static_cast<float>(rightData[i])) / 2.0f;
         // 'radius' is the normalized amplitude
         float radius = std::abs(mono_sample) / 32767.0f;
-        // 'angle' maps the sample's position to an angle
-        float angle = (2.0f * PI * i) / BUFFER_FRAMES;
-        
-        // Calculate the point's position
-        float y = radius * max_y_radius * sinf(angle) * 0.7f; // Y-axis squashed for aspect ratio
-        float x = radius * max_x_radius * cosf(angle);
+        // The sample's position in the buffer maps to an angle; the
+        // full-radius offsets for each angle are cached per window size
+        float y = radius * geo.ellipseY[i];
+        float x = radius * geo.ellipseX[i];
         
         int colorPairID = selectColorByAmplitude(radius, colorPairIDs);
         int screen_x = centerX + static_cast<int>(x);
         int screen_y = centerY + static_cast<int>(y);
         
         if (screen_x >= 0 && screen_x < width && screen_y >= 0 && screen_y < height) {
-            wattron(win, COLOR_PAIR(colorPairID));
-            mvwaddch(win, screen_y, screen_x, '.');
-            wattroff(win, COLOR_PAIR(colorPairID));
+            mvwaddch(win, screen_y, screen_x, '.' | COLOR_PAIR(colorPairID));
         }
     }
 }
@@ -595,13 +1027,13 @@ void drawEllipse(WINDOW *win, int width, int height, const int16_t* leftData, co
  * The shape is smoothed to look less spiky.
  */
 void drawEclipse(WINDOW *win, int width, int height, const int16_t* leftData, const int16_t* rightData, const std::vector<int>& colorPairIDs) {
-    const int num_points = 128; // Number of angular/frequency bins
-    static std::vector<float> pointAmplitudes(num_points, 0.0f); // Decaying peaks
+    const int num_points = modeState->quality.eclipsePoints; // Number of angular/frequency bins
+    std::vector<float>& pointAmplitudes = modeState->eclipseAmplitudes; // Decaying peaks
+    std::vector<float>& tempAmplitudes = modeState->eclipseScratch;
     const float rise_factor = 0.5f;
-    const float PI = 3.1415926535f;
+    const Geometry& geo = getGeometry(width, height);
     int centerX = width / 2;
     int centerY = height / 2;
-    float max_radius = std::min(width / 3.0f, height / 2.0f);
 
     // Calculate RMS for each frequency bin and apply decay
     for (int i = 0; i < num_points; ++i) {
@@ -623,49 +1055,194 @@ void drawEclipse(WINDOW *win, int width, int height, const int16_t* leftData, co
     // --- Smoothing ---
     // This averages adjacent points to make the shape smoother.
     // It runs multiple passes for a softer look.
-    const int smoothing_passes = 2;
-    std::vector<float> tempAmplitudes(num_points);
-    std::vector<float>* readBuffer = &pointAmplitudes;
-    std::vector<float>* writeBuffer = &tempAmplitudes;
-    for (int pass = 0; pass < smoothing_passes; ++pass) {
-        for (int i = 0; i < num_points; ++i) {
-            int prev_idx = (i == 0) ? num_points - 1 : i - 1;
-            int next_idx = (i == num_points - 1) ? 0 : i + 1;
-            // Weighted average: 25% prev, 50% current, 25% next
-            (*writeBuffer)[i] = ((*readBuffer)[prev_idx] * 0.25f) + ((*readBuffer)[i] * 0.5f) + ((*readBuffer)[next_idx] * 0.25f);
-        }
-        std::swap(readBuffer, writeBuffer); // Swap buffers for next pass
-    }
-    if (readBuffer != &pointAmplitudes) pointAmplitudes = *readBuffer; // Ensure pointAmplitudes has final data
+    smoothCircular(pointAmplitudes, tempAmplitudes, modeState->quality.eclipseSmoothingPasses);
 
     // Draw the shape
     for (int i = 0; i < num_points; ++i) {
-        float angle = 2.0f * PI * i / num_points;
         float amplitude = pointAmplitudes[i];
         
-        // Calculate an outer and inner radius to give the shape "thickness"
-        float radius = max_radius * (0.4f + amplitude * 1.5f);
-        float inner_radius = max_radius * (0.2f + amplitude * 0.5f);
+        // Calculate an outer and inner radius (relative to max_radius) to give the shape "thickness"
+        float radius = 0.4f + amplitude * 1.5f;
+        float inner_radius = 0.2f + amplitude * 0.5f;
         
-        int x = static_cast<int>(centerX + cosf(angle) * radius);
-        int y = static_cast<int>(centerY + sinf(angle) * radius * 0.6); // Aspect ratio
-        int inner_x = static_cast<int>(centerX + cosf(angle) * inner_radius);
-        int inner_y = static_cast<int>(centerY + sinf(angle) * inner_radius * 0.6); // Aspect ratio
+        int x = static_cast<int>(centerX + geo.eclipseX[i] * radius);
+        int y = static_cast<int>(centerY + geo.eclipseY[i] * radius);
+        int inner_x = static_cast<int>(centerX + geo.eclipseX[i] * inner_radius);
+        int inner_y = static_cast<int>(centerY + geo.eclipseY[i] * inner_radius);
         
         int colorPairID = selectColorByAmplitude(amplitude, colorPairIDs);
         
         // Draw outer point
         if (x >= 0 && x < width && y >= 0 && y < height) {
-            wattron(win, COLOR_PAIR(colorPairID));
-            mvwaddch(win, y, x, ACS_DIAMOND);
-            wattroff(win, COLOR_PAIR(colorPairID));
+            mvwaddch(win, y, x, ACS_DIAMOND | COLOR_PAIR(colorPairID));
         }
         // Draw inner point
         if (inner_x >= 0 && inner_x < width && inner_y >= 0 && inner_y < height) {
-            wattron(win, COLOR_PAIR(colorPairID));
-            mvwaddch(win, inner_y, inner_x, '.');
-            wattroff(win, COLOR_PAIR(colorPairID));
+            mvwaddch(win, inner_y, inner_x, '.' | COLOR_PAIR(colorPairID));
+        }
+    }
+}
+
+namespace {
+
+const float METER_FLOOR_DB = -60.0f;
+
+// Position of a level in dB on the meter, 0 at the floor and 1 at full scale
+float meterFraction(float db) {
+    return std::max(0.0f, std::min(1.0f, (db - METER_FLOOR_DB) / -METER_FLOOR_DB));
+}
+
+} // namespace
+
+/**
+ * @brief Adds one buffer of the selected source to its channel meter.
+ *
+ * Called for every captured buffer, drawn or not: the loudness window
+ * holds 400 ms of contiguous audio and the K-weighting filters run across
+ * buffer boundaries, so skipping buffers would give neither. The peak
+ * marker keeps the highest peak since it was last drawn.
+ */
+void meterChannels(const ChannelBuffers& channels, uint32_t sampleRate, bool audio_active) {
+    LoudnessMeter& meter = modeState->loudness;
+    float* peakHold = modeState->peakHold;
+    if (!audio_active || sampleRate == 0) {
+        resetMeasurements();
+        return;
+    }
+    if (meter.addBuffer(channels, sampleRate)) std::fill(peakHold, peakHold + MAX_CHANNELS, 0.0f);
+    for (int c = 0; c < channels.map.channels; ++c) peakHold[c] = std::max(peakHold[c], meterFraction(meter.peakDb(c)));
+}
+
+/**
+ * @brief Meters every captured channel: momentary loudness and sample peak.
+ *
+ * One vertical bar per channel, labelled with its speaker position, shows
+ * the channel's K-weighted loudness over the last 400 ms; a marker above it
+ * holds the sample peak. The top line gives the momentary loudness of all
+ * channels together, weighted as BS.1770 does (the LFE is left out).
+ * Only shows what meterChannels() measured; the peak marker decays per frame.
+ */
+void drawChannelMeter(WINDOW *win, int width, int height, const ChannelBuffers& channels, uint32_t sampleRate,
+                      const std::vector<int>& colorPairIDs, bool audio_active) {
+    const LoudnessMeter& meter = modeState->loudness;
+    float* peakHold = modeState->peakHold;
+    const ChannelMap& map = channels.map;
+    if (sampleRate == 0 || !audio_active) return;
+
+    float channel_loudness[MAX_CHANNELS];
+    for (int c = 0; c < map.channels; ++c) channel_loudness[c] = meter.channelLoudness(c);
+    float momentary = meter.momentary();
+
+    if (std::isfinite(momentary)) mvwprintw(win, 0, 2, "Momentary %6.1f LUFS", momentary);
+    else mvwprintw(win, 0, 2, "Momentary   -inf LUFS");
+
+    // Rows 1..height-3 hold the bars; the last two rows the labels and values
+    const int meter_top = 1;
+    const int meter_rows = height - 3;
+    if (meter_rows < 1) return;
+    const int slot_width = width / map.channels;
+    const int bar_width = std::max(1, slot_width - 2);
+    for (int c = 0; c < map.channels; ++c) {
+        int x = c * slot_width + (slot_width - bar_width) / 2;
+        float level = std::isfinite(channel_loudness[c]) ? meterFraction(channel_loudness[c]) : 0.0f;
+        int filled = static_cast<int>(level * meter_rows + 0.5f);
+        for (int row = 0; row < filled; ++row) {
+            int y = meter_top + meter_rows - 1 - row;
+            int pairID = selectColorByAmplitude(static_cast<float>(row) / meter_rows, colorPairIDs);
+            wattron(win, COLOR_PAIR(pairID));
+            for (int dx = 0; dx < bar_width && x + dx < width; ++dx) mvwaddch(win, y, x + dx, ACS_CKBOARD);
+            wattroff(win, COLOR_PAIR(pairID));
+        }
+
+        int peak_row = static_cast<int>(peakHold[c] * (meter_rows - 1) + 0.5f);
+        if (peakHold[c] > 0.0f) {
+            int pairID = selectColorByAmplitude(peakHold[c], colorPairIDs);
+            wattron(win, COLOR_PAIR(pairID) | A_BOLD);
+            for (int dx = 0; dx < bar_width && x + dx < width; ++dx) mvwaddch(win, meter_top + meter_rows - 1 - peak_row, x + dx, '-');
+            wattroff(win, COLOR_PAIR(pairID) | A_BOLD);
+        }
+        peakHold[c] = std::max(0.0f, peakHold[c] - decay__factor);
+
+        wattron(win, A_BOLD);
+        mvwprintw(win, height - 2, x, "%.*s", bar_width, map.label(c));
+        wattroff(win, A_BOLD);
+        if (std::isfinite(channel_loudness[c]) && channel_loudness[c] > METER_FLOOR_DB) {
+            mvwprintw(win, height - 1, x, "%.*s", bar_width, std::to_string(static_cast<int>(std::lround(channel_loudness[c]))).c_str());
+        }
+    }
+}
+
+/**
+ * @brief Adds one buffer of the selected source to its stereo field analysis.
+ *
+ * Called for every captured buffer, drawn or not: the analyzer's window
+ * and its FFT input are counted in hops, one hop per buffer.
+ */
+void analyzeStereoField(const int16_t* leftData, const int16_t* rightData, uint32_t sampleRate, bool audio_active) {
+    StereoFieldAnalyzer& analyzer = modeState->stereoField;
+    if (!audio_active) analyzer.reset();
+    else analyzer.addHop(leftData, rightData, sampleRate);
+}
+
+/**
+ * @brief Draws the stereo field: mid/side levels, correlation over time and width per octave.
+ *
+ * The top half plots the correlation of every hop, newest on the right,
+ * from +1 (mono) at the top to -1 (opposite phase) at the bottom; the
+ * bottom half has one bar per octave band, its height the side share of
+ * that band's energy. Only shows what analyzeStereoField() measured.
+ */
+void drawStereoField(WINDOW *win, int width, int height, const std::vector<int>& colorPairIDs) {
+    const StereoFieldAnalyzer& analyzer = modeState->stereoField;
+    const StereoFieldReading& reading = analyzer.reading();
+
+    char header[96];
+    snprintf(header, sizeof(header), "Mid %6.1f dB  Side %6.1f dB  Corr %+5.2f  Width %4.2f",
+             std::max(-99.9f, reading.midDb), std::max(-99.9f, reading.sideDb), reading.correlation, reading.width);
+    mvwprintw(win, 0, 2, "%.*s", std::max(0, width - 2), header);
+
+    // --- Correlation over time ---
+    const int label_width = 3;
+    const int plot_top = 1;
+    const int plot_rows = height / 2 - 1;
+    if (plot_rows >= 3 && width > label_width + 1) {
+        const int zero_row = plot_top + (plot_rows - 1) / 2;
+        mvwprintw(win, plot_top, 0, "+1");
+        mvwprintw(win, zero_row, 0, " 0");
+        mvwprintw(win, plot_top + plot_rows - 1, 0, "-1");
+        wattron(win, A_DIM);
+        for (int x = label_width; x < width; ++x) mvwaddch(win, zero_row, x, ACS_HLINE);
+        wattroff(win, A_DIM);
+        const int columns = std::min(width - label_width, analyzer.historySize());
+        for (int age = 0; age < columns; ++age) {
+            float correlation = analyzer.correlationAt(age);
+            int row = plot_top + static_cast<int>(std::lround((1.0f - correlation) * 0.5f * (plot_rows - 1)));
+            // Out of phase is the warning end of the gradient
+            int pairID = selectColorByAmplitude((1.0f - correlation) * 0.5f, colorPairIDs);
+            wattron(win, COLOR_PAIR(pairID));
+            mvwaddch(win, row, width - 1 - age, ACS_BULLET);
+            wattroff(win, COLOR_PAIR(pairID));
+        }
+    }
+
+    // --- Width per octave band ---
+    const int bars_top = height / 2;
+    const int bar_rows = height - 1 - bars_top;
+    if (bar_rows < 1) return;
+    const int slot_width = width / STEREO_BANDS;
+    const int bar_width = std::max(1, slot_width - 1);
+    for (int band = 0; band < STEREO_BANDS; ++band) {
+        int x = band * slot_width;
+        mvwprintw(win, height - 1, x, "%.*s", slot_width, StereoFieldAnalyzer::bandLabel(band));
+        if (!reading.bandPresent[band]) continue;
+        float band_width = reading.bandWidth[band];
+        int filled = static_cast<int>(band_width * bar_rows + 0.5f);
+        int pairID = selectColorByAmplitude(band_width, colorPairIDs);
+        wattron(win, COLOR_PAIR(pairID));
+        for (int row = 0; row < filled; ++row) {
+            for (int dx = 0; dx < bar_width && x + dx < width; ++dx) mvwaddch(win, height - 2 - row, x + dx, ACS_CKBOARD);
         }
+        wattroff(win, COLOR_PAIR(pairID));
     }
 }
 
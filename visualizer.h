@@ -5,6 +5,7 @@
 #include <cstdint>
 #include <vector>
 #include "config_parser.h"
+#include "channel_ring.h"
 
 void drawOscilloscope(WINDOW *win, int width, int height,
                       const int16_t* leftData, const int16_t* rightData,
@@ -31,11 +32,48 @@ void drawEclipse(WINDOW *win, int width, int height,
                  const int16_t* leftData, const int16_t* rightData,
                  const std::vector<int>& colorPairIDs);
 
-// Generic function for config-defined shapes
+// Feeds one buffer of the selected source to the channel meter; every captured buffer goes through here
+void meterChannels(const ChannelBuffers& channels, uint32_t sampleRate, bool audio_active);
+
+// Loudness and peak of every captured channel, as measured by meterChannels()
+void drawChannelMeter(WINDOW *win, int width, int height, const ChannelBuffers& channels, uint32_t sampleRate,
+                      const std::vector<int>& colorPairIDs, bool audio_active);
+
+// Feeds one buffer of the selected source to the stereo field; every captured buffer goes through here
+void analyzeStereoField(const int16_t* leftData, const int16_t* rightData, uint32_t sampleRate, bool audio_active);
+
+// Mid/side levels, correlation over time and stereo width per octave, as measured by analyzeStereoField()
+void drawStereoField(WINDOW *win, int width, int height, const std::vector<int>& colorPairIDs);
+
+// Feeds one buffer of the selected source to the expression shapes' beat detector; every captured buffer goes through here
+void trackBeats(const int16_t* leftData, const int16_t* rightData, uint32_t sampleRate, bool audio_active);
+
+// Generic function for config-defined shapes; `time` is the media time of the buffer drawn, in seconds
 void drawCustomShape(WINDOW *win, int width, int height,
                      const int16_t* leftData, const int16_t* rightData,
                      const std::vector<int>& colorPairIDs,
-                     const CustomVisualizer& visualizer);
+                     const CustomVisualizer& visualizer, double time);
+
+// Precomputes per-shape tables (DISTORT ray distances); call once after loading
+void prepareCustomVisualizer(CustomVisualizer& visualizer);
+
+// Rebuilds window-size dependent layouts; call once after a resize has settled
+void resizeVisualizers(int width, int height);
+
+// Sizes per-mode state for the config's quality settings; call once per loaded config
+void configureVisualizers(const QualitySettings& quality, const std::vector<CustomVisualizer>& customVisualizers);
+
+// One set of per-mode state per capture source; the draw functions use the selected one
+void setVisualizerSourceCount(int count);
+void selectVisualizerSource(int index);
+
+// Freezing: keep the live state aside, start the selected source over from blank, put it back
+void holdVisualizerState();
+void resetVisualizerState();
+void releaseVisualizerState();
+
+// Starts the selected source's running measurements over; call when the mode feeding them changes
+void resetMeasurements();
 
 void toggleVuMeterMode(bool upArrow);
 const char* getVuMeterModeName();
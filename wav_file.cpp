@@ -0,0 +1,169 @@
+#include "wav_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint16_t FORMAT_PCM = 1;
+const uint16_t FORMAT_FLOAT = 3;
+const uint16_t FORMAT_EXTENSIBLE = 0xFFFE;
+
+uint16_t readU16(const uint8_t* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const uint8_t* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// Speaker positions of the WAVE_FORMAT_EXTENSIBLE channel mask bits, in mask order
+ChannelMap mapFromMask(uint32_t mask, int channels) {
+    using P = ChannelPosition;
+    static const P positions[] = {P::FRONT_LEFT, P::FRONT_RIGHT, P::FRONT_CENTER, P::LFE, P::REAR_LEFT, P::REAR_RIGHT,
+                                  P::UNKNOWN, P::UNKNOWN, P::REAR_CENTER, P::SIDE_LEFT, P::SIDE_RIGHT};
+    ChannelMap map = ChannelMap::standard(channels);
+    const int wanted = std::min(channels, MAX_CHANNELS);
+    int assigned = 0;
+    for (int bit = 0; bit < 32 && assigned < wanted; ++bit) {
+        if (!(mask & (1u << bit))) continue;
+        map.position[assigned++] = bit < static_cast<int>(sizeof(positions) / sizeof(positions[0])) ? positions[bit] : P::UNKNOWN;
+    }
+    // A mask that does not name every channel says nothing we can use
+    return assigned == wanted ? map : ChannelMap::standard(channels);
+}
+
+int16_t fromFloat(double x) {
+    return static_cast<int16_t>(std::lrint(std::max(-1.0, std::min(1.0, x)) * 32767.0));
+}
+
+// One loop per encoding, so the decode inlines into it
+template <typename Decode>
+void convert(const uint8_t* frames, int frameCount, int bytesPerSample, int bytesPerFrame, ChannelBuffers& out,
+             Decode decode) {
+    for (int c = 0; c < out.map.channels; ++c) {
+        const uint8_t* p = frames + c * bytesPerSample;
+        int16_t* dest = out.data[c];
+        for (int i = 0; i < frameCount; ++i) dest[i] = decode(p + static_cast<size_t>(i) * bytesPerFrame);
+    }
+}
+
+} // namespace
+
+bool WavFile::open(const std::string& path, std::string& error) {
+    file = std::make_unique<MappedFile>(path);
+    if (!file->ok) {
+        error = "Cannot read " + path;
+        return false;
+    }
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file->data);
+    const size_t size = file->size;
+    if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 || std::memcmp(data + 8, "WAVE", 4) != 0) {
+        error = path + " is not a WAVE file";
+        return false;
+    }
+
+    const uint8_t* format = nullptr;
+    size_t format_size = 0;
+    const uint8_t* payload = nullptr;
+    size_t payload_size = 0;
+    for (size_t pos = 12; pos + 8 <= size;) {
+        uint32_t chunk_size = readU32(data + pos + 4);
+        const uint8_t* chunk = data + pos + 8;
+        // A streamed file may not know its data size yet: take what is there
+        size_t available = std::min<size_t>(chunk_size, size - pos - 8);
+        if (std::memcmp(data + pos, "fmt ", 4) == 0) {
+            format = chunk;
+            format_size = available;
+        } else if (std::memcmp(data + pos, "data", 4) == 0) {
+            payload = chunk;
+            payload_size = available;
+        }
+        if (format && payload) break;
+        pos += 8 + static_cast<size_t>(chunk_size) + (chunk_size & 1);
+    }
+    if (!format || format_size < 16 || !payload) {
+        error = path + " has no fmt or data chunk";
+        return false;
+    }
+
+    uint16_t tag = readU16(format);
+    int channels = readU16(format + 2);
+    sample_rate = readU32(format + 4);
+    bytes_per_frame = readU16(format + 12);
+    int bits = readU16(format + 14);
+    // Before anything is sized by it: the count comes straight from the file
+    if (channels < 1 || channels > MAX_CHANNELS) {
+        error = path + " has " + std::to_string(channels) + " channels; at most " + std::to_string(MAX_CHANNELS) + " are supported";
+        return false;
+    }
+    map = ChannelMap::standard(channels);
+    if (tag == FORMAT_EXTENSIBLE && format_size >= 40) {
+        map = mapFromMask(readU32(format + 20), channels);
+        tag = readU16(format + 24);  // The sub-format GUID starts with the plain tag
+    }
+    if (sample_rate == 0 || bytes_per_frame < channels * std::max(1, (bits + 7) / 8)) {
+        error = path + " has an invalid fmt chunk";
+        return false;
+    }
+    // Integer samples are left-justified in their container (20 bits in 3 bytes, 24 in 4),
+    // so the container size says where the top 16 bits are
+    const int container = bytes_per_frame / channels;
+    if (tag == FORMAT_PCM && container == 1) encoding = Encoding::U8;
+    else if (tag == FORMAT_PCM && container == 2) encoding = Encoding::S16;
+    else if (tag == FORMAT_PCM && container == 3) encoding = Encoding::S24;
+    else if (tag == FORMAT_PCM && container == 4) encoding = Encoding::S32;
+    else if (tag == FORMAT_FLOAT && bits == 32 && container == 4) encoding = Encoding::F32;
+    else if (tag == FORMAT_FLOAT && bits == 64 && container == 8) encoding = Encoding::F64;
+    else {
+        error = path + ": unsupported sample format (tag " + std::to_string(tag) + ", " + std::to_string(bits) + " bits)";
+        return false;
+    }
+    samples = payload;
+    frame_count = payload_size / bytes_per_frame;
+    return true;
+}
+
+void WavFile::readBuffer(uint64_t index, ChannelBuffers& out) const {
+    out.map = map;
+    const uint64_t first = index * BUFFER_FRAMES;
+    const int count = first < frame_count ? static_cast<int>(std::min<uint64_t>(BUFFER_FRAMES, frame_count - first)) : 0;
+    const uint8_t* frames = samples + first * bytes_per_frame;
+    const int sample_bytes = bytes_per_frame / map.channels;
+    switch (encoding) {
+        case Encoding::U8:
+            convert(frames, count, sample_bytes, bytes_per_frame, out,
+                    [](const uint8_t* p) { return static_cast<int16_t>((p[0] - 128) << 8); });
+            break;
+        case Encoding::S16:
+            convert(frames, count, sample_bytes, bytes_per_frame, out,
+                    [](const uint8_t* p) { return static_cast<int16_t>(readU16(p)); });
+            break;
+        case Encoding::S24:
+            convert(frames, count, sample_bytes, bytes_per_frame, out,
+                    [](const uint8_t* p) { return static_cast<int16_t>(readU16(p + 1)); });
+            break;
+        case Encoding::S32:
+            convert(frames, count, sample_bytes, bytes_per_frame, out,
+                    [](const uint8_t* p) { return static_cast<int16_t>(readU16(p + 2)); });
+            break;
+        case Encoding::F32:
+            convert(frames, count, sample_bytes, bytes_per_frame, out, [](const uint8_t* p) {
+                uint32_t bits = readU32(p);
+                float x;
+                std::memcpy(&x, &bits, sizeof(x));
+                return fromFloat(x);
+            });
+            break;
+        case Encoding::F64:
+            convert(frames, count, sample_bytes, bytes_per_frame, out, [](const uint8_t* p) {
+                uint64_t bits = readU32(p) | (static_cast<uint64_t>(readU32(p + 4)) << 32);
+                double x;
+                std::memcpy(&x, &bits, sizeof(x));
+                return fromFloat(x);
+            });
+            break;
+    }
+    for (int c = 0; c < map.channels; ++c) std::fill(out.data[c] + count, out.data[c] + BUFFER_FRAMES, 0);
+}
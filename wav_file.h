@@ -0,0 +1,44 @@
+#ifndef WAV_FILE_H
+#define WAV_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "channel_ring.h"
+#include "mapped_file.h"
+
+/**
+ * @brief A RIFF WAVE file, memory mapped and read a buffer at a time.
+ *
+ * Reads integer PCM of 8 to 32 bits and 32 or 64-bit float, plain or
+ * WAVE_FORMAT_EXTENSIBLE (whose channel mask gives the speaker positions),
+ * with up to MAX_CHANNELS channels. Samples are converted to the 16 bits
+ * the rest of the pipeline works in. Reading only touches the mapping, so
+ * any number of threads can read one file at once.
+ */
+class WavFile {
+public:
+    bool open(const std::string& path, std::string& error);
+
+    uint32_t sampleRate() const { return sample_rate; }
+    const ChannelMap& channelMap() const { return map; }
+    uint64_t frames() const { return frame_count; }
+    // Buffers of BUFFER_FRAMES frames, the last one padded with silence
+    uint64_t buffers() const { return (frame_count + BUFFER_FRAMES - 1) / BUFFER_FRAMES; }
+
+    // Deinterleaves buffer `index` into `out` (whose map becomes the file's)
+    void readBuffer(uint64_t index, ChannelBuffers& out) const;
+
+private:
+    enum class Encoding { U8, S16, S24, S32, F32, F64 };
+
+    std::unique_ptr<MappedFile> file;
+    const uint8_t* samples = nullptr;
+    uint64_t frame_count = 0;
+    uint32_t sample_rate = 0;
+    int bytes_per_frame = 0;
+    Encoding encoding = Encoding::S16;
+    ChannelMap map;
+};
+
+#endif // WAV_FILE_H